@@ -0,0 +1,424 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "substr_wrapper.h"
+#include "substr_batch.h"
+#include "substr_template.h"
+
+/*
+    Benchmarks of the parse/generate/emit steps over synthetic corpora.
+    One JSON object per line is written to the file given as first
+    argument (stdout if none), so results can be compared between builds.
+
+    The bench binary is linked with --wrap=malloc/calloc/realloc/free so
+    every allocation made by the library is counted.
+*/
+
+// minimum time spent measuring one case
+#define BENCH_MIN_NS   200000000ULL
+// inputs of each corpus, cycled through by the benchmark loops
+#define BENCH_CORPUS_N 64
+#define BENCH_MAX_THREADS 64
+
+/* 
+    allocation counters fed by the wrapped allocator */
+static size_t bench_allocs = 0;
+static size_t bench_alloc_bytes = 0;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void  __real_free(void *ptr);
+
+void *__wrap_malloc(size_t size)
+{
+    __atomic_fetch_add(&bench_allocs, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&bench_alloc_bytes, size, __ATOMIC_RELAXED);
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size)
+{
+    __atomic_fetch_add(&bench_allocs, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&bench_alloc_bytes, n * size, __ATOMIC_RELAXED);
+    return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    __atomic_fetch_add(&bench_allocs, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&bench_alloc_bytes, size, __ATOMIC_RELAXED);
+    return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void *ptr)
+{
+    __real_free(ptr);
+}
+
+static unsigned long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// examples of DBMS syntax rules, the same as main.c
+static substr_func_syntax dbms_substr_func_lib[5] = {
+    SUBSTR_SYNTAX("substr",    1, 0),
+    SUBSTR_SYNTAX("substring", 1, 0),
+    SUBSTR_SYNTAX("sbstr",     0, 0),
+    SUBSTR_SYNTAX("sstr",      0, 0),
+    SUBSTR_SYNTAX("SUBSTR",    0, 0),
+};
+
+/* 
+    a named set of inputs */
+typedef struct bench_corpus_struct {
+    const char *name ;
+    char  *inputs[BENCH_CORPUS_N] ;
+    size_t input_bytes ;    /* total bytes of all inputs */
+    size_t max_len ;
+} bench_corpus;
+
+/* 
+    build SUBSTR calls with a literal of literal_len bytes (a column name if 0),
+    negative starts if neg, and no length argument if no_length */
+static int corpus_init(bench_corpus *corpus, const char *name, size_t literal_len, int neg, int no_length)
+{
+    memset(corpus, 0, sizeof(*corpus));
+    corpus->name = name;
+
+    for (int i = 0; i < BENCH_CORPUS_N; i++) {
+        size_t cap = literal_len + 96;
+        char *input = malloc(cap);
+        if (!input) {
+            return -1;
+        }
+
+        int n = snprintf(input, cap, "SUBSTR(");
+        if (literal_len == 0) {
+            n += snprintf(input + n, cap - n, "col_%d", i);
+        } else {
+            input[n++] = '"';
+            for (size_t k = 0; k < literal_len; k++) {
+                // mostly letters, with the delimiters the parser has to look at
+                input[n++] = "abcdefghij klmnopqrstuvwxyz,()"[(k * 7 + i) % 30];
+            }
+            input[n++] = '"';
+        }
+        long start = neg ? -(i % 9 + 1) : i % 9 + 1;
+        if (no_length) {
+            snprintf(input + n, cap - n, ", %ld)", start);
+        } else {
+            snprintf(input + n, cap - n, ", %ld, %d)", start, i % 20 + 1);
+        }
+
+        corpus->inputs[i] = input;
+        corpus->input_bytes += strlen(input);
+        if (strlen(input) > corpus->max_len) {
+            corpus->max_len = strlen(input);
+        }
+    }
+    return 0;
+}
+
+static void corpus_free(bench_corpus *corpus)
+{
+    for (int i = 0; i < BENCH_CORPUS_N; i++) {
+        free(corpus->inputs[i]);
+    }
+}
+
+typedef enum {
+    BENCH_PARSE = 0,
+    BENCH_PARSE_VIEW,
+    BENCH_GEN_FUNC,
+    BENCH_CTX,
+    BENCH_GEN_CMD,
+    BENCH_TEMPLATE,
+    BENCH_TRANSLATE,
+    BENCH_BATCH,
+    BENCH_N_FUNCS,
+} bench_func;
+
+static const char *bench_func_names[BENCH_N_FUNCS] = {
+    "parse_substr_call",
+    "parse_substr_call_view",
+    "gen_substr_func",
+    "parse_gen_ctx",
+    "gen_substr_cmd",
+    "substr_template_render",
+    "translate_substr_func",
+    "translate_substr_batch",
+};
+
+/* 
+    state of one benchmark run, one per thread */
+typedef struct bench_run_struct {
+    const bench_corpus *corpus ;
+    bench_func func ;
+    int dbms_id ;
+    size_t iters ;
+    substr_func parsed[BENCH_CORPUS_N] ;    /* pre-parsed inputs for the gen_* cases */
+    substr_func generated[BENCH_CORPUS_N] ;
+    substr_ctx ctx ;                        /* arena of the ctx case, reset once per corpus pass */
+    substr_template *tpl ;                  /* "SUBSTR(?, ?, ?)" compiled for dbms_id */
+    char  *out ;
+    size_t out_len ;
+    long int sink ;
+} bench_run;
+
+/* 
+    run the selected function iters times over the corpus */
+static void *bench_loop(void *arg)
+{
+    bench_run *run = arg;
+    const substr_func_syntax *f_syntax = &dbms_substr_func_lib[run->dbms_id];
+    long int sink = 0;
+
+    for (size_t it = 0; it < run->iters; it++) {
+        int k = it % BENCH_CORPUS_N;
+        const char *input = run->corpus->inputs[k];
+
+        switch (run->func) {
+        case BENCH_PARSE: {
+            substr_func f = {0};
+            sink += parse_substr_call(input, &f);
+            free(f.col_name);
+            break;
+        }
+        case BENCH_PARSE_VIEW: {
+            substr_func_view v;
+            sink += parse_substr_call_view(input, strlen(input), &v) + (long)v.col_name.length;
+            break;
+        }
+        case BENCH_GEN_FUNC: {
+            substr_func f = {0};
+            sink += gen_substr_func(f_syntax, &run->parsed[k], &f);
+            free(f.func_name);
+            free(f.col_name);
+            break;
+        }
+        case BENCH_CTX: {
+            // parse and generate through the arena, released per corpus pass
+            substr_func p, f;
+            if (k == 0) {
+                substr_ctx_reset(&run->ctx);
+            }
+            if (parse_substr_call_ctx(&run->ctx, input, &p) == RET_SUCCESS) {
+                sink += gen_substr_func_ctx(&run->ctx, f_syntax, &p, &f);
+            }
+            break;
+        }
+        case BENCH_GEN_CMD:
+            sink += gen_substr_cmd(&run->generated[k], run->out, run->out_len);
+            break;
+        case BENCH_TEMPLATE: {
+            const substr_func *f = &run->parsed[k];
+            sink += substr_template_render(run->tpl, f->col_name, strlen(f->col_name), f->start_pos, f->length,
+                                           run->out, run->out_len);
+            break;
+        }
+        case BENCH_TRANSLATE: {
+            size_t wrt = 0;
+            sink += translate_substr_func(input, f_syntax, run->out, run->out_len, &wrt) + (long)wrt;
+            break;
+        }
+        case BENCH_BATCH: {
+            // one call translates the whole corpus, counted as BENCH_CORPUS_N ops
+            int ids[BENCH_CORPUS_N];
+            size_t offsets[BENCH_CORPUS_N], lengths[BENCH_CORPUS_N];
+            FunctionStatus status[BENCH_CORPUS_N];
+            for (int i = 0; i < BENCH_CORPUS_N; i++) {
+                ids[i] = run->dbms_id;
+            }
+            sink += translate_substr_batch((const char *const *)run->corpus->inputs, ids, BENCH_CORPUS_N,
+                                           dbms_substr_func_lib, run->out, run->out_len, offsets, lengths, status);
+            it += BENCH_CORPUS_N - 1;
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    run->sink = sink;
+    return NULL;
+}
+
+/* 
+    set a run up, on failure it is left for bench_run_free */
+static int bench_run_init(bench_run *run, const bench_corpus *corpus, bench_func func, int dbms_id)
+{
+    memset(run, 0, sizeof(*run));
+    run->corpus  = corpus;
+    run->func    = func;
+    run->dbms_id = dbms_id;
+    run->out_len = (corpus->max_len + 64) * BENCH_CORPUS_N;
+    run->out     = malloc(run->out_len);
+    substr_ctx_init(&run->ctx, NULL);
+    if (!run->out) {
+        return -1;
+    }
+
+    if (func == BENCH_TEMPLATE) {
+        if (substr_template_prepare(&run->ctx, "SUBSTR(?, ?, ?)", &dbms_substr_func_lib[dbms_id], &run->tpl, NULL) != RET_SUCCESS) {
+            return -1;
+        }
+    }
+
+    if (func == BENCH_GEN_FUNC || func == BENCH_GEN_CMD || func == BENCH_TEMPLATE) {
+        for (int k = 0; k < BENCH_CORPUS_N; k++) {
+            parse_substr_call(corpus->inputs[k], &run->parsed[k]);
+            if (gen_substr_func(&dbms_substr_func_lib[dbms_id], &run->parsed[k], &run->generated[k]) != RET_SUCCESS) {
+                // rejected by the target, emit the input as parsed
+                free(run->generated[k].func_name);
+                free(run->generated[k].col_name);
+                run->generated[k].func_name = strdup(dbms_substr_func_lib[dbms_id].func_name);
+                run->generated[k].col_name  = strdup(run->parsed[k].col_name);
+                run->generated[k].start_pos = run->parsed[k].start_pos;
+                run->generated[k].length    = run->parsed[k].length;
+            }
+        }
+    }
+    return 0;
+}
+
+static void bench_run_free(bench_run *run)
+{
+    for (int k = 0; k < BENCH_CORPUS_N; k++) {
+        free(run->parsed[k].func_name);
+        free(run->parsed[k].col_name);
+        free(run->generated[k].func_name);
+        free(run->generated[k].col_name);
+    }
+    substr_ctx_destroy(&run->ctx);
+    free(run->out);
+}
+
+/* 
+    time iters loops on n_threads threads, return wall time in ns */
+static unsigned long long bench_time(bench_run *runs, int n_threads, size_t iters)
+{
+    pthread_t threads[BENCH_MAX_THREADS];
+
+    unsigned long long t0 = now_ns();
+    for (int t = 0; t < n_threads; t++) {
+        runs[t].iters = iters;
+        if (n_threads == 1) {
+            bench_loop(&runs[t]);
+        } else {
+            pthread_create(&threads[t], NULL, bench_loop, &runs[t]);
+        }
+    }
+    for (int t = 0; t < n_threads && n_threads > 1; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    return now_ns() - t0;
+}
+
+/* 
+    measure one (function, corpus, threads) case and print it as JSON */
+static int bench_case(FILE *out, const bench_corpus *corpus, bench_func func, int dbms_id, int n_threads)
+{
+    bench_run runs[BENCH_MAX_THREADS];
+    for (int t = 0; t < n_threads; t++) {
+        if (bench_run_init(&runs[t], corpus, func, dbms_id) != 0) {
+            for (; t >= 0; t--) {
+                bench_run_free(&runs[t]);
+            }
+            return -1;
+        }
+    }
+
+    // grow the iteration count until a run takes long enough to measure
+    size_t iters = BENCH_CORPUS_N;
+    unsigned long long elapsed = 0;
+    size_t allocs = 0, alloc_bytes = 0;
+    for (;;) {
+        size_t allocs_before = __atomic_load_n(&bench_allocs, __ATOMIC_RELAXED);
+        size_t bytes_before  = __atomic_load_n(&bench_alloc_bytes, __ATOMIC_RELAXED);
+        elapsed = bench_time(runs, n_threads, iters);
+        allocs      = __atomic_load_n(&bench_allocs, __ATOMIC_RELAXED) - allocs_before;
+        alloc_bytes = __atomic_load_n(&bench_alloc_bytes, __ATOMIC_RELAXED) - bytes_before;
+        if (elapsed >= BENCH_MIN_NS || iters > ((size_t)1 << 40)) {
+            break;
+        }
+        iters *= 2;
+    }
+
+    double ops      = (double)iters * n_threads;
+    double seconds  = elapsed / 1e9;
+    double bytes_in = ops * corpus->input_bytes / BENCH_CORPUS_N;
+
+    fprintf(out, "{\"bench\": \"%s\", \"corpus\": \"%s\", \"dbms_id\": %d, \"threads\": %d, "
+                 "\"ops\": %.0f, \"ns_per_op\": %.2f, \"ops_per_sec\": %.0f, \"mb_per_sec\": %.2f, "
+                 "\"allocs_per_op\": %.3f, \"alloc_bytes_per_op\": %.1f}\n",
+            bench_func_names[func], corpus->name, dbms_id, n_threads,
+            ops, elapsed * (double)n_threads / ops, ops / seconds, bytes_in / seconds / 1e6,
+            allocs / ops, alloc_bytes / ops);
+    fflush(out);
+
+    for (int t = 0; t < n_threads; t++) {
+        bench_run_free(&runs[t]);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    FILE *out = stdout;
+    if (argc > 1) {
+        out = fopen(argv[1], "w");
+        if (!out) {
+            perror(argv[1]);
+            return 1;
+        }
+    }
+
+    enum { N_CORPORA = 5 };
+    bench_corpus corpora[N_CORPORA];
+    if (corpus_init(&corpora[0], "short_col", 0, 0, 0) != 0
+        || corpus_init(&corpora[1], "literal_4k", 4096, 0, 0) != 0
+        || corpus_init(&corpora[2], "literal_1m", 1024 * 1024, 0, 0) != 0
+        || corpus_init(&corpora[3], "negative_start", 0, 1, 0) != 0
+        || corpus_init(&corpora[4], "missing_length", 0, 0, 1) != 0) {
+        fprintf(stderr, "Out of memory building corpora\n");
+        return 1;
+    }
+
+    for (int c = 0; c < N_CORPORA; c++) {
+        for (int f = 0; f < BENCH_N_FUNCS; f++) {
+            bench_case(out, &corpora[c], f, DBMS_ORACLE, 1);
+        }
+    }
+
+    // scaling of every function across threads, doubling up to the CPU count.
+    // The allocating cases also share the allocator and its counters
+    long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n_cpus < 1) {
+        n_cpus = 1;
+    }
+    int max_threads = n_cpus < 2 ? 2 : n_cpus > BENCH_MAX_THREADS ? BENCH_MAX_THREADS : (int)n_cpus;
+    for (int n_threads = 1; n_threads <= max_threads; n_threads *= 2) {
+        for (int f = 0; f < BENCH_N_FUNCS; f++) {
+            bench_case(out, &corpora[0], f, DBMS_ORACLE, n_threads);
+        }
+        bench_case(out, &corpora[1], BENCH_TRANSLATE, DBMS_ORACLE, n_threads);
+    }
+
+    for (int c = 0; c < N_CORPORA; c++) {
+        corpus_free(&corpora[c]);
+    }
+    if (out != stdout) {
+        fclose(out);
+    }
+    return 0;
+}
@@ -26,10 +26,16 @@ typedef enum  {
     FUNC_CALL_WRONG_COL_NAME = -12,
     FUNC_CALL_WRONG_START_POS = -13,
     FUNC_CALL_WRONG_LENGTH    = -14,
+    FUNC_CALL_SYNTAX_ERR      = -15,
 
     NULL_INPUT_POINTER    = -20,
     MEMORY_ALLOCATION_ERR = -21,
     TOO_SHORT_OUTPUT_BUFFER = -22,
+    FILE_IO_ERR           = -23,
+    UNKNOWN_DBMS_ID       = -24,
+    CONFIG_SYNTAX_ERR     = -25,
+    EDIT_OUT_OF_RANGE     = -26,
+    UNKNOWN_FUNC_NAME     = -27,
 
 } FunctionStatus;
 
@@ -1,19 +1,452 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 #include "substr_wrapper.h"
+#include "substr_batch.h"
+#include "substr_stream.h"
+#include "substr_scan.h"
+#include "substr_cache.h"
+#include "substr_expr.h"
+#include "substr_fold.h"
+#include "substr_template.h"
+#include "substr_daemon.h"
+#include "substr_registry.h"
+#include "substr_telemetry.h"
+#include "substr_doc.h"
+#include "substr_rules.h"
+#include "substr_intern.h"
+#include "substr_source.h"
+#include "substr_pool.h"
+
+// output buffer of the in-memory rewriter sink used by the tests
+typedef struct {
+    char   data[1024];
+    size_t used;
+} test_sink_buffer;
+
+static int test_sink(void *sink_ctx, struct iovec *iov, int iov_cnt)
+{
+    test_sink_buffer *out = sink_ctx;
+    for (int i = 0; i < iov_cnt; i++) {
+        if (out->used + iov[i].iov_len >= sizeof(out->data)) {
+            return -1;
+        }
+        memcpy(out->data + out->used, iov[i].iov_base, iov[i].iov_len);
+        out->used += iov[i].iov_len;
+    }
+    out->data[out->used] = '\0';
+    return 0;
+}
+
+// task of the pool reuse test, counts the runs of each task index
+static void test_pool_task(void *arg, size_t task_index)
+{
+    __atomic_add_fetch((int *)arg + task_index, 1, __ATOMIC_RELAXED);
+}
+
+// pool of the allocator hook test, counts the live allocations
+static void *test_pool_alloc(void *pool, size_t size)
+{
+    (*(size_t *)pool)++;
+    return malloc(size);
+}
+
+static void test_pool_release(void *pool, void *ptr, size_t size)
+{
+    (void)size;
+    (*(size_t *)pool)--;
+    free(ptr);
+}
+
+// sink of the diagnostics test, counts the failures it is handed
+static void test_diag_sink(void *sink_ctx, const char *input_str, const substr_diag *diag)
+{
+    (void)input_str;
+    (void)diag;
+    (*(int *)sink_ctx)++;
+}
+
+/*
+    CLI mode: rewrite every SUBSTR call of a SQL script to a target DBMS.
+    The target is a DBMS_ID, or a dialect name of the config given with
+    --dialects. The script is read from FILE, or from stdin if FILE is
+    missing or "-", and written to stdout. Regular files are split on
+    statement boundaries and rewritten on -j threads, all online CPUs by default.
+*/
+static int rewrite_main(int argc, char **argv, const substr_func_syntax *dbms_substr_func_lib)
+{
+    long n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    const char *file_name = NULL;
+    const char *dbms_arg  = NULL;
+    const char *dialects  = NULL;
+
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            n_threads = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--dialects") == 0 && i + 1 < argc) {
+            dialects = argv[++i];
+        } else if (!dbms_arg) {
+            dbms_arg = argv[i];
+        } else if (!file_name) {
+            file_name = argv[i];
+        } else {
+            dbms_arg = NULL;
+            break;
+        }
+    }
+
+    if (!dbms_arg) {
+        fprintf(stderr, "Usage: %s --rewrite DBMS_ID|DIALECT [FILE] [-j THREADS] [--dialects CONFIG]\n", argv[0]);
+        return 2;
+    }
+
+    // the syntax is copied out of the read section, the rewrite does not use the registry
+    substr_registry *registry = NULL;
+    substr_func_syntax dialect_syntax;
+    const substr_func_syntax *f_syntax = &dialect_syntax;
+    if (dialects) {
+        substr_diag diag = {0};
+        registry = substr_registry_create();
+        if (!registry || substr_registry_load_file(registry, dialects, &diag) != RET_SUCCESS) {
+            fprintf(stderr, "Cannot load %s: error %d at byte %zu\n", dialects, diag.status, diag.offset);
+            substr_registry_destroy(registry);
+            return 2;
+        }
+
+        substr_registry_read rd;
+        substr_registry_enter(registry, &rd);
+        const substr_func_syntax *found = substr_registry_find(&rd, dbms_arg, strlen(dbms_arg));
+        if (found) {
+            dialect_syntax = *found;
+        }
+        substr_registry_exit(registry, &rd);
+        if (!found) {
+            fprintf(stderr, "Unknown dialect: %s\n", dbms_arg);
+            substr_registry_destroy(registry);
+            return 2;
+        }
+    } else {
+        char *end = NULL;
+        long dbms_id = strtol(dbms_arg, &end, 10);
+        if (end == dbms_arg || *end != '\0' || dbms_id < DBMS_ORACLE || dbms_id > DBMS_SQLITE) {
+            fprintf(stderr, "Unknown DBMS ID: %s (dialect names need --dialects CONFIG)\n", dbms_arg);
+            return 2;
+        }
+        f_syntax = &dbms_substr_func_lib[dbms_id];
+    }
+
+    FILE *in = stdin;
+    if (file_name && strcmp(file_name, "-") != 0) {
+        in = fopen(file_name, "rb");
+        if (!in) {
+            perror(file_name);
+            substr_registry_destroy(registry);
+            return 1;
+        }
+    }
+
+    FunctionStatus rc = substr_rewrite_fd_parallel(fileno(in), fileno(stdout), f_syntax,
+                                                   n_threads > 0 ? (int)n_threads : 1);
+    if (in != stdin) {
+        fclose(in);
+    }
+    substr_registry_destroy(registry);
+    if (rc != RET_SUCCESS) {
+        fprintf(stderr, "Error rewriting input: %d\n", rc);
+        return 1;
+    }
+    return 0;
+}
+
+/*
+    one JSON line with the telemetry counters: translations per DBMS ID,
+    failures per status code and the sampled p50/p99 of each stage in ns
+*/
+static void print_telemetry(FILE *out)
+{
+    static const char *stages[SUBSTR_TELEMETRY_STAGES] = { "parse", "generate", "emit" };
+    substr_telemetry_snapshot snap;
+    substr_telemetry_read(&snap);
+
+    fprintf(out, "{\"translations\": [");
+    for (int i = 0; i < SUBSTR_TELEMETRY_MAX_DBMS; i++) {
+        fprintf(out, i ? ", %llu" : "%llu", (unsigned long long)snap.translations[i]);
+    }
+    fprintf(out, "], \"failures\": {");
+    for (int i = 1, first = 1; i < SUBSTR_TELEMETRY_MAX_STATUS; i++) {
+        if (snap.status[i]) {
+            fprintf(out, "%s\"%d\": %llu", first ? "" : ", ", -i, (unsigned long long)snap.status[i]);
+            first = 0;
+        }
+    }
+    fprintf(out, "}, \"bytes_in\": %llu, \"bytes_out\": %llu",
+            (unsigned long long)snap.bytes_in, (unsigned long long)snap.bytes_out);
+    for (int s = 0; s < SUBSTR_TELEMETRY_STAGES; s++) {
+        fprintf(out, ", \"%s_p50_ns\": %llu, \"%s_p99_ns\": %llu",
+                stages[s], (unsigned long long)substr_telemetry_quantile(snap.latency[s], 0.5),
+                stages[s], (unsigned long long)substr_telemetry_quantile(snap.latency[s], 0.99));
+    }
+    fprintf(out, "}\n");
+}
+
+/*
+    CLI mode: serve translations on a Unix socket until SIGINT or SIGTERM,
+    on -j worker threads, all online CPUs by default. With --dialects the
+    requests may name a dialect of CONFIG, reloaded on SIGHUP. The telemetry
+    is printed to stderr on exit.
+*/
+static substr_daemon *serve_daemon = NULL;
+
+static void serve_stop(int sig)
+{
+    (void)sig;
+    substr_daemon_stop(serve_daemon);
+}
+
+static void serve_reload(int sig)
+{
+    (void)sig;
+    substr_daemon_reload(serve_daemon);
+}
+
+// sink of the config reloads, the previous dialects stay in use
+static void serve_reload_failed(void *sink_ctx, const char *input_str, const substr_diag *diag)
+{
+    (void)input_str;
+    fprintf(stderr, "Cannot reload %s: error %d at byte %zu\n", (const char *)sink_ctx, diag->status, diag->offset);
+}
+
+static int serve_main(int argc, char **argv, const substr_func_syntax *dbms_substr_func_lib, size_t n_syntax)
+{
+    long n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    const char *socket_path = NULL;
+    const char *dialects    = NULL;
+
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            n_threads = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--dialects") == 0 && i + 1 < argc) {
+            dialects = argv[++i];
+        } else if (!socket_path) {
+            socket_path = argv[i];
+        } else {
+            socket_path = NULL;
+            break;
+        }
+    }
+
+    if (!socket_path) {
+        fprintf(stderr, "Usage: %s --serve SOCKET [-j THREADS] [--dialects CONFIG]\n", argv[0]);
+        return 2;
+    }
+
+    substr_registry *registry = NULL;
+    substr_diag diag = {0};
+    if (dialects) {
+        registry = substr_registry_create();
+        if (!registry || substr_registry_load_file(registry, dialects, &diag) != RET_SUCCESS) {
+            fprintf(stderr, "Cannot load %s: error %d at byte %zu\n", dialects, diag.status, diag.offset);
+            substr_registry_destroy(registry);
+            return 2;
+        }
+        diag.sink     = serve_reload_failed;
+        diag.sink_ctx = (void *)dialects;
+    }
+
+    serve_daemon = substr_daemon_create(socket_path, dbms_substr_func_lib, n_syntax,
+                                        n_threads > 0 ? (int)n_threads : 1);
+    if (!serve_daemon) {
+        perror(socket_path);
+        substr_registry_destroy(registry);
+        return 1;
+    }
+    if (registry && substr_daemon_set_registry(serve_daemon, registry, dialects, &diag) != RET_SUCCESS) {
+        fprintf(stderr, "Out of memory\n");
+        substr_daemon_destroy(serve_daemon);
+        substr_registry_destroy(registry);
+        return 1;
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = serve_stop;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    sa.sa_handler = serve_reload;
+    sigaction(SIGHUP, &sa, NULL);
+
+    FunctionStatus rc = substr_daemon_run(serve_daemon);
+    substr_daemon_destroy(serve_daemon);
+    substr_registry_destroy(registry);
+    print_telemetry(stderr);
+    if (rc != RET_SUCCESS) {
+        fprintf(stderr, "Error serving requests: %d\n", rc);
+        return 1;
+    }
+    return 0;
+}
+
+// daemon thread of the socket test
+static void *test_daemon_run(void *daemon)
+{
+    substr_daemon_run(daemon);
+    return NULL;
+}
+
+// one request to the daemon at socket_path, the output is null-terminated
+static FunctionStatus test_daemon_request(const char *socket_path, unsigned dbms_id, unsigned flags,
+                        const char *input, char *out, size_t out_len)
+{
+    struct sockaddr_un addr;
+    unsigned char frame[256];
+    size_t input_len = strlen(input), got = 0;
+    FunctionStatus status = FILE_IO_ERR;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socket_path);
+    substr_daemon_put_u32(frame, (uint32_t)(SUBSTR_DAEMON_REQ_HEADER - 4 + input_len));
+    substr_daemon_put_u32(frame + 4, 1);
+    frame[8]  = (unsigned char)dbms_id;
+    frame[9]  = (unsigned char)(dbms_id >> 8);
+    frame[10] = (unsigned char)flags;
+    frame[11] = (unsigned char)(flags >> 8);
+    memcpy(frame + SUBSTR_DAEMON_REQ_HEADER, input, input_len);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0
+        && write(fd, frame, SUBSTR_DAEMON_REQ_HEADER + input_len) == (ssize_t)(SUBSTR_DAEMON_REQ_HEADER + input_len)) {
+        shutdown(fd, SHUT_WR);
+        ssize_t n;
+        while (got < sizeof(frame) && (n = read(fd, frame + got, sizeof(frame) - got)) > 0) {
+            got += n;
+        }
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    if (got >= SUBSTR_DAEMON_RESP_HEADER && got == 4 + substr_daemon_get_u32(frame)
+        && got - SUBSTR_DAEMON_RESP_HEADER < out_len) {
+        status = (int32_t)substr_daemon_get_u32(frame + 8);
+        memcpy(out, frame + SUBSTR_DAEMON_RESP_HEADER, got - SUBSTR_DAEMON_RESP_HEADER);
+        out[got - SUBSTR_DAEMON_RESP_HEADER] = '\0';
+    }
+    return status;
+}
+
+// reader thread of the registry test: translate through the registry while
+// the main thread reloads it, every answer must come from one of the configs
+static void *test_registry_read(void *registry)
+{
+    long n_bad = 0;
+    for (int i = 0; i < 20000; i++) {
+        char out[64];
+        size_t out_len = 0;
+        FunctionStatus rc = translate_substr_func_dialect(registry, "Target", "SUBSTR(col, 2, 3)", out, sizeof(out), &out_len);
+        if (rc != RET_SUCCESS || (strcmp(out, "substr(col, 2, 3)") != 0 && strcmp(out, "substring(col, 3, 3)") != 0)) {
+            n_bad++;
+        }
+    }
+    return (void *)n_bad;
+}
 
-int main() {
+// worker of the telemetry test, counted in its own per-thread slot
+typedef struct {
+    const char *input ;
+    const substr_func_syntax *f_syntax ;
+} test_telemetry_arg;
+
+static void *test_telemetry_worker(void *arg)
+{
+    const test_telemetry_arg *t = arg;
+    for (int i = 0; i < 1000; i++) {
+        char out[128];
+        size_t out_len = 0;
+        translate_substr_func_useID(t->input, DBMS_SQLITE, t->f_syntax, out, sizeof(out), &out_len);
+    }
+    return NULL;
+}
+
+// sink of the document test, grows with the output
+typedef struct {
+    char  *data;
+    size_t used, cap;
+} test_grow_buffer;
+
+static int test_grow_sink(void *sink_ctx, struct iovec *iov, int iov_cnt)
+{
+    test_grow_buffer *out = sink_ctx;
+    for (int i = 0; i < iov_cnt; i++) {
+        if (out->used + iov[i].iov_len + 1 > out->cap) {
+            size_t cap = (out->used + iov[i].iov_len + 1) * 2;
+            char *data = realloc(out->data, cap);
+            if (!data) {
+                return -1;
+            }
+            out->data = data;
+            out->cap = cap;
+        }
+        memcpy(out->data + out->used, iov[i].iov_base, iov[i].iov_len);
+        out->used += iov[i].iov_len;
+        out->data[out->used] = '\0';
+    }
+    return 0;
+}
+
+// worker of the interning test: every thread interns the same names in its
+// own order and keeps the handle it got for each
+#define TEST_INTERN_NAMES  5000
+
+typedef struct {
+    substr_intern *pool ;
+    unsigned seed       ;
+    const char *handles[TEST_INTERN_NAMES] ;
+    long n_bad          ;
+} test_intern_arg;
+
+static void *test_intern_worker(void *arg)
+{
+    test_intern_arg *t = arg;
+    for (unsigned i = 0; i < 8 * TEST_INTERN_NAMES; i++) {
+        unsigned k = (i * 7919 + t->seed) % TEST_INTERN_NAMES;
+        char name[32];
+        int len = snprintf(name, sizeof(name), "col_%u", k);
+        const char *ident = substr_intern_ident(t->pool, name, (size_t)len);
+        if (!ident || strcmp(ident, name) != 0 || (t->handles[k] && t->handles[k] != ident)) {
+            t->n_bad++;
+        }
+        t->handles[k] = ident;
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv) {
 
     // examples of DBMS syntax rules, not-validate against real DBMS
     substr_func_syntax dbms_substr_func_lib[5] = {
-        {"substr",    1, 0},    // Oracle: allows negative start, 1-based index
-        {"substring", 1, 0},    // SQL Server: does not allow negative start, 1-based index
-        {"sbstr",     0, 0},    // PostgreSQL: does not allow negative start, 1-based index
-        {"sstr",      0, 0},    // MySQL: does not allow negative start, 1-based index
-        {"SUBSTR",    0, 0},    // SQLite: does not allow negative start, 0-based index
+        SUBSTR_SYNTAX("substr",    1, 0),   // Oracle: allows negative start, 1-based index
+        SUBSTR_SYNTAX("substring", 1, 0),   // SQL Server: does not allow negative start, 1-based index
+        SUBSTR_SYNTAX("sbstr",     0, 0),   // PostgreSQL: does not allow negative start, 1-based index
+        SUBSTR_SYNTAX("sstr",      0, 0),   // MySQL: does not allow negative start, 1-based index
+        SUBSTR_SYNTAX("SUBSTR",    0, 0),   // SQLite: does not allow negative start, 0-based index
     };
+    // translations given an entry of this table are counted under its DBMS_ID
+    substr_telemetry_set_table(dbms_substr_func_lib, 5);
+
+    if (argc > 1 && strcmp(argv[1], "--rewrite") == 0) {
+        return rewrite_main(argc, argv, dbms_substr_func_lib);
+    }
+    if (argc > 1 && strcmp(argv[1], "--serve") == 0) {
+        return serve_main(argc, argv, dbms_substr_func_lib, 5);
+    }
 
     char *test_inputs [3] = {
         "SUBSTR(col_name, -1, 5)",
@@ -96,6 +529,1328 @@ int main() {
         }
     }
 
+    // test-4, view-based parsing returns ranges of the input instead of copies
+    const char *expected_col_4[3] = {
+        "col_name",
+        "\"an interesting test for substring function(), cool\"",
+        "\"testtestcol_name\"",
+    };
+    long int expected_start_4[3] = {-1, 1, 1};
+    for (itest = 0; itest < 3; itest++) {
+        substr_func_view f_view = {0};
+        FunctionStatus rc = parse_substr_call_view(test_inputs[itest], strlen(test_inputs[itest]), &f_view);
+        if (rc != RET_SUCCESS
+            || f_view.col_name.length != strlen(expected_col_4[itest])
+            || strncmp(test_inputs[itest] + f_view.col_name.offset, expected_col_4[itest], f_view.col_name.length) != 0
+            || f_view.start_pos != expected_start_4[itest]) {
+            printf("Test-4 input %d FAILED: rc %d, col_name %.*s, start %ld\n", itest, rc,
+                   (int)f_view.col_name.length, test_inputs[itest] + f_view.col_name.offset, f_view.start_pos);
+        } else {
+            printf("Test-4 input %d passed.\n", itest);
+        }
+    }
+
+    // test-5, batch translation of test-1 and test-2 inputs for every DBMS into one arena
+    const char *batch_inputs[10];
+    int batch_ids[10];
+    size_t batch_offsets[10], batch_lengths[10];
+    FunctionStatus batch_status[10];
+    for (int dbms_id = DBMS_ORACLE; dbms_id <= DBMS_SQLITE; dbms_id++) {
+        batch_inputs[dbms_id]     = test_inputs[0];
+        batch_ids[dbms_id]        = dbms_id;
+        batch_inputs[dbms_id + 5] = test_inputs[1];
+        batch_ids[dbms_id + 5]    = dbms_id;
+    }
+    translate_substr_batch(batch_inputs, batch_ids, 10, dbms_substr_func_lib,
+                           output_cmd_long, sizeof(output_cmd_long), batch_offsets, batch_lengths, batch_status);
+    for (int i = 0; i < 10; i++) {
+        FunctionStatus expected = i < 5 ? expected_results_1[i] : expected_results_2[i - 5];
+        char single_cmd[1024] = {0};
+        if (batch_status[i] == RET_SUCCESS) {
+            translate_substr_func(batch_inputs[i], &dbms_substr_func_lib[batch_ids[i]],
+                                  single_cmd, sizeof(single_cmd), &out_str_wrt);
+        }
+        if (batch_status[i] != expected
+            || (expected == RET_SUCCESS && strcmp(output_cmd_long + batch_offsets[i], single_cmd) != 0)) {
+            printf("Test-5 item %d FAILED: expected %d, got %d\n", i, expected, batch_status[i]);
+        } else {
+            printf("Test-5 item %d passed.\n", i);
+        }
+    }
+    int bad_ids_5[3] = { -1, DBMS_UNKNOWN, DBMS_MYSQL };
+    translate_substr_batch(batch_inputs, bad_ids_5, 3, dbms_substr_func_lib,
+                           output_cmd_long, sizeof(output_cmd_long), batch_offsets, batch_lengths, batch_status);
+    if (batch_status[0] != UNKNOWN_DBMS_ID || batch_status[1] != UNKNOWN_DBMS_ID || batch_status[2] != expected_results_1[DBMS_MYSQL]) {
+        printf("Test-5 unknown DBMS IDs FAILED\n");
+    } else {
+        printf("Test-5 unknown DBMS IDs passed.\n");
+    }
+
+    // test-6, parse test-1 input once and translate it for every DBMS
+    size_t all_offsets[5], all_lengths[5];
+    FunctionStatus all_status[5];
+    translate_substr_func_all(test_inputs[0], dbms_substr_func_lib, 5, output_cmd_long, sizeof(output_cmd_long),
+                              all_offsets, all_lengths, all_status);
+    for (int dbms_id = DBMS_ORACLE; dbms_id <= DBMS_SQLITE; dbms_id++) {
+        char single_cmd[1024] = {0};
+        if (all_status[dbms_id] == RET_SUCCESS) {
+            translate_substr_func(test_inputs[0], &dbms_substr_func_lib[dbms_id],
+                                  single_cmd, sizeof(single_cmd), &out_str_wrt);
+        }
+        if (all_status[dbms_id] != expected_results_1[dbms_id]
+            || (all_status[dbms_id] == RET_SUCCESS
+                && strcmp(output_cmd_long + all_offsets[dbms_id], single_cmd) != 0)) {
+            printf("Test-6 DBMS ID %d FAILED: expected %d, got %d\n", dbms_id, expected_results_1[dbms_id], all_status[dbms_id]);
+        } else {
+            printf("Test-6 DBMS ID %d passed.\n", dbms_id);
+        }
+    }
+
+    // test-7, rewrite SUBSTR calls inside a SQL script, fed whole and in 1 to 16 byte chunks
+    const char *script_7 =
+        "SELECT substr(a, -2, 3), 'SUBSTR(x, 1)' -- SUBSTR(y, 1)\n"
+        "FROM t WHERE SUBSTR (\"it's, (fine)\", 2) = b /* substr(z, 1) */ AND mysubstr(c, 1);";
+    const char *expected_7 =
+        "SELECT substring(a, -2, 3), 'SUBSTR(x, 1)' -- SUBSTR(y, 1)\n"
+        "FROM t WHERE substring(\"it's, (fine)\", 2) = b /* substr(z, 1) */ AND mysubstr(c, 1);";
+    for (size_t chunk = 0; chunk <= 16; chunk++) {
+        test_sink_buffer sink_out = {{0}, 0};
+        substr_rewriter rw;
+        substr_rewriter_init(&rw, &dbms_substr_func_lib[DBMS_SQLSERVER], test_sink, &sink_out);
+
+        // emulate reading the script in chunks, keeping the unconsumed tail
+        char held[256];
+        size_t held_len = 0, pos = 0, total = strlen(script_7);
+        FunctionStatus rc = RET_SUCCESS;
+        do {
+            size_t take = chunk == 0 ? total - pos : (total - pos < chunk ? total - pos : chunk);
+            memcpy(held + held_len, script_7 + pos, take);
+            held_len += take;
+            pos += take;
+
+            size_t consumed = 0;
+            rc = substr_rewrite_feed(&rw, held, held_len, pos == total, &consumed);
+            memmove(held, held + consumed, held_len - consumed);
+            held_len -= consumed;
+        } while (rc == RET_SUCCESS && pos < total);
+
+        if (rc != RET_SUCCESS || held_len != 0 || strcmp(sink_out.data, expected_7) != 0) {
+            printf("Test-7 chunk %zu FAILED: rc %d, output %s\n", chunk, rc, sink_out.data);
+        } else {
+            printf("Test-7 chunk %zu passed.\n", chunk);
+        }
+    }
+
+    // a call with a nested call or a fourth argument is not translated, and left as it is
+    {
+        const char *calls_7[] = {
+            "SELECT SUBSTR(SUBSTR(a,1,2), 3) FROM t;",
+            "SELECT SUBSTR(SUBSTR(a,1), 3) FROM t;",
+            "SELECT SUBSTR(a, 1, 2, 99) FROM t;",
+            "SELECT SUBSTR(a, 1 2) FROM t;",
+        };
+        int ok = 1;
+        for (size_t i = 0; i < sizeof(calls_7) / sizeof(calls_7[0]); i++) {
+            test_sink_buffer sink_out = {{0}, 0};
+            substr_rewriter rw;
+            char call_cmd[256];
+            size_t consumed = 0;
+            substr_rewriter_init(&rw, &dbms_substr_func_lib[DBMS_SQLSERVER], test_sink, &sink_out);
+            ok = ok && substr_rewrite_feed(&rw, calls_7[i], strlen(calls_7[i]), 1, &consumed) == RET_SUCCESS
+               && strcmp(sink_out.data, calls_7[i]) == 0 && rw.n_translated == 0
+               && translate_substr_func(calls_7[i] + 7, &dbms_substr_func_lib[DBMS_SQLSERVER], call_cmd,
+                                        sizeof(call_cmd), &out_str_wrt) == FUNC_CALL_SYNTAX_ERR;
+        }
+        printf(ok ? "Test-7 nested calls and extra arguments passed.\n"
+                  : "Test-7 nested calls and extra arguments FAILED\n");
+    }
+
+    // a call qualified by a schema or an object is not the built-in, also when the '.' ends a chunk
+    {
+        const char *script_7 = "SELECT x.SUBSTR(c, 1), dbo.Substr(c, 1), SUBSTR(c, 1) FROM t;";
+        int ok = 1;
+        for (size_t split = 0; split <= strlen(script_7); split++) {
+            test_sink_buffer sink_out = {{0}, 0};
+            substr_rewriter rw;
+            char held[128];
+            size_t consumed = 0, held_len = split;
+            substr_rewriter_init(&rw, &dbms_substr_func_lib[DBMS_SQLSERVER], test_sink, &sink_out);
+            memcpy(held, script_7, split);
+            ok = ok && substr_rewrite_feed(&rw, held, held_len, 0, &consumed) == RET_SUCCESS;
+            memmove(held, held + consumed, held_len - consumed);
+            held_len -= consumed;
+            memcpy(held + held_len, script_7 + split, strlen(script_7) - split);
+            held_len += strlen(script_7) - split;
+            ok = ok && substr_rewrite_feed(&rw, held, held_len, 1, &consumed) == RET_SUCCESS
+               && strcmp(sink_out.data, "SELECT x.SUBSTR(c, 1), dbo.Substr(c, 1), substring(c, 1) FROM t;") == 0
+               && rw.n_translated == 1;
+        }
+        printf(ok ? "Test-7 qualified calls passed.\n" : "Test-7 qualified calls FAILED\n");
+    }
+
+    // test-8, structural bitmap matches a byte-by-byte scan, across block boundaries
+    char scan_input_8[200];
+    for (size_t i = 0; i < sizeof(scan_input_8); i++) {
+        scan_input_8[i] = "ab(c)d\"e,f g'"[(i * 7 + i / 5) % 13];
+    }
+    for (size_t len = 0; len <= sizeof(scan_input_8); len += 37) {
+        uint64_t bitmap_8[4] = {0};
+        int ok = 1;
+        substr_scan_bitmap(&substr_scan_call_set, scan_input_8, len, bitmap_8);
+        for (size_t i = 0; i < len; i++) {
+            int expected = strchr("()\",", scan_input_8[i]) != NULL;
+            int found    = (bitmap_8[i / 64] >> (i % 64)) & 1;
+            size_t next  = substr_scan_find(&substr_scan_call_set, scan_input_8, len, i);
+            if (expected != found || (expected && next != i) || (!expected && next <= i)) {
+                ok = 0;
+            }
+        }
+        if (!ok) {
+            printf("Test-8 length %zu (%s) FAILED\n", len, substr_scan_impl());
+        } else {
+            printf("Test-8 length %zu (%s) passed.\n", len, substr_scan_impl());
+        }
+    }
+
+    // test-9, a parallel rewrite of a large script matches the single-threaded one,
+    // with ';' inside quotes and comments that must not be taken as statement ends
+    FILE *script_9 = tmpfile();
+    FILE *serial_9 = tmpfile();
+    FILE *parallel_9 = tmpfile();
+    if (script_9 && serial_9 && parallel_9) {
+        for (int i = 0; i < 20000; i++) {
+            fprintf(script_9, "SELECT SUBSTR(c%d, %d, 2), 'a;b' /* ; */ FROM t -- x;\n WHERE SUBSTR(\"x;%d\", -1);\n",
+                    i, i % 5 - 2, i);
+        }
+        fflush(script_9);
+        FunctionStatus rc_serial   = substr_rewrite_fd(fileno(script_9), fileno(serial_9), &dbms_substr_func_lib[DBMS_MYSQL]);
+        FunctionStatus rc_parallel = substr_rewrite_fd_parallel(fileno(script_9), fileno(parallel_9),
+                                                                &dbms_substr_func_lib[DBMS_MYSQL], 4);
+        rewind(serial_9);
+        rewind(parallel_9);
+        int same = 1, c;
+        while ((c = fgetc(serial_9)) != EOF) {
+            if (c != fgetc(parallel_9)) {
+                same = 0;
+                break;
+            }
+        }
+        if (rc_serial != RET_SUCCESS || rc_parallel != RET_SUCCESS || !same || fgetc(parallel_9) != EOF) {
+            printf("Test-9 FAILED: serial %d, parallel %d, same output %d\n", rc_serial, rc_parallel, same);
+        } else {
+            printf("Test-9 passed.\n");
+        }
+    }
+    if (script_9) fclose(script_9);
+    if (serial_9) fclose(serial_9);
+    if (parallel_9) fclose(parallel_9);
+
+    // one pool reused for many short runs, each task runs once with the argument of its own run
+    {
+        substr_pool *pool_9 = substr_pool_create(8);
+        int runs_9[2][9] = {{0}};
+        int ok = pool_9 != NULL;
+        for (int run = 0; ok && run < 20000; run++) {
+            int *counts = runs_9[run % 2];
+            size_t n_tasks = 1 + run % 9;
+            ok = substr_pool_start(pool_9, test_pool_task, counts, n_tasks) == RET_SUCCESS;
+            substr_pool_wait(pool_9);
+            for (size_t i = 0; i < 9; i++) {
+                ok = ok && counts[i] == (i < n_tasks) && runs_9[(run + 1) % 2][i] == 0;
+                counts[i] = 0;
+            }
+        }
+        substr_pool_destroy(pool_9);
+        printf(ok ? "Test-9 pool reuse passed.\n" : "Test-9 pool reuse FAILED\n");
+    }
+
+    // test-10, cached translations match uncached ones, the second round is all hits
+    substr_cache *cache_10 = substr_cache_create(64 * 1024);
+    int failed_10 = (cache_10 == NULL);
+    for (int round = 0; round < 2 && !failed_10; round++) {
+        for (itest = 0; itest < 3; itest++) {
+            for (int dbms_id = DBMS_ORACLE; dbms_id <= DBMS_SQLITE; dbms_id++) {
+                char cached_cmd[1024] = {0};
+                size_t cached_wrt = 0;
+                FunctionStatus rc_plain  = translate_substr_func(test_inputs[itest], &dbms_substr_func_lib[dbms_id],
+                                                output_cmd_long, sizeof(output_cmd_long), &out_str_wrt);
+                FunctionStatus rc_cached = translate_substr_func_useID_cached(cache_10, test_inputs[itest], dbms_id,
+                                                dbms_substr_func_lib, cached_cmd, sizeof(cached_cmd), &cached_wrt);
+                if (rc_plain != rc_cached
+                    || (rc_plain == RET_SUCCESS && (strcmp(output_cmd_long, cached_cmd) != 0 || out_str_wrt != cached_wrt))) {
+                    failed_10 = 1;
+                }
+            }
+        }
+    }
+    substr_cache_stats stats_10;
+    substr_cache_get_stats(cache_10, &stats_10);
+    if (failed_10 || stats_10.misses != 15 || stats_10.hits != 15) {
+        printf("Test-10 FAILED: hits %zu, misses %zu\n", stats_10.hits, stats_10.misses);
+    } else {
+        printf("Test-10 passed.\n");
+    }
+    substr_cache_destroy(cache_10);
+
+    // a cache stays within its budget, a budget below one set gets no cache
+    {
+        int ok = substr_cache_create(0) == NULL && substr_cache_create(SUBSTR_CACHE_SLOT) == NULL;
+        for (size_t budget = SUBSTR_CACHE_WAYS * SUBSTR_CACHE_SLOT; ok && budget <= 64 * 1024; budget += 1000) {
+            substr_cache *cache = substr_cache_create(budget);
+            substr_cache_stats stats;
+            substr_cache_get_stats(cache, &stats);
+            ok = cache ? stats.mem_bytes <= budget && stats.n_entries >= SUBSTR_CACHE_WAYS
+                       : budget < SUBSTR_CACHE_WAYS * SUBSTR_CACHE_SLOT + SUBSTR_CACHE_SLOT;
+            substr_cache_destroy(cache);
+        }
+        printf(ok ? "Test-10 budget passed.\n" : "Test-10 budget FAILED\n");
+    }
+
+    // test-11, the translated elements borrow the syntax table name and the input column
+    for (int dbms_id = DBMS_ORACLE; dbms_id <= DBMS_SQLITE; dbms_id++) {
+        substr_func_view f_view = {0};
+        substr_func_ref  f_ref  = {0};
+        parse_substr_call_view(test_inputs[1], strlen(test_inputs[1]), &f_view);
+        FunctionStatus rc = gen_substr_func_ref(&dbms_substr_func_lib[dbms_id], test_inputs[1], &f_view, &f_ref);
+        if (rc != RET_SUCCESS
+            || f_ref.func_name != dbms_substr_func_lib[dbms_id].func_name
+            || f_ref.func_name_len != strlen(dbms_substr_func_lib[dbms_id].func_name)
+            || f_ref.col_name != test_inputs[1] + f_view.col_name.offset) {
+            printf("Test-11 DBMS ID %d FAILED: rc %d\n", dbms_id, rc);
+        } else {
+            printf("Test-11 DBMS ID %d passed.\n", dbms_id);
+        }
+    }
+
+    // test-12, size query then an exactly sized buffer, including a start position of 0
+    const char *size_inputs_12[4] = {
+        test_inputs[0], test_inputs[1], "SUBSTR(col_name, 0, 12345)", "SUBSTR(c, -9223372036854775808, 99)",
+    };
+    for (int i = 0; i < 4; i++) {
+        size_t needed = 0, written = 0;
+        FunctionStatus rc_size = translate_substr_func(size_inputs_12[i], &dbms_substr_func_lib[DBMS_ORACLE],
+                                                       NULL, 0, &needed);
+        char *exact_cmd = malloc(needed + 1);
+        FunctionStatus rc_exact = exact_cmd ? translate_substr_func(size_inputs_12[i], &dbms_substr_func_lib[DBMS_ORACLE],
+                                                                    exact_cmd, needed + 1, &written)
+                                            : MEMORY_ALLOCATION_ERR;
+        FunctionStatus rc_short = exact_cmd ? translate_substr_func(size_inputs_12[i], &dbms_substr_func_lib[DBMS_ORACLE],
+                                                                    exact_cmd, needed, &written)
+                                            : MEMORY_ALLOCATION_ERR;
+        if (rc_size != RET_SUCCESS || rc_exact != RET_SUCCESS || rc_short != TOO_SHORT_OUTPUT_BUFFER
+            || strlen(exact_cmd) != needed) {
+            printf("Test-12 input %d FAILED: size %d, exact %d, short %d\n", i, rc_size, rc_exact, rc_short);
+        } else {
+            printf("Test-12 input %d passed.\n", i);
+            printf("  Output: %s\n", exact_cmd);
+        }
+        free(exact_cmd);
+    }
+
+    // test-13, parse and generate through a context: the arena is reused after a reset,
+    // a custom pool sees every allocation
+    substr_ctx ctx_13;
+    substr_ctx_init(&ctx_13, NULL);
+    size_t sys_allocs_13 = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        int ok = 1;
+        substr_ctx_reset(&ctx_13);
+        for (int dbms_id = DBMS_ORACLE; dbms_id <= DBMS_SQLITE; dbms_id++) {
+            substr_func f_parsed = {0}, f_gen = {0}, f_legacy_in = {0}, f_legacy = {0};
+            char ctx_cmd[256], legacy_cmd[256];
+            FunctionStatus rc = parse_substr_call_ctx(&ctx_13, test_inputs[1], &f_parsed);
+            FunctionStatus rc_gen = rc == RET_SUCCESS
+                ? gen_substr_func_ctx(&ctx_13, &dbms_substr_func_lib[dbms_id], &f_parsed, &f_gen) : rc;
+            parse_substr_call(test_inputs[1], &f_legacy_in);
+            FunctionStatus rc_legacy = gen_substr_func(&dbms_substr_func_lib[dbms_id], &f_legacy_in, &f_legacy);
+            if (rc_gen != rc_legacy
+                || (rc_gen == RET_SUCCESS
+                    && (gen_substr_cmd(&f_gen, ctx_cmd, sizeof(ctx_cmd)) <= 0
+                        || gen_substr_cmd(&f_legacy, legacy_cmd, sizeof(legacy_cmd)) <= 0
+                        || strcmp(ctx_cmd, legacy_cmd) != 0))) {
+                ok = 0;
+            }
+            free(f_legacy_in.col_name);
+            free(f_legacy.func_name);
+            free(f_legacy.col_name);
+        }
+        if (pass == 0) {
+            sys_allocs_13 = ctx_13.n_sys_allocs;
+        }
+        if (!ok || ctx_13.n_sys_allocs != sys_allocs_13 || ctx_13.n_allocs != (size_t)(pass + 1) * 15) {
+            printf("Test-13 arena pass %d FAILED: %zu allocs, %zu from malloc\n",
+                   pass, ctx_13.n_allocs, ctx_13.n_sys_allocs);
+        } else {
+            printf("Test-13 arena pass %d passed.\n", pass);
+        }
+    }
+    substr_ctx_destroy(&ctx_13);
+
+    size_t pool_live_13 = 0;
+    substr_allocator pool_13 = { test_pool_alloc, test_pool_release, &pool_live_13 };
+    substr_ctx_init(&ctx_13, &pool_13);
+    substr_func f_pool_13 = {0}, f_pool_gen_13 = {0};
+    parse_substr_call_ctx(&ctx_13, test_inputs[0], &f_pool_13);
+    gen_substr_func_ctx(&ctx_13, &dbms_substr_func_lib[DBMS_SQLSERVER], &f_pool_13, &f_pool_gen_13);
+    size_t pool_peak_13 = pool_live_13;
+    substr_ctx_release(&ctx_13, f_pool_13.col_name, strlen(f_pool_13.col_name) + 1);
+    substr_ctx_release(&ctx_13, f_pool_gen_13.func_name, strlen(f_pool_gen_13.func_name) + 1);
+    substr_ctx_release(&ctx_13, f_pool_gen_13.col_name, strlen(f_pool_gen_13.col_name) + 1);
+    if (pool_peak_13 != 3 || pool_live_13 != 0 || ctx_13.n_allocs != 3 || ctx_13.n_sys_allocs != 0) {
+        printf("Test-13 custom pool FAILED: peak %zu, live %zu\n", pool_peak_13, pool_live_13);
+    } else {
+        printf("Test-13 custom pool passed.\n");
+    }
+    substr_ctx_destroy(&ctx_13);
+
+    // test-14, failures are described in a caller-owned diag: status, stage and byte offset
+    struct {
+        const char *input;
+        int dbms_id;
+        size_t out_len;
+        FunctionStatus status;
+        substr_stage stage;
+        size_t offset;
+    } diag_cases_14[6] = {
+        { "SUBSTR(col, 2, 3)",    DBMS_MYSQL,      64, RET_SUCCESS,              SUBSTR_STAGE_NONE,      0 },
+        { "SUBSTR(col, x2, 3)",   DBMS_ORACLE,     64, FUNC_CALL_WRONG_START_POS, SUBSTR_STAGE_PARSE,    12 },
+        { "SUBSTR(col, 2, 3y)",   DBMS_ORACLE,     64, FUNC_CALL_WRONG_LENGTH,   SUBSTR_STAGE_PARSE,     15 },
+        { "SUBSTR(col, 2, 3",     DBMS_ORACLE,     64, FUNC_CALL_PARENS_MISMATCH, SUBSTR_STAGE_PARSE,     6 },
+        { "SUBSTR(col, -2, 3)",   DBMS_POSTGRESQL, 64, SUBSTR_STARTPOS_NEGATIVE, SUBSTR_STAGE_GENERATE,  12 },
+        { "SUBSTR(col, 2, 3)",    DBMS_ORACLE,      8, TOO_SHORT_OUTPUT_BUFFER,  SUBSTR_STAGE_EMIT,      17 },
+    };
+    int sink_calls_14 = 0;
+    for (int i = 0; i < 6; i++) {
+        char diag_cmd[64];
+        size_t written = 0;
+        substr_diag diag = {0};
+        diag.sink     = test_diag_sink;
+        diag.sink_ctx = &sink_calls_14;
+        FunctionStatus rc = translate_substr_func_diag(diag_cases_14[i].input, &dbms_substr_func_lib[diag_cases_14[i].dbms_id],
+                                                       diag_cmd, diag_cases_14[i].out_len, &written, &diag);
+        if (rc != diag_cases_14[i].status || diag.status != rc
+            || diag.stage != diag_cases_14[i].stage || diag.offset != diag_cases_14[i].offset) {
+            printf("Test-14 input %d FAILED: status %d, stage %d, offset %zu\n", i, diag.status, diag.stage, diag.offset);
+        } else {
+            printf("Test-14 input %d passed.\n", i);
+        }
+    }
+    if (sink_calls_14 != 5) {
+        printf("Test-14 sink FAILED: %d calls\n", sink_calls_14);
+    } else {
+        printf("Test-14 sink passed.\n");
+    }
+
+    // test-15, nested expressions: the first argument can be any expression and
+    // nested substr calls are translated too; plain inputs match translate_substr_func
+    struct {
+        const char *input;
+        int dbms_id;
+        FunctionStatus status;
+        const char *expected;
+        size_t err_pos;
+    } expr_cases_15[6] = {
+        { "SUBSTR(UPPER(col), 2, 3)",              DBMS_ORACLE,     RET_SUCCESS, "substr(UPPER(col), 2, 3)", 0 },
+        { "SUBSTR(substr(col, 1, 10), 2, 3)",      DBMS_SQLSERVER,  RET_SUCCESS, "substring(substring(col, 1, 10), 2, 3)", 0 },
+        { "SUBSTR(\"a,b\" || TRIM(col), -2)",      DBMS_ORACLE,     RET_SUCCESS, "substr(\"a,b\" || TRIM(col), -2)", 0 },
+        { "SUBSTR(Substr(col, -1, 2), 1, 2)",      DBMS_POSTGRESQL, SUBSTR_STARTPOS_NEGATIVE,  NULL, 19 },
+        { "SUBSTR(UPPER(col, 2, 3)",               DBMS_ORACLE,     FUNC_CALL_PARENS_MISMATCH, NULL, 6 },
+        { "SUBSTR(col, 2 + 1, 3)",                 DBMS_ORACLE,     FUNC_CALL_WRONG_START_POS, NULL, 12 },
+    };
+    substr_ctx ctx_15;
+    substr_ctx_init(&ctx_15, NULL);
+    for (int i = 0; i < 6; i++) {
+        char expr_cmd[128];
+        size_t needed = 0, written = 0;
+        substr_diag diag = {0};
+        substr_ctx_reset(&ctx_15);
+        const substr_func_syntax *f_syntax = &dbms_substr_func_lib[expr_cases_15[i].dbms_id];
+        FunctionStatus rc_size = translate_substr_expr(&ctx_15, expr_cases_15[i].input, f_syntax, NULL, 0, &needed, NULL);
+        FunctionStatus rc = translate_substr_expr(&ctx_15, expr_cases_15[i].input, f_syntax,
+                                                  expr_cmd, sizeof(expr_cmd), &written, &diag);
+        int ok = rc == expr_cases_15[i].status && rc_size == rc;
+        if (ok && rc == RET_SUCCESS) {
+            ok = strcmp(expr_cmd, expr_cases_15[i].expected) == 0 && written == needed;
+        } else if (ok) {
+            ok = diag.offset == expr_cases_15[i].err_pos;
+        }
+        if (!ok) {
+            printf("Test-15 input %d FAILED: rc %d, offset %zu\n", i, rc, diag.offset);
+        } else {
+            printf("Test-15 input %d passed.\n", i);
+        }
+    }
+    for (int i = 0; i < 3; i++) {
+        int ok = 1;
+        for (int dbms_id = DBMS_ORACLE; dbms_id <= DBMS_SQLITE; dbms_id++) {
+            char expr_cmd[128], plain_cmd[128];
+            size_t expr_wrt = 0, plain_wrt = 0;
+            FunctionStatus rc_expr  = translate_substr_expr(&ctx_15, test_inputs[i], &dbms_substr_func_lib[dbms_id],
+                                                            expr_cmd, sizeof(expr_cmd), &expr_wrt, NULL);
+            FunctionStatus rc_plain = translate_substr_func(test_inputs[i], &dbms_substr_func_lib[dbms_id],
+                                                            plain_cmd, sizeof(plain_cmd), &plain_wrt);
+            if (rc_expr != rc_plain || (rc_expr == RET_SUCCESS && strcmp(expr_cmd, plain_cmd) != 0)) {
+                ok = 0;
+            }
+        }
+        printf(ok ? "Test-15 plain input %d passed.\n" : "Test-15 plain input %d FAILED\n", i);
+    }
+    substr_ctx_destroy(&ctx_15);
+
+    // test-16, folding substr calls on literals, positions counted in UTF-8 chars
+    struct {
+        const char *input;
+        int dbms_id;
+        FunctionStatus status;
+        const char *expected;
+    } fold_cases_16[8] = {
+        { "SUBSTR(\"testtestcol_name\", 1, 0)",  DBMS_ORACLE,     RET_SUCCESS, "\"testtestcol_name\"" },
+        { "SUBSTR(\"h\xc3\xa9llo w\xc3\xb6rld\", 2, 4)", DBMS_MYSQL, RET_SUCCESS, "\"\xc3\xa9llo\"" },
+        { "SUBSTR(\"h\xc3\xa9llo w\xc3\xb6rld\", 7)",    DBMS_SQLITE, RET_SUCCESS, "\"w\xc3\xb6rld\"" },
+        { "SUBSTR(\"w\xc3\xb6rld\", -4, 2)",         DBMS_ORACLE,     RET_SUCCESS, "\"\xc3\xb6r\"" },
+        { "SUBSTR(\"w\xc3\xb6rld\", -4, 2)",         DBMS_POSTGRESQL, SUBSTR_STARTPOS_NEGATIVE, NULL },
+        { "SUBSTR(\"abc\", 0, 2)",                    DBMS_ORACLE,     RET_SUCCESS, "\"ab\"" },
+        { "SUBSTR(\"abc\", 0, 2)",                    DBMS_POSTGRESQL, RET_SUCCESS, "\"a\"" },
+        { "SUBSTR(col, 1, 2)",                        DBMS_SQLSERVER,  RET_SUCCESS, "substring(col, 1, 2)" },
+    };
+    for (int i = 0; i < 8; i++) {
+        char fold_cmd[64];
+        size_t needed = 0, written = 0;
+        const substr_func_syntax *f_syntax = &dbms_substr_func_lib[fold_cases_16[i].dbms_id];
+        translate_substr_func_fold(fold_cases_16[i].input, f_syntax, NULL, 0, &needed, NULL);
+        FunctionStatus rc = translate_substr_func_fold(fold_cases_16[i].input, f_syntax,
+                                                       fold_cmd, sizeof(fold_cmd), &written, NULL);
+        if (rc != fold_cases_16[i].status
+            || (rc == RET_SUCCESS && (strcmp(fold_cmd, fold_cases_16[i].expected) != 0 || written != needed))) {
+            printf("Test-16 input %d FAILED: rc %d\n", i, rc);
+        } else {
+            printf("Test-16 input %d passed.\n", i);
+            if (rc == RET_SUCCESS) {
+                printf("  Output: %s\n", fold_cmd);
+            }
+        }
+    }
+
+    // the vectorized code point counter agrees with a byte loop on every length and alignment
+    char utf8_16[300];
+    for (int i = 0; i < 300; i++) {
+        utf8_16[i] = (char)((i % 5 == 0) ? 0x41 : (i % 5 == 1) ? 0xC3 : (i % 5 == 2) ? 0xA9 : (i % 5 == 3) ? 0xE2 : 0x82);
+    }
+    int utf8_ok_16 = 1;
+    for (size_t from = 0; from < 70; from++) {
+        for (size_t len = 0; from + len <= 300; len += 7) {
+            size_t expected = 0, nth = 0;
+            for (size_t k = 0; k < len; k++) {
+                if (((unsigned char)utf8_16[from + k] & 0xC0) != 0x80) {
+                    if (expected == len / 5) {
+                        nth = k;
+                    }
+                    expected++;
+                }
+            }
+            if (substr_scan_utf8_count(utf8_16 + from, len) != expected
+                || (len / 5 < expected && substr_scan_utf8_offset(utf8_16 + from, len, len / 5) != nth)
+                || substr_scan_utf8_offset(utf8_16 + from, len, expected) != len) {
+                utf8_ok_16 = 0;
+            }
+        }
+    }
+    printf(utf8_ok_16 ? "Test-16 utf8 counter passed.\n" : "Test-16 utf8 counter FAILED\n");
+
+    // test-17, prepared templates: compiled once per target, rendered with bound values
+    substr_ctx ctx_17;
+    substr_ctx_init(&ctx_17, NULL);
+    struct {
+        const char *template_str;
+        int dbms_id;
+        int slots;
+        const char *col_name;
+        long int start_pos, length;
+        long int status;
+        const char *expected;
+    } tpl_cases_17[6] = {
+        { "SUBSTR(col, ?, ?)", DBMS_ORACLE, SUBSTR_SLOT_START | SUBSTR_SLOT_LENGTH, NULL, 2, 5, 0, "substr(col, 2, 5)" },
+        { "SUBSTR(col, ?, ?)", DBMS_ORACLE, SUBSTR_SLOT_START | SUBSTR_SLOT_LENGTH, NULL, -2, 0, 0, "substr(col, -2)" },
+        { "SUBSTR(?, ?, ?)", DBMS_POSTGRESQL, SUBSTR_SLOT_COL | SUBSTR_SLOT_START | SUBSTR_SLOT_LENGTH,
+          "name", -1, 3, SUBSTR_STARTPOS_NEGATIVE, NULL },
+        { "SUBSTR(?, ?, ?)", DBMS_POSTGRESQL, SUBSTR_SLOT_COL | SUBSTR_SLOT_START | SUBSTR_SLOT_LENGTH,
+          "name", 1, 3, 0, "sbstr(name, 1, 3)" },
+        { "SUBSTR(UPPER(substr(c, 1, 9)), 2, ?)", DBMS_SQLSERVER, SUBSTR_SLOT_LENGTH, NULL, 0, 4, 0,
+          "substring(UPPER(substring(c, 1, 9)), 2, 4)" },
+        { "SUBSTR(\"lit, eral\", ?)", DBMS_MYSQL, SUBSTR_SLOT_START, NULL, 7, 0, 0, "sstr(\"lit, eral\", 7)" },
+    };
+    for (int i = 0; i < 6; i++) {
+        substr_template *tpl = NULL;
+        char tpl_cmd[128];
+        FunctionStatus rc = substr_template_prepare(&ctx_17, tpl_cases_17[i].template_str,
+                                                    &dbms_substr_func_lib[tpl_cases_17[i].dbms_id], &tpl, NULL);
+        const char *col_name = tpl_cases_17[i].col_name;
+        size_t col_name_len = col_name ? strlen(col_name) : 0;
+        long int needed = rc == RET_SUCCESS ? substr_template_render(tpl, col_name, col_name_len, tpl_cases_17[i].start_pos,
+                                                                     tpl_cases_17[i].length, NULL, 0) : rc;
+        long int written = rc == RET_SUCCESS ? substr_template_render(tpl, col_name, col_name_len, tpl_cases_17[i].start_pos,
+                                                                      tpl_cases_17[i].length, tpl_cmd, sizeof(tpl_cmd)) : rc;
+        int ok = rc == RET_SUCCESS && substr_template_slots(tpl) == tpl_cases_17[i].slots;
+        if (ok && tpl_cases_17[i].expected) {
+            ok = written == needed && written == (long int)strlen(tpl_cases_17[i].expected)
+                 && strcmp(tpl_cmd, tpl_cases_17[i].expected) == 0;
+        } else if (ok) {
+            ok = written == tpl_cases_17[i].status;
+        }
+        printf(ok ? "Test-17 template %d passed.\n" : "Test-17 template %d FAILED\n", i);
+    }
+
+    // rendering "SUBSTR(?, ?, ?)" with parsed values gives what translate_substr_func gives
+    for (int dbms_id = DBMS_ORACLE; dbms_id <= DBMS_SQLITE; dbms_id++) {
+        substr_template *tpl = NULL;
+        substr_diag diag = {0};
+        int ok = substr_template_prepare(&ctx_17, "SUBSTR(?, ?, ?)", &dbms_substr_func_lib[dbms_id], &tpl, &diag) == RET_SUCCESS;
+        for (int i = 0; ok && i < 3; i++) {
+            substr_func_view f_view;
+            char tpl_cmd[128], plain_cmd[128];
+            size_t plain_wrt = 0;
+            parse_substr_call_view(test_inputs[i], strlen(test_inputs[i]), &f_view);
+            long int wrt = substr_template_render(tpl, test_inputs[i] + f_view.col_name.offset, f_view.col_name.length,
+                                                  f_view.start_pos, f_view.length, tpl_cmd, sizeof(tpl_cmd));
+            FunctionStatus rc = translate_substr_func(test_inputs[i], &dbms_substr_func_lib[dbms_id],
+                                                      plain_cmd, sizeof(plain_cmd), &plain_wrt);
+            ok = rc == RET_SUCCESS ? (wrt == (long int)plain_wrt && strcmp(tpl_cmd, plain_cmd) == 0) : wrt == rc;
+        }
+        substr_template_release(&ctx_17, tpl);
+        printf(ok ? "Test-17 DBMS ID %d passed.\n" : "Test-17 DBMS ID %d FAILED\n", dbms_id);
+    }
+
+    substr_template *bad_tpl_17 = NULL;
+    substr_diag diag_17 = {0};
+    if (substr_template_prepare(&ctx_17, "SUBSTR(UPPER(?), ?)", &dbms_substr_func_lib[DBMS_ORACLE], &bad_tpl_17, &diag_17)
+            != FUNC_CALL_SYNTAX_ERR || diag_17.offset != 13 || bad_tpl_17) {
+        printf("Test-17 nested placeholder FAILED\n");
+    } else {
+        printf("Test-17 nested placeholder passed.\n");
+    }
+    substr_ctx_destroy(&ctx_17);
+
+    // test-18, daemon on a Unix socket: pipelined requests in one write,
+    // answered in order, including a parse error and an unknown DBMS ID
+    char socket_path_18[64];
+    snprintf(socket_path_18, sizeof(socket_path_18), "/tmp/c-substr-test-%ld.sock", (long)getpid());
+    substr_daemon *daemon_18 = substr_daemon_create(socket_path_18, dbms_substr_func_lib, 5, 2);
+    pthread_t daemon_thread_18;
+    if (!daemon_18 || pthread_create(&daemon_thread_18, NULL, test_daemon_run, daemon_18) != 0) {
+        printf("Test-18 daemon FAILED: cannot start\n");
+    } else {
+        struct {
+            const char *input;
+            int dbms_id;
+            FunctionStatus status;
+        } daemon_cases_18[5] = {
+            { test_inputs[0], DBMS_ORACLE,     RET_SUCCESS },
+            { test_inputs[0], DBMS_POSTGRESQL, SUBSTR_STARTPOS_NEGATIVE },
+            { test_inputs[1], DBMS_SQLSERVER,  RET_SUCCESS },
+            { "SUBSTR(col, 2",  DBMS_ORACLE,   FUNC_CALL_PARENS_MISMATCH },
+            { test_inputs[2], 7,               UNKNOWN_DBMS_ID },
+        };
+        unsigned char frames[1024];
+        size_t frames_len = 0;
+        for (int i = 0; i < 5; i++) {
+            size_t input_len = strlen(daemon_cases_18[i].input);
+            unsigned char *frame = frames + frames_len;
+            substr_daemon_put_u32(frame, (uint32_t)(SUBSTR_DAEMON_REQ_HEADER - 4 + input_len));
+            substr_daemon_put_u32(frame + 4, 100 + i);
+            frame[8] = (unsigned char)daemon_cases_18[i].dbms_id;
+            frame[9] = frame[10] = frame[11] = 0;
+            memcpy(frame + SUBSTR_DAEMON_REQ_HEADER, daemon_cases_18[i].input, input_len);
+            frames_len += SUBSTR_DAEMON_REQ_HEADER + input_len;
+        }
+
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strcpy(addr.sun_path, socket_path_18);
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        unsigned char replies[1024];
+        size_t replies_len = 0;
+        if (fd >= 0 && connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0
+            && write(fd, frames, frames_len) == (ssize_t)frames_len) {
+            // the daemon answers everything sent before the write side is shut down
+            shutdown(fd, SHUT_WR);
+            ssize_t n;
+            while ((n = read(fd, replies + replies_len, sizeof(replies) - replies_len)) > 0) {
+                replies_len += n;
+            }
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+
+        size_t pos = 0;
+        for (int i = 0; i < 5; i++) {
+            int ok = 0;
+            if (replies_len - pos >= SUBSTR_DAEMON_RESP_HEADER) {
+                size_t length = substr_daemon_get_u32(replies + pos);
+                uint32_t id   = substr_daemon_get_u32(replies + pos + 4);
+                FunctionStatus status = (int32_t)substr_daemon_get_u32(replies + pos + 8);
+                size_t out_len = length - (SUBSTR_DAEMON_RESP_HEADER - 4);
+                ok = id == (uint32_t)(100 + i) && status == daemon_cases_18[i].status;
+                if (ok && status == RET_SUCCESS) {
+                    char expected[256];
+                    size_t expected_len = 0;
+                    translate_substr_func(daemon_cases_18[i].input, &dbms_substr_func_lib[daemon_cases_18[i].dbms_id],
+                                          expected, sizeof(expected), &expected_len);
+                    ok = out_len == expected_len && memcmp(replies + pos + SUBSTR_DAEMON_RESP_HEADER, expected, out_len) == 0;
+                } else if (ok) {
+                    ok = out_len == 0;
+                }
+                pos += 4 + length;
+            }
+            printf(ok ? "Test-18 request %d passed.\n" : "Test-18 request %d FAILED\n", i);
+        }
+
+        substr_daemon_stop(daemon_18);
+        pthread_join(daemon_thread_18, NULL);
+    }
+    substr_daemon_destroy(daemon_18);
+
+    // the socket path is replaced only when it is a socket nobody listens on
+    {
+        FILE *file_18 = fopen(socket_path_18, "w");
+        int ok = file_18 && !substr_daemon_create(socket_path_18, dbms_substr_func_lib, 5, 1)
+              && access(socket_path_18, F_OK) == 0;
+        if (file_18) {
+            fclose(file_18);
+        }
+        unlink(socket_path_18);
+
+        struct sockaddr_un addr_18 = {0};
+        int fd_18 = socket(AF_UNIX, SOCK_STREAM, 0);
+        addr_18.sun_family = AF_UNIX;
+        memcpy(addr_18.sun_path, socket_path_18, strlen(socket_path_18) + 1);
+        ok = ok && fd_18 >= 0 && bind(fd_18, (struct sockaddr *)&addr_18, sizeof(addr_18)) == 0;
+        if (fd_18 >= 0) {
+            close(fd_18); // leaves a stale socket behind
+        }
+        substr_daemon *stale_18 = ok ? substr_daemon_create(socket_path_18, dbms_substr_func_lib, 5, 1) : NULL;
+        ok = ok && stale_18 && !substr_daemon_create(socket_path_18, dbms_substr_func_lib, 5, 1)
+           && access(socket_path_18, F_OK) == 0;
+        substr_daemon_destroy(stale_18);
+        ok = ok && access(socket_path_18, F_OK) != 0;
+        unlink(socket_path_18);
+        printf(ok ? "Test-18 socket path passed.\n" : "Test-18 socket path FAILED\n");
+    }
+
+    // test-19, dialect registry: lookup by name through the perfect hash,
+    // rejected configs keep the previous table, reloads under readers
+    const char *config_19 =
+        "# dialect  func_name  neg_start  shift_start\n"
+        "Oracle     substr     1  0\n"
+        "sqlserver  substring  1  0   # comment\n"
+        "\n"
+        "postgresql sbstr 0 0\n"
+        "mysql\tsstr\t0\t0\n"
+        "sqlite     SUBSTR     0  0";
+    const char *names_19[5] = { "oracle", "SQLSERVER", "PostgreSQL", "mysql", "sqlite" };
+    substr_registry *registry_19 = substr_registry_create();
+    char config_path_19[64];
+    snprintf(config_path_19, sizeof(config_path_19), "/tmp/c-substr-test-%ld.conf", (long)getpid());
+    FILE *config_file_19 = fopen(config_path_19, "w");
+    if (config_file_19) {
+        fputs(config_19, config_file_19);
+        fclose(config_file_19);
+    }
+    if (substr_registry_load_file(registry_19, config_path_19, NULL) != RET_SUCCESS) {
+        printf("Test-19 load FAILED\n");
+    }
+    remove(config_path_19);
+    for (int dbms_id = DBMS_ORACLE; dbms_id <= DBMS_SQLITE; dbms_id++) {
+        char expected[256], got[256];
+        size_t expected_len = 0, got_len = 0;
+        FunctionStatus rc_table = translate_substr_func(test_inputs[0], &dbms_substr_func_lib[dbms_id],
+                                                        expected, sizeof(expected), &expected_len);
+        FunctionStatus rc_named = translate_substr_func_dialect(registry_19, names_19[dbms_id], test_inputs[0],
+                                                                got, sizeof(got), &got_len);
+        int ok = rc_table == rc_named && (rc_table != RET_SUCCESS || strcmp(expected, got) == 0);
+        printf(ok ? "Test-19 dialect %s passed.\n" : "Test-19 dialect %s FAILED\n", names_19[dbms_id]);
+    }
+    {
+        char out[64];
+        size_t out_len = 0;
+        substr_diag diag = {0};
+        const char *bad_19 = "oracle substr 1 0\nsqlserver substring 2 0\n";
+        const char *dup_19 = "oracle substr 1 0\nORACLE substring 1 0\n";
+        int ok = translate_substr_func_dialect(registry_19, "db2", test_inputs[0], out, sizeof(out), &out_len) == UNKNOWN_DBMS_ID
+              && translate_substr_func_useID(test_inputs[0], DBMS_UNKNOWN, dbms_substr_func_lib, out, sizeof(out), &out_len) == UNKNOWN_DBMS_ID
+              && translate_substr_func_useID(test_inputs[0], -1, dbms_substr_func_lib, out, sizeof(out), &out_len) == UNKNOWN_DBMS_ID
+              && substr_registry_load_buffer(registry_19, bad_19, strlen(bad_19), &diag) == CONFIG_SYNTAX_ERR
+              && diag.offset == strlen("oracle substr 1 0\nsqlserver substring ")
+              && substr_registry_load_buffer(registry_19, dup_19, strlen(dup_19), &diag) == CONFIG_SYNTAX_ERR
+              && diag.offset == strlen("oracle substr 1 0\n")
+              && translate_substr_func_dialect(registry_19, "mysql", test_inputs[0], out, sizeof(out), &out_len) == SUBSTR_STARTPOS_NEGATIVE;
+        printf(ok ? "Test-19 unknown dialects and bad configs passed.\n" : "Test-19 unknown dialects and bad configs FAILED\n");
+    }
+    {
+        // many names, every one found in its own slot
+        char *config = malloc(1000 * 32);
+        size_t len = 0;
+        for (int i = 0; config && i < 1000; i++) {
+            len += sprintf(config + len, "dialect-%d substr %d %d\n", i, i % 2, i % 3);
+        }
+        int ok = config && substr_registry_load_buffer(registry_19, config, len, NULL) == RET_SUCCESS;
+        substr_registry_read rd;
+        substr_registry_enter(registry_19, &rd);
+        ok = ok && substr_registry_count(&rd) == 1000 && !substr_registry_find(&rd, "oracle", 6);
+        for (int i = 0; ok && i < 1000; i++) {
+            char name[32];
+            const substr_func_syntax *f_syntax = substr_registry_find(&rd, name, sprintf(name, "DIALECT-%d", i));
+            ok = f_syntax && f_syntax->neg_start == i % 2 && f_syntax->shift_start == i % 3;
+        }
+        substr_registry_exit(registry_19, &rd);
+        free(config);
+        printf(ok ? "Test-19 perfect hash passed.\n" : "Test-19 perfect hash FAILED\n");
+    }
+    {
+        const char *config_a = "target substr 1 0\n";
+        const char *config_b = "other sstr 0 0\ntarget substring 0 1\n";
+        pthread_t readers[2];
+        int started = 0;
+        substr_registry_load_buffer(registry_19, config_a, strlen(config_a), NULL);
+        for (int i = 0; i < 2; i++) {
+            started += pthread_create(&readers[i], NULL, test_registry_read, registry_19) == 0;
+        }
+        for (int i = 0; i < 200; i++) {
+            const char *config = i % 2 ? config_a : config_b;
+            substr_registry_load_buffer(registry_19, config, strlen(config), NULL);
+        }
+        long n_bad = started == 2 ? 0 : 1;
+        for (int i = 0; i < started; i++) {
+            void *bad;
+            pthread_join(readers[i], &bad);
+            n_bad += (long)bad;
+        }
+        printf(n_bad == 0 ? "Test-19 reload under readers passed.\n" : "Test-19 reload under readers FAILED\n");
+    }
+    {
+        // the daemon answers requests naming a dialect, and reloads its config
+        const char *config_a = "pg sbstr 0 0\n";
+        const char *config_b = "pg substring 1 0\nlite SUBSTR 0 0\n";
+        FILE *config_file = fopen(config_path_19, "w");
+        if (config_file) {
+            fputs(config_b, config_file);
+            fclose(config_file);
+        }
+        substr_registry_load_buffer(registry_19, config_a, strlen(config_a), NULL);
+        substr_daemon *daemon_19 = substr_daemon_create(socket_path_18, dbms_substr_func_lib, 5, 1);
+        pthread_t daemon_thread_19;
+        int ok = daemon_19 && substr_daemon_set_registry(daemon_19, registry_19, config_path_19, NULL) == RET_SUCCESS
+              && pthread_create(&daemon_thread_19, NULL, test_daemon_run, daemon_19) == 0;
+        if (ok) {
+            char out[128];
+            ok = test_daemon_request(socket_path_18, 2, SUBSTR_DAEMON_FLAG_DIALECT, "pgSUBSTR(a, 2, 3)", out, sizeof(out))
+                    == RET_SUCCESS && strcmp(out, "sbstr(a, 2, 3)") == 0
+              && test_daemon_request(socket_path_18, 4, SUBSTR_DAEMON_FLAG_DIALECT, "liteSUBSTR(a, 2)", out, sizeof(out))
+                    == UNKNOWN_DBMS_ID
+              && test_daemon_request(socket_path_18, 99, SUBSTR_DAEMON_FLAG_DIALECT, "pg", out, sizeof(out))
+                    == UNKNOWN_DBMS_ID
+              && test_daemon_request(socket_path_18, DBMS_SQLSERVER, 0, "SUBSTR(a, 2)", out, sizeof(out))
+                    == RET_SUCCESS && strcmp(out, "substring(a, 2)") == 0;
+
+            // the reload is done between two batches of the daemon thread
+            substr_daemon_reload(daemon_19);
+            FunctionStatus rc = UNKNOWN_DBMS_ID;
+            for (int i = 0; i < 1000 && rc == UNKNOWN_DBMS_ID; i++) {
+                rc = test_daemon_request(socket_path_18, 4, SUBSTR_DAEMON_FLAG_DIALECT, "liteSUBSTR(a, 2)",
+                                         out, sizeof(out));
+            }
+            ok = ok && rc == RET_SUCCESS && strcmp(out, "SUBSTR(a, 2)") == 0
+              && test_daemon_request(socket_path_18, 2, SUBSTR_DAEMON_FLAG_DIALECT, "pgSUBSTR(a, 2, 3)", out, sizeof(out))
+                    == RET_SUCCESS && strcmp(out, "substring(a, 2, 3)") == 0;
+            substr_daemon_stop(daemon_19);
+            pthread_join(daemon_thread_19, NULL);
+        }
+        substr_daemon_destroy(daemon_19);
+        remove(config_path_19);
+        printf(ok ? "Test-19 daemon dialects and reload passed.\n" : "Test-19 daemon dialects and reload FAILED\n");
+    }
+    substr_registry_destroy(registry_19);
+
+    // test-20, telemetry: counters per DBMS and status code summed over threads
+    {
+        substr_telemetry_snapshot before, after;
+        substr_telemetry_read(&before);
+
+        char out[256];
+        size_t out_len = 0, bytes_in = 0, bytes_out = 0;
+        translate_substr_func_useID(test_inputs[0], DBMS_ORACLE, dbms_substr_func_lib, out, sizeof(out), &out_len);
+        bytes_in += strlen(test_inputs[0]);
+        bytes_out += out_len;
+        translate_substr_func_useID(test_inputs[0], DBMS_POSTGRESQL, dbms_substr_func_lib, out, sizeof(out), &out_len);
+        bytes_in += strlen(test_inputs[0]);
+        translate_substr_func(test_inputs[1], &dbms_substr_func_lib[DBMS_SQLITE], out, sizeof(out), &out_len);
+        bytes_in += strlen(test_inputs[1]);
+        bytes_out += out_len;
+
+        const char *batch_inputs[3] = { test_inputs[0], "SUBSTR(x", test_inputs[2] };
+        int batch_ids[3] = { DBMS_SQLSERVER, DBMS_SQLSERVER, DBMS_MYSQL };
+        size_t batch_offsets[3], batch_lengths[3];
+        FunctionStatus batch_status[3];
+        translate_substr_batch(batch_inputs, batch_ids, 3, dbms_substr_func_lib, out, sizeof(out),
+                               batch_offsets, batch_lengths, batch_status);
+        for (int i = 0; i < 3; i++) {
+            bytes_in += strlen(batch_inputs[i]);
+            bytes_out += batch_lengths[i];
+        }
+
+        pthread_t workers[2];
+        test_telemetry_arg worker_arg = { test_inputs[2], dbms_substr_func_lib };
+        int started = 0;
+        for (int i = 0; i < 2; i++) {
+            started += pthread_create(&workers[i], NULL, test_telemetry_worker, &worker_arg) == 0;
+        }
+        for (int i = 0; i < started; i++) {
+            pthread_join(workers[i], NULL);
+        }
+        translate_substr_func_useID(test_inputs[2], DBMS_SQLITE, dbms_substr_func_lib, out, sizeof(out), &out_len);
+        bytes_in += (size_t)(started * 1000 + 1) * strlen(test_inputs[2]);
+        bytes_out += (size_t)(started * 1000 + 1) * out_len;
+
+        substr_telemetry_read(&after);
+        uint64_t timed = 0;
+        for (int b = 0; b < SUBSTR_TELEMETRY_BUCKETS; b++) {
+            timed += after.latency[0][b] - before.latency[0][b];
+        }
+#if SUBSTR_TELEMETRY
+        int ok = started == 2
+              && after.translations[DBMS_ORACLE]     - before.translations[DBMS_ORACLE]     == 1
+              && after.translations[DBMS_SQLSERVER]  - before.translations[DBMS_SQLSERVER]  == 2
+              && after.translations[DBMS_POSTGRESQL] - before.translations[DBMS_POSTGRESQL] == 1
+              && after.translations[DBMS_MYSQL]      - before.translations[DBMS_MYSQL]      == 1
+              && after.translations[DBMS_SQLITE]     - before.translations[DBMS_SQLITE]     == 2002
+              && after.translations[DBMS_UNKNOWN]    - before.translations[DBMS_UNKNOWN]    == 0
+              && after.status[0]  - before.status[0]  == 2005
+              && after.status[-SUBSTR_STARTPOS_NEGATIVE]  - before.status[-SUBSTR_STARTPOS_NEGATIVE]  == 1
+              && after.status[-FUNC_CALL_PARENS_MISMATCH] - before.status[-FUNC_CALL_PARENS_MISMATCH] == 1
+              && after.bytes_in  - before.bytes_in  == bytes_in
+              && after.bytes_out - before.bytes_out == bytes_out
+              && after.n_threads >= 3
+              && timed >= 2000 / SUBSTR_TELEMETRY_SAMPLE
+              && substr_telemetry_quantile(after.latency[0], 0.99) >= substr_telemetry_quantile(after.latency[0], 0.5);
+#else
+        // compiled out: nothing is recorded
+        substr_telemetry_snapshot zero;
+        memset(&zero, 0, sizeof(zero));
+        int ok = memcmp(&after, &zero, sizeof(zero)) == 0 && bytes_in > 0 && bytes_out > 0;
+#endif
+        printf(ok ? "Test-20 telemetry passed.\n" : "Test-20 telemetry FAILED\n");
+    }
+    {
+        // every translator counts under its target, size queries are not counted
+        const char *config = "oracle substr 1 0\nsqlserver substring 1 0\npostgresql sbstr 0 0\nmysql sstr 0 0\n";
+        const char *script = "SELECT SUBSTR(a, 1), SUBSTR(b, -1) FROM t;";
+        substr_registry *registry = substr_registry_create();
+        substr_cache *cache = substr_cache_create(64 * 1024);
+        substr_source_set sources = {0};
+        substr_rewriter rw;
+        test_sink_buffer sink_out = {{0}, 0};
+        substr_telemetry_snapshot before, after;
+        char out[256];
+        size_t out_len = 0, consumed = 0;
+        int ok = registry && cache && substr_registry_load_buffer(registry, config, strlen(config), NULL) == RET_SUCCESS
+              && substr_source_set_init(&sources, dbms_substr_func_lib, 5) == RET_SUCCESS;
+
+        substr_telemetry_read(&before);
+        translate_substr_func(test_inputs[1], &dbms_substr_func_lib[DBMS_ORACLE], NULL, 0, &out_len);
+        translate_substr_func_diag(test_inputs[1], &dbms_substr_func_lib[DBMS_ORACLE], out, sizeof(out), &out_len, NULL);
+        translate_substr_func_from(&sources, test_inputs[1], &dbms_substr_func_lib[DBMS_SQLSERVER], out, sizeof(out),
+                                   &out_len, NULL);
+        translate_substr_func_from(&sources, test_inputs[1], &dbms_substr_func_lib[DBMS_SQLSERVER], NULL, 0,
+                                   &out_len, NULL);
+        translate_substr_func_cached(cache, test_inputs[1], &dbms_substr_func_lib[DBMS_POSTGRESQL], out, sizeof(out), &out_len);
+        translate_substr_func_cached(cache, test_inputs[1], &dbms_substr_func_lib[DBMS_POSTGRESQL], out, sizeof(out), &out_len);
+        translate_substr_func_dialect(registry, "MySQL", test_inputs[1], out, sizeof(out), &out_len);
+        substr_rewriter_init(&rw, &dbms_substr_func_lib[DBMS_SQLITE], test_sink, &sink_out);
+        ok = ok && substr_rewrite_feed(&rw, script, strlen(script), 1, &consumed) == RET_SUCCESS;
+        substr_telemetry_read(&after);
+#if SUBSTR_TELEMETRY
+        ok = ok && after.translations[DBMS_ORACLE]     - before.translations[DBMS_ORACLE]     == 1
+                && after.translations[DBMS_SQLSERVER]  - before.translations[DBMS_SQLSERVER]  == 1
+                && after.translations[DBMS_POSTGRESQL] - before.translations[DBMS_POSTGRESQL] == 2
+                && after.translations[DBMS_MYSQL]      - before.translations[DBMS_MYSQL]      == 1
+                && after.translations[DBMS_SQLITE]     - before.translations[DBMS_SQLITE]     == 2
+                && after.translations[DBMS_UNKNOWN]    - before.translations[DBMS_UNKNOWN]    == 0
+                && after.status[0] - before.status[0] == 6
+                && after.status[-SUBSTR_STARTPOS_NEGATIVE] - before.status[-SUBSTR_STARTPOS_NEGATIVE] == 1
+                && after.bytes_in - before.bytes_in == 5 * strlen(test_inputs[1]) + strlen("SUBSTR(a, 1)")
+                                                       + strlen("SUBSTR(b, -1)");
+#endif
+        substr_source_set_destroy(&sources);
+        substr_cache_destroy(cache);
+        substr_registry_destroy(registry);
+        printf(ok ? "Test-20 telemetry keys passed.\n" : "Test-20 telemetry keys FAILED\n");
+    }
+
+    {
+        // a registry dialect counts under the DBMS_ID of its name, wherever it sits in the config
+        const char *configs[2] = { "mysql sstr 0 0\nmy-db substr 1 0\nOracle substr 1 0\n",
+                                   "oracle substr 1 0\nmysql sstr 0 0\nmy-db substr 1 0\n" };
+        substr_registry *registry = substr_registry_create();
+        substr_telemetry_snapshot before, after;
+        char out[256];
+        size_t out_len = 0;
+        int ok = registry != NULL;
+        for (int c = 0; ok && c < 2; c++) {
+            ok = substr_registry_load_buffer(registry, configs[c], strlen(configs[c]), NULL) == RET_SUCCESS;
+            substr_telemetry_read(&before);
+            translate_substr_func_dialect(registry, "oracle", test_inputs[1], out, sizeof(out), &out_len);
+            translate_substr_func_dialect(registry, "MY-DB", test_inputs[1], out, sizeof(out), &out_len);
+            translate_substr_func_dialect(registry, "mysql", test_inputs[1], out, sizeof(out), &out_len);
+            substr_telemetry_read(&after);
+#if SUBSTR_TELEMETRY
+            ok = ok && after.translations[DBMS_ORACLE]     - before.translations[DBMS_ORACLE]     == 1
+                    && after.translations[DBMS_SQLSERVER]  - before.translations[DBMS_SQLSERVER]  == 0
+                    && after.translations[DBMS_POSTGRESQL] - before.translations[DBMS_POSTGRESQL] == 0
+                    && after.translations[DBMS_MYSQL]      - before.translations[DBMS_MYSQL]      == 1
+                    && after.translations[DBMS_UNKNOWN]    - before.translations[DBMS_UNKNOWN]    == 1;
+#endif
+        }
+        substr_registry_destroy(registry);
+        printf(ok ? "Test-20 registry keys passed.\n" : "Test-20 registry keys FAILED\n");
+    }
+
+    // test-21, incremental document: random edits, each patch keeps the output equal to a full rewrite
+    {
+        static const char *lines_21[] = {
+            "SELECT SUBSTR(col_a, 2, 3) FROM t;\n",
+            "-- SUBSTR(x, 1) in a comment\n",
+            "WHERE name = 'it''s SUBSTR(q, 1)';\n",
+            "/* block SUBSTR(b, 1, 2) */ SELECT substr(\"txt\", -1, 4);\n",
+            "UPDATE t SET c = mysubstr(c, 1), d = SUBSTR (d, 1);\n",
+            "SELECT SUBSTR(SUBSTR(c, 2), 1, 2), SUBSTR(e, 1, 0) FROM u;\n",
+        };
+        static const char *inserts_21[] = {
+            "'", "\"", "--", "/*", "*/", "\n", "(", ")", ",", " ", "x", "s", "substr", "SUBSTR(",
+            "SUBSTR(k, 2, 1)", "substr (m, 3)", "'SUBSTR(n, 1)'",
+        };
+        const substr_func_syntax *f_syntax_21 = &dbms_substr_func_lib[DBMS_SQLSERVER];
+        uint32_t seed_21 = 21;
+        size_t src_len = 0, src_cap = 1 << 17;
+        char *src = malloc(src_cap);
+        for (int i = 0; src && i < 2000; i++) {
+            seed_21 = seed_21 * 1103515245 + 12345;
+            const char *line = lines_21[(seed_21 >> 16) % 6];
+            memcpy(src + src_len, line, strlen(line));
+            src_len += strlen(line);
+        }
+
+        int ok = src != NULL;
+        substr_doc *doc = ok ? substr_doc_create(f_syntax_21, src, src_len) : NULL;
+        test_grow_buffer patched = { NULL, 0, 0 }, full = { NULL, 0, 0 };
+        size_t rendered_len = 0;
+        char *rendered = NULL;
+        substr_doc_stats stats;
+        ok = ok && doc && substr_doc_render(doc, NULL, 0, &rendered_len) == RET_SUCCESS;
+        if (ok) {
+            patched.cap = rendered_len * 2 + 1;
+            patched.data = malloc(patched.cap);
+            ok = patched.data && substr_doc_render(doc, patched.data, patched.cap, &patched.used) == RET_SUCCESS;
+        }
+
+        // a local edit far from quotes and comments rescans about one checkpoint
+        const char *word = ok ? strstr(src + src_len / 2, "FROM t;") : NULL;
+        substr_doc_patch patch;
+        if (word) {
+            size_t at = word - src + 1;
+            ok = substr_doc_edit(doc, at, 0, "x", 1, &patch) == RET_SUCCESS
+              && substr_doc_edit(doc, at, 1, "", 0, &patch) == RET_SUCCESS;
+            substr_doc_get_stats(doc, &stats);
+            ok = ok && stats.last_rescan <= 2 * SUBSTR_DOC_CHECKPOINT && patch.removed == 1 && patch.text_len == 0;
+        }
+        ok = ok && word && substr_doc_edit(doc, src_len + 1, 0, "", 0, &patch) == EDIT_OUT_OF_RANGE;
+
+        for (int e = 0; ok && e < 500; e++) {
+            seed_21 = seed_21 * 1103515245 + 12345;
+            size_t offset = (seed_21 >> 8) % (src_len + 1);
+            seed_21 = seed_21 * 1103515245 + 12345;
+            size_t removed = (seed_21 >> 16) % 9;
+            removed = removed > src_len - offset ? src_len - offset : removed;
+            seed_21 = seed_21 * 1103515245 + 12345;
+            const char *text = (seed_21 >> 16) % 4 == 0 ? "" : inserts_21[(seed_21 >> 8) % 17];
+            size_t text_len = strlen(text);
+
+            if (src_len - removed + text_len > src_cap) {
+                break;
+            }
+            memmove(src + offset + text_len, src + offset + removed, src_len - offset - removed);
+            memcpy(src + offset, text, text_len);
+            src_len = src_len - removed + text_len;
+
+            ok = substr_doc_edit(doc, offset, removed, text, text_len, &patch) == RET_SUCCESS
+              && patch.offset + patch.removed <= patched.used;
+            if (!ok) {
+                break;
+            }
+
+            // apply the patch to the output kept since the document was created
+            if (patched.used - patch.removed + patch.text_len + 1 > patched.cap) {
+                patched.cap = (patched.used - patch.removed + patch.text_len + 1) * 2;
+                char *grown = realloc(patched.data, patched.cap);
+                if (!grown) {
+                    ok = 0;
+                    break;
+                }
+                patched.data = grown;
+            }
+            memmove(patched.data + patch.offset + patch.text_len, patched.data + patch.offset + patch.removed,
+                    patched.used - patch.offset - patch.removed);
+            memcpy(patched.data + patch.offset, patch.text, patch.text_len);
+            patched.used = patched.used - patch.removed + patch.text_len;
+
+            if (e % 50 != 49) {
+                continue;
+            }
+            full.used = 0;
+            substr_rewriter rw;
+            size_t consumed = 0;
+            substr_rewriter_init(&rw, f_syntax_21, test_grow_sink, &full);
+            substr_doc_get_stats(doc, &stats);
+            free(rendered);
+            rendered = malloc(stats.output_len + 1);
+            ok = rendered
+              && substr_rewrite_feed(&rw, src, src_len, 1, &consumed) == RET_SUCCESS
+              && substr_doc_render(doc, rendered, stats.output_len + 1, &rendered_len) == RET_SUCCESS
+              && rendered_len == full.used && patched.used == full.used
+              && memcmp(rendered, full.data, full.used) == 0
+              && memcmp(patched.data, full.data, full.used) == 0
+              && stats.n_calls == rw.n_calls && stats.n_translated == rw.n_translated;
+        }
+        printf(ok ? "Test-21 document edits passed.\n" : "Test-21 document edits FAILED\n");
+        substr_doc_destroy(doc);
+        free(src);
+        free(rendered);
+        free(patched.data);
+        free(full.data);
+    }
+
+    // test-22, one scan applies a table of rewrite rules: names, argument order,
+    // index shift and negative positions, fed whole and in 1 to 16 byte chunks
+    {
+        substr_rule rules_22[] = {
+            SUBSTR_RULE("substr", "substr", 2, 3, NULL, SUBSTR_RULE_ARG(1), 0, SUBSTR_NEG_ALLOW),
+            SUBSTR_RULE("LENGTH", "LEN", 1, 1, NULL, 0, 0, SUBSTR_NEG_ALLOW),
+            SUBSTR_RULE("INSTR", "CHARINDEX", 2, 3, "102", SUBSTR_RULE_ARG(2), 0, SUBSTR_NEG_REJECT),
+            SUBSTR_RULE("LEFT", "LEFT", 2, 2, NULL, 0, 0, SUBSTR_NEG_ALLOW),
+            SUBSTR_RULE("RIGHT", "RIGHT", 2, 2, NULL, 0, 0, SUBSTR_NEG_ALLOW),
+        };
+        substr_rule_from_syntax(&dbms_substr_func_lib[DBMS_SQLSERVER], &rules_22[0]);
+        const char *script_22 =
+            "SELECT SUBSTR(name, 2, 3), length(name), Instr(name, 'a, b'), LEFT(x, 2) -- INSTR(y, 'z')\n"
+            "FROM t WHERE INSTR(LENGTH(a), SUBSTR(b, 1), 2) > 0 AND instr(a, 'x', -1) = 0 /* LENGTH(a) */"
+            " AND length(a, b) = 1 AND mylength(c) = RIGHT ('it''s', 1);";
+        const char *expected_22 =
+            "SELECT substring(name, 2, 3), LEN(name), CHARINDEX('a, b', name), LEFT(x, 2) -- INSTR(y, 'z')\n"
+            "FROM t WHERE CHARINDEX(substring(b, 1), LEN(a), 2) > 0 AND instr(a, 'x', -1) = 0 /* LENGTH(a) */"
+            " AND length(a, b) = 1 AND mylength(c) = RIGHT('it''s', 1);";
+        substr_rule_set set_22;
+        int ok = substr_rule_set_init(&set_22, rules_22, sizeof(rules_22) / sizeof(rules_22[0])) == RET_SUCCESS;
+
+        for (size_t chunk = 0; ok && chunk <= 16; chunk++) {
+            test_sink_buffer sink_out = {{0}, 0};
+            substr_rewriter rw;
+            substr_rewriter_init_rules(&rw, &set_22, test_sink, &sink_out);
+
+            char held[512];
+            size_t held_len = 0, pos = 0, total = strlen(script_22);
+            FunctionStatus rc = RET_SUCCESS;
+            do {
+                size_t take = chunk == 0 ? total - pos : (total - pos < chunk ? total - pos : chunk);
+                memcpy(held + held_len, script_22 + pos, take);
+                held_len += take;
+                pos += take;
+
+                size_t consumed = 0;
+                rc = substr_rewrite_feed(&rw, held, held_len, pos == total, &consumed);
+                memmove(held, held + consumed, held_len - consumed);
+                held_len -= consumed;
+            } while (rc == RET_SUCCESS && pos < total);
+
+            ok = rc == RET_SUCCESS && held_len == 0 && strcmp(sink_out.data, expected_22) == 0
+              && rw.n_calls == 10 && rw.n_translated == 8;
+            if (!ok) {
+                printf("Test-22 chunk %zu output %s\n", chunk, sink_out.data);
+            }
+        }
+        substr_rule_set_destroy(&set_22);
+        printf(ok ? "Test-22 rule table rewrite passed.\n" : "Test-22 rule table rewrite FAILED\n");
+
+        // positions of a 0-based target: constants are shifted, expressions get the shift appended
+        substr_rule zero_based_22[] = {
+            SUBSTR_RULE("SUBSTR", "slice", 2, 3, NULL, SUBSTR_RULE_ARG(1), -1, SUBSTR_NEG_ALLOW),
+        };
+        test_sink_buffer zero_out = {{0}, 0};
+        substr_rewriter rw_zero;
+        size_t consumed = 0;
+        ok = substr_rule_set_init(&set_22, zero_based_22, 1) == RET_SUCCESS;
+        substr_rewriter_init_rules(&rw_zero, &set_22, test_sink, &zero_out);
+        ok = ok && substr_rewrite_feed(&rw_zero, "SUBSTR(a, 3, 2) || SUBSTR(a, i + 1) || substr(t.a, n)", 53, 1,
+                                       &consumed) == RET_SUCCESS
+           && strcmp(zero_out.data, "slice(a, 2, 2) || slice(a, (i + 1) - 1) || slice(t.a, n - 1)") == 0;
+        substr_rule_set_destroy(&set_22);
+        printf(ok ? "Test-22 index shift passed.\n" : "Test-22 index shift FAILED\n");
+
+        // tables that cannot be compiled
+        substr_rule bad_22[][2] = {
+            { SUBSTR_RULE("left", "LEFT", 2, 2, NULL, 0, 0, SUBSTR_NEG_ALLOW),
+              SUBSTR_RULE("LEFT", "LEFT", 2, 2, NULL, 0, 0, SUBSTR_NEG_ALLOW) },
+            { SUBSTR_RULE("INSTR", "CHARINDEX", 2, 3, "112", 0, 0, SUBSTR_NEG_ALLOW),
+              SUBSTR_RULE("LEN", "LEN", 1, 1, NULL, 0, 0, SUBSTR_NEG_ALLOW) },
+            { SUBSTR_RULE("INSTR", "CHARINDEX", 3, 2, NULL, 0, 0, SUBSTR_NEG_ALLOW),
+              SUBSTR_RULE("LEN", "LEN", 1, 1, NULL, SUBSTR_RULE_ARG(1), 0, SUBSTR_NEG_ALLOW) },
+        };
+        ok = 1;
+        for (size_t t = 0; t < sizeof(bad_22) / sizeof(bad_22[0]); t++) {
+            ok = ok && substr_rule_set_init(&set_22, bad_22[t], 2) == CONFIG_SYNTAX_ERR;
+        }
+        printf(ok ? "Test-22 invalid tables passed.\n" : "Test-22 invalid tables FAILED\n");
+
+        // the rule made from a substr_func_syntax rewrites like the SUBSTR rewriter
+        const char *calls_22 = "SELECT SUBSTR(a, 2, 3), substr(\"b\", -1), Substr(c, 0) FROM t;";
+        ok = 1;
+        for (int dbms_id = DBMS_ORACLE; dbms_id < DBMS_UNKNOWN; dbms_id++) {
+            substr_rule from_syntax_22;
+            test_sink_buffer by_syntax = {{0}, 0}, by_rule = {{0}, 0};
+            substr_rewriter rw_syntax, rw_rule;
+            substr_rule_from_syntax(&dbms_substr_func_lib[dbms_id], &from_syntax_22);
+            ok = ok && substr_rule_set_init(&set_22, &from_syntax_22, 1) == RET_SUCCESS;
+            substr_rewriter_init(&rw_syntax, &dbms_substr_func_lib[dbms_id], test_sink, &by_syntax);
+            substr_rewriter_init_rules(&rw_rule, &set_22, test_sink, &by_rule);
+            ok = ok && substr_rewrite_feed(&rw_syntax, calls_22, strlen(calls_22), 1, &consumed) == RET_SUCCESS
+               && substr_rewrite_feed(&rw_rule, calls_22, strlen(calls_22), 1, &consumed) == RET_SUCCESS
+               && strcmp(by_syntax.data, by_rule.data) == 0 && rw_syntax.n_translated == rw_rule.n_translated;
+            substr_rule_set_destroy(&set_22);
+        }
+        printf(ok ? "Test-22 rule from syntax passed.\n" : "Test-22 rule from syntax FAILED\n");
+
+        // a method or a schema function of the same name is left alone
+        substr_rule length_22[] = {
+            SUBSTR_RULE("LENGTH", "LEN", 1, 1, NULL, 0, 0, SUBSTR_NEG_ALLOW),
+        };
+        test_sink_buffer length_out = {{0}, 0};
+        substr_rewriter rw_length;
+        ok = substr_rule_set_init(&set_22, length_22, 1) == RET_SUCCESS;
+        substr_rewriter_init_rules(&rw_length, &set_22, test_sink, &length_out);
+        ok = ok && substr_rewrite_feed(&rw_length, "x.length(y) + app.LENGTH(y) + length(y)", 39, 1,
+                                       &consumed) == RET_SUCCESS
+           && strcmp(length_out.data, "x.length(y) + app.LENGTH(y) + LEN(y)") == 0 && rw_length.n_translated == 1;
+        substr_rule_set_destroy(&set_22);
+        printf(ok ? "Test-22 qualified names passed.\n" : "Test-22 qualified names FAILED\n");
+    }
+
+    // test-23, interned column names: equal names share one handle, across threads too
+    {
+        substr_intern *pool_23 = substr_intern_create();
+        substr_func parsed_a = {0}, parsed_b = {0}, gen_a = {0}, gen_b = {0};
+        int ok = pool_23 != NULL
+              && parse_substr_call_intern(pool_23, "SUBSTR(customer_name, 2, 3)", &parsed_a) == RET_SUCCESS
+              && parse_substr_call_intern(pool_23, "substr(customer_name, -1)", &parsed_b) == RET_SUCCESS
+              && parsed_a.col_name == parsed_b.col_name && strcmp(parsed_a.col_name, "customer_name") == 0
+              && substr_intern_len(parsed_a.col_name) == 13
+              && gen_substr_func_intern(pool_23, &dbms_substr_func_lib[DBMS_ORACLE], &parsed_a, &gen_a) == RET_SUCCESS
+              && gen_substr_func_intern(pool_23, &dbms_substr_func_lib[DBMS_ORACLE], &parsed_b, &gen_b) == RET_SUCCESS
+              && gen_a.col_name == parsed_a.col_name && gen_a.func_name == gen_b.func_name
+              && gen_substr_func_intern(pool_23, &dbms_substr_func_lib[DBMS_MYSQL], &parsed_b, &gen_b)
+                    == SUBSTR_STARTPOS_NEGATIVE
+              && substr_intern_ident(pool_23, "customer", 8) != parsed_a.col_name
+              && substr_intern_ident(pool_23, "", 0) == substr_intern_ident(pool_23, NULL, 0);
+        char out_23[64];
+        ok = ok && gen_substr_cmd(&gen_a, out_23, sizeof(out_23)) > 0 && strcmp(out_23, "substr(customer_name, 2, 3)") == 0;
+
+        substr_intern_stats stats;
+        substr_intern_get_stats(pool_23, &stats);
+        ok = ok && stats.n_idents == 4 && stats.ident_bytes == 13 + 6 + 8;
+        printf(ok ? "Test-23 interned names passed.\n" : "Test-23 interned names FAILED\n");
+
+        // four threads intern the same names in different orders while the tables grow
+        static test_intern_arg workers_23[4];
+        pthread_t threads_23[4];
+        int started = 0;
+        for (int i = 0; pool_23 && i < 4; i++) {
+            memset(&workers_23[i], 0, sizeof(workers_23[i]));
+            workers_23[i].pool = pool_23;
+            workers_23[i].seed = 1 + 1237 * i;
+            started += pthread_create(&threads_23[i], NULL, test_intern_worker, &workers_23[i]) == 0;
+        }
+        ok = started == 4;
+        for (int i = 0; i < started; i++) {
+            pthread_join(threads_23[i], NULL);
+            ok = ok && workers_23[i].n_bad == 0;
+        }
+        for (int k = 0; ok && k < TEST_INTERN_NAMES; k++) {
+            ok = workers_23[0].handles[k] == workers_23[1].handles[k] && workers_23[0].handles[k] == workers_23[2].handles[k]
+              && workers_23[0].handles[k] == workers_23[3].handles[k];
+        }
+        substr_intern_get_stats(pool_23, &stats);
+        ok = ok && stats.n_idents == 4 + TEST_INTERN_NAMES;
+        printf(ok ? "Test-23 concurrent interning passed.\n" : "Test-23 concurrent interning FAILED\n");
+        substr_intern_destroy(pool_23);
+    }
+
+    // test-24, the source dialect is recognized by its function name in any case and
+    // positions go from its index base to the target's in the same pass
+    {
+        substr_source_set dbms_sources_24;
+        int ok = substr_source_set_init(&dbms_sources_24, dbms_substr_func_lib, 5) == RET_SUCCESS
+              && substr_source_find(&dbms_sources_24, "SUBSTRING", 9) == DBMS_SQLSERVER
+              && substr_source_find(&dbms_sources_24, "Sbstr", 5) == DBMS_POSTGRESQL
+              && substr_source_find(&dbms_sources_24, "sstr", 4) == DBMS_MYSQL
+              && substr_source_find(&dbms_sources_24, "substr", 6) == DBMS_ORACLE   // SQLite's SUBSTR, same base
+              && substr_source_find(&dbms_sources_24, "subst", 5) == -1
+              && substr_source_find(&dbms_sources_24, "substrs", 7) == -1
+              && substr_source_find(&dbms_sources_24, "", 0) == -1;
+        substr_source_set_destroy(&dbms_sources_24);
+        printf(ok ? "Test-24 function name trie passed.\n" : "Test-24 function name trie FAILED\n");
+
+        // a 0-based source and target next to 1-based ones
+        substr_func_syntax dialects_24[] = {
+            SUBSTR_SYNTAX("substr",    1,  0),
+            SUBSTR_SYNTAX("substring", 0,  0),
+            SUBSTR_SYNTAX("slice",     1, -1),
+        };
+        struct {
+            const char *input ;
+            int target        ;
+            FunctionStatus rc ;
+            int source        ;
+            const char *output;
+        } cases_24[] = {
+            { "slice(name, 0, 3)",         0, RET_SUCCESS, 2, "substr(name, 1, 3)" },
+            { "SUBSTRING(name, 2)",        2, RET_SUCCESS, 1, "slice(name, 1)" },
+            { " Substr (\"a, b\", -2, 1)", 1, SUBSTR_STARTPOS_NEGATIVE, 0, NULL },
+            { "SLICE(x, 4, 2)",            1, RET_SUCCESS, 2, "substring(x, 5, 2)" },
+            { "mid(x, 1, 2)",              0, UNKNOWN_FUNC_NAME, -1, NULL },
+            { "(x, 1, 2)",                 0, UNKNOWN_FUNC_NAME, -1, NULL },
+            { "SUBSTR\n(a, 1)",             2, RET_SUCCESS, 0, "slice(a, 0)" },
+            { "\r\n\tsubstring\r\n(a, 1)",     0, RET_SUCCESS, 1, "substr(a, 1)" },
+        };
+        substr_source_set sources_24;
+        ok = substr_source_set_init(&sources_24, dialects_24, 3) == RET_SUCCESS;
+        for (size_t i = 0; ok && i < sizeof(cases_24) / sizeof(cases_24[0]); i++) {
+            char out[64];
+            size_t out_len = 0;
+            int source = -1;
+            FunctionStatus rc = translate_substr_func_from(&sources_24, cases_24[i].input, &dialects_24[cases_24[i].target],
+                                                           out, sizeof(out), &out_len, &source);
+            ok = rc == cases_24[i].rc && source == cases_24[i].source
+              && (rc != RET_SUCCESS || (strcmp(out, cases_24[i].output) == 0 && out_len == strlen(out)));
+            if (!ok) {
+                printf("Test-24 case %zu: rc %d, source %d\n", i, rc, source);
+            }
+        }
+        substr_source_set_destroy(&sources_24);
+
+        // one name cannot have two index bases
+        substr_func_syntax ambiguous_24[] = { SUBSTR_SYNTAX("substr", 1, 0), SUBSTR_SYNTAX("SUBSTR", 0, -1) };
+        ok = ok && substr_source_set_init(&sources_24, ambiguous_24, 2) == CONFIG_SYNTAX_ERR;
+        printf(ok ? "Test-24 any-to-any translation passed.\n" : "Test-24 any-to-any translation FAILED\n");
+    }
+
     // for (int i = 0; i < 3; i++) {
     //     printf("  Input: %s\n", test_inputs[i]);
 
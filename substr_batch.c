@@ -0,0 +1,162 @@
+#include "substr_batch.h"
+#include "substr_telemetry.h"
+
+/* 
+    parsed elements of a block of inputs, held struct-of-arrays so that
+    the syntax conversion runs as one tight loop over the block.
+    All fields used by the loop are 64-bit wide so it stays in one vector type. */
+typedef struct substr_batch_block_struct {
+    const substr_func_syntax *syntax [SUBSTR_BATCH_BLOCK];  /* target of each input, NULL if unknown */
+    substr_view col_name    [SUBSTR_BATCH_BLOCK];
+    long int start_pos      [SUBSTR_BATCH_BLOCK];
+    long int length         [SUBSTR_BATCH_BLOCK];
+    long int shift_start    [SUBSTR_BATCH_BLOCK];
+    unsigned long deny_neg  [SUBSTR_BATCH_BLOCK];  /* 1 if target does not allow negative start */
+    unsigned long rejected  [SUBSTR_BATCH_BLOCK];  /* 1 if start_pos was negative but not allowed */
+    size_t input_len        [SUBSTR_BATCH_BLOCK];  /* for the telemetry */
+    FunctionStatus status   [SUBSTR_BATCH_BLOCK];
+} substr_batch_block;
+
+/* 
+    the neg_start/shift_start rules of gen_substr_func, applied to a whole block.
+    Always runs over the full block with no branches, so the compiler vectorizes
+    it with plain SSE2 (logical shift, and, add). */
+static void batch_apply_syntax(long int *restrict start_pos, const long int *restrict shift_start,
+                        const unsigned long *restrict deny_neg, unsigned long *restrict rejected)
+{
+    for (size_t i = 0; i < SUBSTR_BATCH_BLOCK; i++) {
+        rejected[i]   = ((unsigned long)start_pos[i] >> (sizeof(long int) * CHAR_BIT - 1)) & deny_neg[i];
+        start_pos[i] += shift_start[i];
+    }
+}
+
+/* 
+    write one translated function call to the arena at *arena_used.
+    return RET_SUCCESS or TOO_SHORT_OUTPUT_BUFFER */
+static FunctionStatus batch_emit(const substr_func_syntax *f_syntax, const char *input_str, const substr_view *col_name,
+                        long int start_pos, long int length,
+                        char *arena, size_t arena_len, size_t *arena_used, size_t *out_offset, size_t *out_length)
+{
+    if (*arena_used >= arena_len) {
+        return TOO_SHORT_OUTPUT_BUFFER; // Error: arena is full
+    }
+
+    substr_func_ref f_ref;
+    f_ref.func_name     = f_syntax->func_name;
+    f_ref.func_name_len = f_syntax->func_name_len ? f_syntax->func_name_len : strlen(f_syntax->func_name);
+    f_ref.col_name      = input_str + col_name->offset;
+    f_ref.col_name_len  = col_name->length;
+    f_ref.start_pos     = start_pos;
+    f_ref.length        = length;
+
+    long int written = gen_substr_cmd_ref(&f_ref, arena + *arena_used, arena_len - *arena_used);
+    if (written <= 0) {
+        return written; // Error: arena is full
+    }
+
+    *out_offset  = *arena_used;
+    *out_length  = written;
+    *arena_used += written + 1;     // keep the null terminator
+
+    return RET_SUCCESS;
+}
+
+/* 
+    translate a batch of substr function calls into one output arena.
+    Inputs are processed SUBSTR_BATCH_BLOCK at a time: parse the block into
+    struct-of-arrays fields, convert all of them in one loop, then emit.
+    The target of an input is f_syntaxes[i] if given, else f_syntax[DBMS_ids[i]].
+    Nothing is allocated.
+*/
+static FunctionStatus batch_translate(const char *const *input_strs, const int *DBMS_ids, size_t n_inputs,
+                        const substr_func_syntax *f_syntax, const substr_func_syntax *const *f_syntaxes,
+                        char *arena, size_t arena_len,
+                        size_t *out_offsets, size_t *out_lengths, FunctionStatus *out_status)
+{
+    FunctionStatus rc = RET_SUCCESS;
+    size_t arena_used = 0;
+    substr_batch_block block = {0};
+
+    for (size_t base = 0; base < n_inputs; base += SUBSTR_BATCH_BLOCK) {
+        size_t n = n_inputs - base;
+        if (n > SUBSTR_BATCH_BLOCK) {
+            n = SUBSTR_BATCH_BLOCK;
+        }
+
+        // parse
+        SUBSTR_TELEMETRY_TIMER(timer);
+        for (size_t i = 0; i < n; i++) {
+            const char *input_str = input_strs[base + i];
+            int DBMS_id = DBMS_ids ? DBMS_ids[base + i] : DBMS_UNKNOWN;
+            const substr_func_syntax *syntax = f_syntaxes ? f_syntaxes[base + i]
+                                             : DBMS_id >= DBMS_ORACLE && DBMS_id < DBMS_UNKNOWN ? f_syntax + DBMS_id
+                                             : NULL;
+            substr_func_view f_view = {0};
+
+            block.input_len[i] = input_str ? strlen(input_str) : 0;
+            block.status[i] = !input_str ? NULL_INPUT_POINTER
+                            : !syntax    ? UNKNOWN_DBMS_ID
+                            : parse_substr_call_view(input_str, block.input_len[i], &f_view);
+            block.syntax[i]      = syntax;
+            block.col_name[i]    = f_view.col_name;
+            block.start_pos[i]   = f_view.start_pos;
+            block.length[i]      = f_view.length;
+            block.shift_start[i] = syntax ? syntax->shift_start : 0;
+            block.deny_neg[i]    = syntax ? syntax->neg_start <= 0 : 0;
+        }
+
+        SUBSTR_TELEMETRY_LAP(timer, SUBSTR_STAGE_PARSE, n);
+
+        // convert
+        batch_apply_syntax(block.start_pos, block.shift_start, block.deny_neg, block.rejected);
+        SUBSTR_TELEMETRY_LAP(timer, SUBSTR_STAGE_GENERATE, n);
+
+        // emit
+        for (size_t i = 0; i < n; i++) {
+            size_t k = base + i;
+            out_offsets[k] = 0;
+            out_lengths[k] = 0;
+
+            if (block.status[i] == RET_SUCCESS && block.rejected[i]) {
+                block.status[i] = SUBSTR_STARTPOS_NEGATIVE;
+            }
+            if (block.status[i] == RET_SUCCESS) {
+                block.status[i] = batch_emit(block.syntax[i], input_strs[k], &block.col_name[i],
+                                             block.start_pos[i], block.length[i],
+                                             arena, arena_len, &arena_used, &out_offsets[k], &out_lengths[k]);
+            }
+
+            out_status[k] = block.status[i];
+            if (rc == RET_SUCCESS && out_status[k] != RET_SUCCESS) {
+                rc = out_status[k];
+            }
+            SUBSTR_TELEMETRY_COUNT(DBMS_ids ? DBMS_ids[k] : DBMS_UNKNOWN, out_status[k], block.input_len[i],
+                                   out_lengths[k]);
+        }
+        SUBSTR_TELEMETRY_LAP(timer, SUBSTR_STAGE_EMIT, n);
+    }
+
+    return rc;
+}
+
+FunctionStatus translate_substr_batch(const char *const *input_strs, const int *DBMS_ids, size_t n_inputs,
+                        const substr_func_syntax *f_syntax, char *arena, size_t arena_len,
+                        size_t *out_offsets, size_t *out_lengths, FunctionStatus *out_status)
+{
+    if (!input_strs || !DBMS_ids || !f_syntax || !arena || !out_offsets || !out_lengths || !out_status) {
+        return NULL_INPUT_POINTER; // Error: Null pointer
+    }
+    return batch_translate(input_strs, DBMS_ids, n_inputs, f_syntax, NULL, arena, arena_len,
+                           out_offsets, out_lengths, out_status);
+}
+
+FunctionStatus translate_substr_batch_syntax(const char *const *input_strs, const substr_func_syntax *const *f_syntaxes,
+                        const int *DBMS_ids, size_t n_inputs, char *arena, size_t arena_len,
+                        size_t *out_offsets, size_t *out_lengths, FunctionStatus *out_status)
+{
+    if (!input_strs || !f_syntaxes || !arena || !out_offsets || !out_lengths || !out_status) {
+        return NULL_INPUT_POINTER; // Error: Null pointer
+    }
+    return batch_translate(input_strs, DBMS_ids, n_inputs, NULL, f_syntaxes, arena, arena_len,
+                           out_offsets, out_lengths, out_status);
+}
@@ -0,0 +1,31 @@
+#ifndef __substr_batch_h__
+#define __substr_batch_h__
+
+#include "substr_wrapper.h"
+
+// number of inputs parsed and converted together, struct-of-arrays style
+#define SUBSTR_BATCH_BLOCK 64
+
+// Given
+//    input_strs:  n_inputs substr function call strings,
+//    DBMS_ids:    ID of the target DBMS of each input, below DBMS_UNKNOWN;
+//                 other IDs get UNKNOWN_DBMS_ID in out_status
+//    f_syntax:    library for syntax conversion
+//    arena:       one output buffer shared by all outputs
+//    out_offsets: offset of each output string inside arena
+//    out_lengths: length of each output string, null terminator excluded
+//    out_status:  status of each input, a failed input does not stop the others
+// return: RET_SUCCESS if all inputs are translated, otherwise the status of
+//         the first failed input
+FunctionStatus translate_substr_batch(const char *const *input_strs, const int *DBMS_ids, size_t n_inputs,
+                        const substr_func_syntax *f_syntax, char *arena, size_t arena_len,
+                        size_t *out_offsets, size_t *out_lengths, FunctionStatus *out_status);
+
+// Same as translate_substr_batch with one target per input, e.g. dialects
+// found in a registry: input i is translated with f_syntaxes[i], NULL gives
+// UNKNOWN_DBMS_ID. DBMS_ids (may be NULL) only key the telemetry counts
+FunctionStatus translate_substr_batch_syntax(const char *const *input_strs, const substr_func_syntax *const *f_syntaxes,
+                        const int *DBMS_ids, size_t n_inputs, char *arena, size_t arena_len,
+                        size_t *out_offsets, size_t *out_lengths, FunctionStatus *out_status);
+
+#endif // __substr_batch_h__
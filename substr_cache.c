@@ -0,0 +1,316 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <pthread.h>
+
+#include "substr_cache.h"
+#include "substr_telemetry.h"
+
+/* 
+    one cached translation. seq is odd while a writer updates the entry;
+    readers copy without locking and retry as a miss if seq changed. */
+typedef struct cache_slot_struct {
+    uint64_t seq        ;
+    uint64_t hash       ;
+    uint16_t key_len    ;   /* 0 if the slot is empty */
+    uint16_t val_len    ;
+    int16_t  status     ;   /* cached result of the translation */
+    uint8_t  referenced ;   /* CLOCK bit, set by readers on a hit */
+    uint8_t  pad        ;
+    char     data[SUBSTR_CACHE_SLOT - 24];  /* key, then the output */
+} cache_slot;
+
+/* 
+    a set of SUBSTR_CACHE_WAYS entries. Only writers take the lock;
+    the counters are per set so readers of other sets never share them */
+typedef struct cache_set_struct {
+    cache_slot slots[SUBSTR_CACHE_WAYS];
+    pthread_mutex_t lock ;
+    unsigned hand        ;  /* CLOCK hand */
+    size_t hits, misses, inserts, evictions, bypassed;
+} cache_set;
+
+struct substr_cache_struct {
+    cache_set *sets ;
+    size_t n_sets   ;       /* power of two */
+};
+
+#define CACHE_KEY_MAX  (sizeof(((cache_slot *)0)->data))
+
+/* 
+    FNV-1a over the key */
+static uint64_t cache_hash(const char *key, size_t len)
+{
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)key[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+/* 
+    key = target syntax rules + input bytes, so tables with the same rules
+    share entries. return the key length, or 0 if it does not fit */
+static size_t cache_make_key(const char *input_str, const substr_func_syntax *f_syntax, char *key)
+{
+    size_t name_len  = f_syntax->func_name_len ? f_syntax->func_name_len : strlen(f_syntax->func_name);
+    size_t input_len = strlen(input_str);
+    size_t len = 2 * sizeof(int) + name_len + 1 + input_len;
+
+    if (len > CACHE_KEY_MAX) {
+        return 0;
+    }
+
+    memcpy(key, &f_syntax->neg_start, sizeof(int));
+    memcpy(key + sizeof(int), &f_syntax->shift_start, sizeof(int));
+    memcpy(key + 2 * sizeof(int), f_syntax->func_name, name_len + 1);
+    memcpy(key + 2 * sizeof(int) + name_len + 1, input_str, input_len);
+    return len;
+}
+
+/* 
+    look the key up without locking.
+    return 1 on a hit with the output copied to out_substr_string */
+static int cache_lookup(cache_set *set, uint64_t hash, const char *key, size_t key_len,
+                        char *out_substr_string, size_t out_str_len, size_t *out_str_wrt, FunctionStatus *rc)
+{
+    for (int way = 0; way < SUBSTR_CACHE_WAYS; way++) {
+        cache_slot *slot = &set->slots[way];
+
+        uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        if ((seq & 1) || slot->hash != hash || slot->key_len != key_len
+            || memcmp(slot->data, key, key_len) != 0) {
+            continue;
+        }
+
+        FunctionStatus status = slot->status;
+        size_t val_len = slot->val_len;
+        if (val_len > CACHE_KEY_MAX - key_len) {
+            val_len = CACHE_KEY_MAX - key_len; // torn read of an entry being rewritten, seq tells
+        }
+        if (status == RET_SUCCESS) {
+            if (val_len >= out_str_len) {
+                status = TOO_SHORT_OUTPUT_BUFFER;
+            } else {
+                memcpy(out_substr_string, slot->data + key_len, val_len);
+                out_substr_string[val_len] = '\0';
+            }
+        }
+
+        // the entry was rewritten while it was being read
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq) {
+            return 0;
+        }
+
+        __atomic_store_n(&slot->referenced, 1, __ATOMIC_RELAXED);
+        if (status == RET_SUCCESS) {
+            out_str_wrt[0] = val_len;
+        }
+        *rc = status;
+        return 1;
+    }
+    return 0;
+}
+
+/* 
+    store a translation, replacing the first entry of the set whose CLOCK
+    bit is clear. Entries found referenced get a second chance. */
+static void cache_insert(cache_set *set, uint64_t hash, const char *key, size_t key_len,
+                        const char *value, size_t val_len, FunctionStatus status)
+{
+    pthread_mutex_lock(&set->lock);
+
+    // another thread may have inserted it after our lookup
+    for (int way = 0; way < SUBSTR_CACHE_WAYS; way++) {
+        cache_slot *slot = &set->slots[way];
+        if (slot->key_len == key_len && slot->hash == hash && memcmp(slot->data, key, key_len) == 0) {
+            pthread_mutex_unlock(&set->lock);
+            return;
+        }
+    }
+
+    cache_slot *victim = NULL;
+    for (int step = 0; step < 2 * SUBSTR_CACHE_WAYS && !victim; step++) {
+        cache_slot *slot = &set->slots[set->hand];
+        set->hand = (set->hand + 1) % SUBSTR_CACHE_WAYS;
+
+        if (slot->key_len == 0 || !__atomic_load_n(&slot->referenced, __ATOMIC_RELAXED)) {
+            victim = slot;
+        } else {
+            __atomic_store_n(&slot->referenced, 0, __ATOMIC_RELAXED);
+        }
+    }
+
+    if (victim->key_len != 0) {
+        set->evictions++;
+    }
+    set->inserts++;
+
+    uint64_t seq = victim->seq;
+    __atomic_store_n(&victim->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    victim->hash       = hash;
+    victim->key_len    = key_len;
+    victim->val_len    = val_len;
+    victim->status     = status;
+    victim->referenced = 0;
+    memcpy(victim->data, key, key_len);
+    memcpy(victim->data + key_len, value, val_len);
+
+    __atomic_store_n(&victim->seq, seq + 2, __ATOMIC_RELEASE);
+
+    pthread_mutex_unlock(&set->lock);
+}
+
+substr_cache *substr_cache_create(size_t mem_budget)
+{
+    if (mem_budget < sizeof(substr_cache) + sizeof(cache_set)) {
+        return NULL; // Error: budget cannot hold one set
+    }
+
+    substr_cache *cache = calloc(1, sizeof(*cache));
+    if (!cache) {
+        return NULL;
+    }
+
+    // largest power of two number of sets within the budget, the same
+    // total as substr_cache_get_stats reports in mem_bytes
+    size_t sets_budget = mem_budget - sizeof(*cache);
+    cache->n_sets = 1;
+    while (cache->n_sets * 2 * sizeof(cache_set) <= sets_budget) {
+        cache->n_sets *= 2;
+    }
+
+    cache->sets = calloc(cache->n_sets, sizeof(cache_set));
+    if (!cache->sets) {
+        free(cache);
+        return NULL;
+    }
+    for (size_t i = 0; i < cache->n_sets; i++) {
+        pthread_mutex_init(&cache->sets[i].lock, NULL);
+    }
+    return cache;
+}
+
+void substr_cache_destroy(substr_cache *cache)
+{
+    if (!cache) {
+        return;
+    }
+    for (size_t i = 0; i < cache->n_sets; i++) {
+        pthread_mutex_destroy(&cache->sets[i].lock);
+    }
+    free(cache->sets);
+    free(cache);
+}
+
+void substr_cache_get_stats(const substr_cache *cache, substr_cache_stats *stats)
+{
+    if (!stats) {
+        return;
+    }
+    memset(stats, 0, sizeof(*stats));
+    if (!cache) {
+        return;
+    }
+
+    for (size_t i = 0; i < cache->n_sets; i++) {
+        const cache_set *set = &cache->sets[i];
+        stats->hits      += __atomic_load_n(&set->hits, __ATOMIC_RELAXED);
+        stats->misses    += __atomic_load_n(&set->misses, __ATOMIC_RELAXED);
+        stats->inserts   += __atomic_load_n(&set->inserts, __ATOMIC_RELAXED);
+        stats->evictions += __atomic_load_n(&set->evictions, __ATOMIC_RELAXED);
+        stats->bypassed  += __atomic_load_n(&set->bypassed, __ATOMIC_RELAXED);
+    }
+    stats->n_entries = cache->n_sets * SUBSTR_CACHE_WAYS;
+    stats->mem_bytes = sizeof(*cache) + cache->n_sets * sizeof(cache_set);
+}
+
+/*
+    translate through the cache: a hit copies the stored output, a miss
+    translates into a slot-sized buffer and stores the result. Outputs that
+    only fail because the caller's buffer is short are never stored.
+    Hits and misses are counted once in the telemetry under DBMS_id.
+*/
+static FunctionStatus cache_translate(substr_cache *cache, const char *input_str, const substr_func_syntax *f_syntax,
+                        int DBMS_id, char *out_substr_string, size_t out_str_len, size_t *out_str_wrt)
+{
+    if (!cache) {
+        return translate_substr_func_counted(input_str, f_syntax, DBMS_id, out_substr_string, out_str_len,
+                                             out_str_wrt, NULL);
+    }
+    if (!input_str || !f_syntax || !f_syntax->func_name || !out_substr_string || out_str_len == 0 || !out_str_wrt) {
+        return NULL_INPUT_POINTER; // Error: Null pointer or zero length
+    }
+
+    char key[CACHE_KEY_MAX];
+    size_t key_len = cache_make_key(input_str, f_syntax, key);
+    if (key_len == 0) {
+        __atomic_fetch_add(&cache->sets[0].bypassed, 1, __ATOMIC_RELAXED);
+        return translate_substr_func_counted(input_str, f_syntax, DBMS_id, out_substr_string, out_str_len,
+                                             out_str_wrt, NULL);
+    }
+
+    uint64_t hash = cache_hash(key, key_len);
+    cache_set *set = &cache->sets[hash & (cache->n_sets - 1)];
+
+    FunctionStatus rc;
+    if (cache_lookup(set, hash, key, key_len, out_substr_string, out_str_len, out_str_wrt, &rc)) {
+        __atomic_fetch_add(&set->hits, 1, __ATOMIC_RELAXED);
+        SUBSTR_TELEMETRY_COUNT(DBMS_id, rc, strlen(input_str), rc == RET_SUCCESS ? out_str_wrt[0] : 0);
+        return rc;
+    }
+    __atomic_fetch_add(&set->misses, 1, __ATOMIC_RELAXED);
+
+    char value[CACHE_KEY_MAX];
+    size_t val_len = 0;
+    rc = translate_substr_func_counted(input_str, f_syntax, SUBSTR_TELEMETRY_NONE, value,
+                                       CACHE_KEY_MAX - key_len + 1, &val_len, NULL);
+    if (rc == TOO_SHORT_OUTPUT_BUFFER) {
+        __atomic_fetch_add(&set->bypassed, 1, __ATOMIC_RELAXED);
+        return translate_substr_func_counted(input_str, f_syntax, DBMS_id, out_substr_string, out_str_len,
+                                             out_str_wrt, NULL);
+    }
+    if (rc == MEMORY_ALLOCATION_ERR) {
+        SUBSTR_TELEMETRY_COUNT(DBMS_id, rc, strlen(input_str), 0);
+        return rc;  // not a property of the input, do not remember it
+    }
+    if (rc != RET_SUCCESS) {
+        val_len = 0;
+    }
+
+    cache_insert(set, hash, key, key_len, value, val_len, rc);
+
+    if (rc == RET_SUCCESS && val_len >= out_str_len) {
+        rc = TOO_SHORT_OUTPUT_BUFFER;
+    } else if (rc == RET_SUCCESS) {
+        memcpy(out_substr_string, value, val_len + 1);
+        out_str_wrt[0] = val_len;
+    }
+    SUBSTR_TELEMETRY_COUNT(DBMS_id, rc, strlen(input_str), rc == RET_SUCCESS ? val_len : 0);
+    return rc;
+}
+
+FunctionStatus translate_substr_func_cached(substr_cache *cache, const char *input_str, const substr_func_syntax *f_syntax,
+                        char *out_substr_string, size_t out_str_len, size_t *out_str_wrt)
+{
+    return cache_translate(cache, input_str, f_syntax, substr_telemetry_key(f_syntax),
+                           out_substr_string, out_str_len, out_str_wrt);
+}
+
+FunctionStatus translate_substr_func_useID_cached(substr_cache *cache, const char *input_str, const int DBMS_id,
+                        const substr_func_syntax *f_syntax,
+                        char *out_substr_string, size_t out_str_len, size_t *out_str_wrt)
+{
+    if (!f_syntax) {
+        return NULL_INPUT_POINTER; // Error: Null pointer
+    }
+    if (DBMS_id < DBMS_ORACLE || DBMS_id >= DBMS_UNKNOWN) {
+        return UNKNOWN_DBMS_ID;
+    }
+    return cache_translate(cache, input_str, f_syntax + DBMS_id, DBMS_id,
+                           out_substr_string, out_str_len, out_str_wrt);
+}
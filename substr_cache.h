@@ -0,0 +1,47 @@
+#ifndef __substr_cache_h__
+#define __substr_cache_h__
+
+#include "substr_wrapper.h"
+
+// entries per hash set, replaced in CLOCK order
+#define SUBSTR_CACHE_WAYS  8
+// bytes of one entry: header, target syntax, input and output must fit,
+// longer translations are not cached
+#define SUBSTR_CACHE_SLOT  256
+
+typedef struct substr_cache_struct substr_cache;
+
+// counters of a cache, summed over all sets when read
+typedef struct substr_cache_stats_struct {
+    size_t hits      ;  /* translations answered from the cache */
+    size_t misses    ;  /* translations computed and offered to the cache */
+    size_t inserts   ;  /* entries written */
+    size_t evictions ;  /* entries replaced by a newer one */
+    size_t bypassed  ;  /* translations too long to be cached */
+    size_t n_entries ;  /* capacity in entries */
+    size_t mem_bytes ;  /* memory used by the cache */
+} substr_cache_stats;
+
+// create a cache using at most mem_budget bytes, NULL if out of memory or if
+// the budget cannot hold one set of SUBSTR_CACHE_WAYS entries (a little more
+// than SUBSTR_CACHE_WAYS * SUBSTR_CACHE_SLOT bytes)
+substr_cache *substr_cache_create(size_t mem_budget);
+
+// release a cache, no translation may be using it
+void substr_cache_destroy(substr_cache *cache);
+
+// read the hit/miss counters, safe while other threads use the cache
+void substr_cache_get_stats(const substr_cache *cache, substr_cache_stats *stats);
+
+// same as translate_substr_func, answered from the cache when the same input
+// was translated for the same syntax before. cache may be NULL.
+// Lookups take no lock, only inserts lock the one set they write to.
+FunctionStatus translate_substr_func_cached(substr_cache *cache, const char *input_str, const substr_func_syntax *f_syntax,
+                        char *out_substr_string, size_t out_str_len, size_t *out_str_wrt);
+
+// same as translate_substr_func_useID, through the cache
+FunctionStatus translate_substr_func_useID_cached(substr_cache *cache, const char *input_str, const int DBMS_id,
+                        const substr_func_syntax *f_syntax,
+                        char *out_substr_string, size_t out_str_len, size_t *out_str_wrt);
+
+#endif // __substr_cache_h__
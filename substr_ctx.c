@@ -0,0 +1,123 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "substr_ctx.h"
+
+// alignment of every arena allocation
+#define ARENA_ALIGN  (sizeof(long double) > sizeof(void *) ? sizeof(long double) : sizeof(void *))
+
+/* 
+    one block of the bump arena, the data follows the header */
+struct substr_arena_block_struct {
+    substr_arena_block *next ;
+    size_t size ;
+    long double align_data[];   /* start of the data, aligned for any type */
+};
+
+void substr_ctx_init(substr_ctx *ctx, const substr_allocator *allocator)
+{
+    if (!ctx) {
+        return;
+    }
+    memset(ctx, 0, sizeof(*ctx));
+    if (allocator) {
+        ctx->allocator = *allocator;
+    }
+}
+
+void substr_ctx_reset(substr_ctx *ctx)
+{
+    if (!ctx) {
+        return;
+    }
+    ctx->current = ctx->first;
+    ctx->used    = 0;
+}
+
+void substr_ctx_destroy(substr_ctx *ctx)
+{
+    if (!ctx) {
+        return;
+    }
+    substr_arena_block *block = ctx->first;
+    while (block) {
+        substr_arena_block *next = block->next;
+        free(block);
+        block = next;
+    }
+    ctx->first   = NULL;
+    ctx->current = NULL;
+    ctx->used    = 0;
+}
+
+/* 
+    bump allocation: use the rest of the current block, then the kept
+    blocks after it, and only then ask malloc for a new one */
+static void *arena_alloc(substr_ctx *ctx, size_t size)
+{
+    size = (size + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+
+    while (ctx->current) {
+        if (ctx->current->size - ctx->used >= size) {
+            void *ptr = (char *)ctx->current->align_data + ctx->used;
+            ctx->used += size;
+            return ptr;
+        }
+        if (!ctx->current->next) {
+            break;
+        }
+        ctx->current = ctx->current->next;
+        ctx->used    = 0;
+    }
+
+    size_t block_size = size > SUBSTR_ARENA_BLOCK ? size : SUBSTR_ARENA_BLOCK;
+    substr_arena_block *block = malloc(sizeof(*block) + block_size);
+    if (!block) {
+        return NULL;
+    }
+    block->next = NULL;
+    block->size = block_size;
+    ctx->n_sys_allocs++;
+    ctx->n_sys_bytes += block_size;
+
+    if (ctx->current) {
+        ctx->current->next = block;
+    } else {
+        ctx->first = block;
+    }
+    ctx->current = block;
+    ctx->used    = size;
+    return block->align_data;
+}
+
+void *substr_ctx_alloc(substr_ctx *ctx, size_t size)
+{
+    if (!ctx) {
+        return NULL;
+    }
+
+    void *ptr = ctx->allocator.alloc ? ctx->allocator.alloc(ctx->allocator.pool, size)
+                                     : arena_alloc(ctx, size);
+    if (ptr) {
+        ctx->n_allocs++;
+        ctx->n_bytes += size;
+    }
+    return ptr;
+}
+
+void substr_ctx_release(substr_ctx *ctx, void *ptr, size_t size)
+{
+    if (ctx && ptr && ctx->allocator.alloc && ctx->allocator.release) {
+        ctx->allocator.release(ctx->allocator.pool, ptr, size);
+    }
+}
+
+char *substr_ctx_strndup(substr_ctx *ctx, const char *str, size_t len)
+{
+    char *copy = substr_ctx_alloc(ctx, len + 1);
+    if (copy) {
+        memcpy(copy, str, len);
+        copy[len] = '\0';
+    }
+    return copy;
+}
@@ -0,0 +1,53 @@
+#ifndef __substr_ctx_h__
+#define __substr_ctx_h__
+
+#include <stddef.h>
+
+// size of the blocks the default arena takes from malloc
+#define SUBSTR_ARENA_BLOCK  (64 * 1024)
+
+// allocator hook, for callers that bring their own pool.
+// release may be NULL if the pool frees everything at once
+typedef struct substr_allocator_struct {
+    void *(*alloc)(void *pool, size_t size);
+    void  (*release)(void *pool, void *ptr, size_t size);
+    void  *pool;
+} substr_allocator;
+
+typedef struct substr_arena_block_struct substr_arena_block;
+
+// translation context: every allocation of the *_ctx functions goes
+// through it. Use one context per thread.
+typedef struct substr_ctx_struct {
+    substr_allocator allocator ;    /* alloc is NULL for the default bump arena */
+
+    substr_arena_block *first  ;    /* arena blocks, kept across resets */
+    substr_arena_block *current;
+    size_t used                ;    /* bytes used in the current block */
+
+    size_t n_allocs       ;         /* allocations requested from the context */
+    size_t n_bytes        ;         /* bytes requested from the context */
+    size_t n_sys_allocs   ;         /* blocks the arena took from malloc */
+    size_t n_sys_bytes    ;
+} substr_ctx;
+
+// set up a context, allocator NULL selects the default bump arena
+void substr_ctx_init(substr_ctx *ctx, const substr_allocator *allocator);
+
+// release everything allocated since the last reset at once; arena blocks
+// are kept, so a steady state of same-sized batches takes no memory from malloc
+void substr_ctx_reset(substr_ctx *ctx);
+
+// return the arena blocks to malloc
+void substr_ctx_destroy(substr_ctx *ctx);
+
+// allocate size bytes, aligned for any type, NULL if out of memory
+void *substr_ctx_alloc(substr_ctx *ctx, size_t size);
+
+// give back one allocation; a no-op for the arena, which frees on reset
+void substr_ctx_release(substr_ctx *ctx, void *ptr, size_t size);
+
+// copy len chars of str into the context, null-terminated
+char *substr_ctx_strndup(substr_ctx *ctx, const char *str, size_t len);
+
+#endif // __substr_ctx_h__
@@ -0,0 +1,722 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "substr_daemon.h"
+#include "substr_batch.h"
+#include "substr_pool.h"
+#include "substr_registry.h"
+#include "substr_telemetry.h"
+
+// events taken from epoll per wake-up
+#define DAEMON_MAX_EVENTS  64
+// bytes read from one connection per wake-up, level-triggered epoll brings the rest
+#define DAEMON_READ_QUOTA  (256 * 1024)
+#define DAEMON_READ_CHUNK  (64 * 1024)
+
+/*
+    a client connection: bytes read but not parsed yet, responses not sent yet */
+typedef struct daemon_conn_struct {
+    int fd ;
+    char  *in ;
+    size_t in_len, in_cap ;
+    char  *out ;
+    size_t out_len, out_sent, out_cap ;
+    size_t n_queued ;       /* requests of the current batch */
+    int reading ;           /* EPOLLIN is enabled */
+    int writing ;           /* EPOLLOUT is enabled */
+    int eof ;               /* the peer sent everything, close once answered */
+    int closing ;           /* close once the current batch is answered */
+    struct daemon_conn_struct *prev, *next ;    /* all connections */
+    struct daemon_conn_struct *next_closing ;
+} daemon_conn;
+
+// bytes written to the control pipe by substr_daemon_stop and substr_daemon_reload
+#define DAEMON_CMD_STOP    0
+#define DAEMON_CMD_RELOAD  1
+
+// slot of a request with an unknown DBMS ID, answered without translating it
+#define DAEMON_NO_SLOT  ((size_t)-1)
+
+/*
+    one request of a batch, the input is a null-terminated copy in the batch arena */
+typedef struct {
+    daemon_conn *conn ;
+    uint32_t request_id ;
+    size_t slot ;           /* index in the translate_substr_batch arrays */
+} daemon_request;
+
+struct substr_daemon_struct {
+    int listen_fd ;
+    int epoll_fd ;
+    int stop_pipe[2] ;
+    char *socket_path ;
+    int bound ;             /* socket_path is ours to unlink */
+    const substr_func_syntax *f_syntax ;
+    size_t n_syntax ;
+    substr_pool *pool ;
+
+    // dialects of the named requests, see substr_daemon_set_registry
+    substr_registry *registry ;
+    char *config_path ;         /* reloaded by substr_daemon_reload, may be NULL */
+    substr_diag *reload_diag ;
+    substr_registry_read rd ;   /* read section of the current batch */
+    int reading_registry ;      /* rd is open */
+
+    // current batch, struct-of-arrays for translate_substr_batch
+    substr_ctx arena ;      /* inputs and outputs, reset per batch */
+    size_t n_requests, cap_requests ;
+    daemon_request *requests ;
+    size_t n_inputs ;       /* requests with a known DBMS ID */
+    const char **inputs ;
+    int *ids ;
+    const substr_func_syntax **syntaxes ;   /* target of each input */
+    size_t *offsets, *lengths ;
+    FunctionStatus *status ;
+    char **task_out ;       /* output arena of each task */
+    size_t *task_out_len ;
+    size_t n_tasks ;
+
+    daemon_conn *conns ;    /* open connections */
+    daemon_conn *closing ;  /* connections closed while a batch used them */
+};
+
+void substr_daemon_put_u32(unsigned char *p, uint32_t v)
+{
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+uint32_t substr_daemon_get_u32(const unsigned char *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static int set_nonblocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL);
+    return flags < 0 ? -1 : fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+/*
+    grow *buf to hold at least need bytes. return 0 if success, -1 if out of memory */
+static int reserve(char **buf, size_t *cap, size_t need)
+{
+    if (need <= *cap) {
+        return 0;
+    }
+    size_t new_cap = *cap ? *cap : 4096;
+    while (new_cap < need) {
+        new_cap *= 2;
+    }
+    char *grown = realloc(*buf, new_cap);
+    if (!grown) {
+        return -1;
+    }
+    *buf = grown;
+    *cap = new_cap;
+    return 0;
+}
+
+/*
+    enable the events a connection needs: reading unless too many responses
+    are waiting, writing while any are */
+static void conn_update_events(substr_daemon *daemon, daemon_conn *conn)
+{
+    size_t pending = conn->out_len - conn->out_sent;
+    int reading = !conn->eof && pending < SUBSTR_DAEMON_MAX_PENDING;
+    int writing = pending > 0;
+    if (reading == conn->reading && writing == conn->writing) {
+        return;
+    }
+
+    struct epoll_event ev = {0};
+    ev.events   = (reading ? EPOLLIN : 0) | (writing ? EPOLLOUT : 0);
+    ev.data.ptr = conn;
+    epoll_ctl(daemon->epoll_fd, EPOLL_CTL_MOD, conn->fd, &ev);
+    conn->reading = reading;
+    conn->writing = writing;
+}
+
+/*
+    defer the close to the end of the batch, the batch may point to conn */
+static void conn_close(substr_daemon *daemon, daemon_conn *conn)
+{
+    if (conn->closing) {
+        return;
+    }
+    conn->closing = 1;
+    epoll_ctl(daemon->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+    conn->next_closing = daemon->closing;
+    daemon->closing = conn;
+}
+
+static void conn_free_closed(substr_daemon *daemon)
+{
+    while (daemon->closing) {
+        daemon_conn *conn = daemon->closing;
+        daemon->closing = conn->next_closing;
+        if (conn->prev) {
+            conn->prev->next = conn->next;
+        } else {
+            daemon->conns = conn->next;
+        }
+        if (conn->next) {
+            conn->next->prev = conn->prev;
+        }
+        close(conn->fd);
+        free(conn->in);
+        free(conn->out);
+        free(conn);
+    }
+}
+
+/*
+    send what the socket takes without blocking */
+static void conn_flush(substr_daemon *daemon, daemon_conn *conn)
+{
+    while (conn->out_sent < conn->out_len) {
+        ssize_t n = send(conn->fd, conn->out + conn->out_sent, conn->out_len - conn->out_sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                conn_close(daemon, conn);
+                return;
+            }
+            break;
+        }
+        conn->out_sent += n;
+    }
+    if (conn->out_sent == conn->out_len) {
+        conn->out_sent = conn->out_len = 0;
+        if (conn->eof && conn->n_queued == 0) {
+            conn_close(daemon, conn);
+            return;
+        }
+    }
+    conn_update_events(daemon, conn);
+}
+
+static void daemon_accept(substr_daemon *daemon)
+{
+    for (;;) {
+        int fd = accept(daemon->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            return;     // EAGAIN: no more pending connections
+        }
+        daemon_conn *conn = calloc(1, sizeof(*conn));
+        if (!conn || set_nonblocking(fd) != 0) {
+            free(conn);
+            close(fd);
+            continue;
+        }
+        conn->fd = fd;
+        conn->reading = 1;
+        conn->next = daemon->conns;
+        if (daemon->conns) {
+            daemon->conns->prev = conn;
+        }
+        daemon->conns = conn;
+
+        struct epoll_event ev = {0};
+        ev.events   = EPOLLIN;
+        ev.data.ptr = conn;
+        if (epoll_ctl(daemon->epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            conn->closing = 1;
+            conn->next_closing = daemon->closing;
+            daemon->closing = conn;
+        }
+    }
+}
+
+/*
+    make room for one more request in the batch arrays.
+    return 0 if success, -1 if out of memory */
+static int batch_reserve(substr_daemon *daemon)
+{
+    if (daemon->n_requests < daemon->cap_requests) {
+        return 0;
+    }
+    size_t cap = daemon->cap_requests ? daemon->cap_requests * 2 : 256;
+    daemon_request *requests = realloc(daemon->requests, cap * sizeof(*requests));
+    if (requests) {
+        daemon->requests = requests;
+    }
+    const char **inputs = realloc(daemon->inputs, cap * sizeof(*inputs));
+    if (inputs) {
+        daemon->inputs = inputs;
+    }
+    int *ids = realloc(daemon->ids, cap * sizeof(*ids));
+    if (ids) {
+        daemon->ids = ids;
+    }
+    const substr_func_syntax **syntaxes = realloc(daemon->syntaxes, cap * sizeof(*syntaxes));
+    if (syntaxes) {
+        daemon->syntaxes = syntaxes;
+    }
+    size_t *offsets = realloc(daemon->offsets, cap * sizeof(*offsets));
+    if (offsets) {
+        daemon->offsets = offsets;
+    }
+    size_t *lengths = realloc(daemon->lengths, cap * sizeof(*lengths));
+    if (lengths) {
+        daemon->lengths = lengths;
+    }
+    FunctionStatus *status = realloc(daemon->status, cap * sizeof(*status));
+    if (status) {
+        daemon->status = status;
+    }
+    size_t n_tasks = (cap + SUBSTR_BATCH_BLOCK - 1) / SUBSTR_BATCH_BLOCK;
+    char **task_out = realloc(daemon->task_out, n_tasks * sizeof(*task_out));
+    if (task_out) {
+        daemon->task_out = task_out;
+    }
+    size_t *task_out_len = realloc(daemon->task_out_len, n_tasks * sizeof(*task_out_len));
+    if (task_out_len) {
+        daemon->task_out_len = task_out_len;
+    }
+    if (!requests || !inputs || !ids || !syntaxes || !offsets || !lengths || !status || !task_out || !task_out_len) {
+        return -1;
+    }
+    daemon->cap_requests = cap;
+    return 0;
+}
+
+/*
+    target of a request, the DBMS_id field is either an index in f_syntax or,
+    with SUBSTR_DAEMON_FLAG_DIALECT, the length of the dialect name that
+    starts the input. The registry entries found stay valid until the batch
+    is answered. NULL if unknown */
+static const substr_func_syntax *daemon_find_syntax(substr_daemon *daemon, unsigned field, unsigned flags,
+                        const char **input, size_t *input_len)
+{
+    if (!(flags & SUBSTR_DAEMON_FLAG_DIALECT)) {
+        return field < daemon->n_syntax ? &daemon->f_syntax[field] : NULL;
+    }
+    if (!daemon->registry || field > *input_len) {
+        return NULL;
+    }
+    if (!daemon->reading_registry) {
+        substr_registry_enter(daemon->registry, &daemon->rd);
+        daemon->reading_registry = 1;
+    }
+    const substr_func_syntax *f_syntax = substr_registry_find(&daemon->rd, *input, field);
+    *input     += field;
+    *input_len -= field;
+    return f_syntax;
+}
+
+/*
+    move the complete frames of a connection into the batch.
+    return 0 if success, -1 on a protocol error or out of memory */
+static int conn_parse_frames(substr_daemon *daemon, daemon_conn *conn)
+{
+    size_t pos = 0;
+    int rc = 0;
+
+    while (conn->in_len - pos >= 4) {
+        const unsigned char *frame = (const unsigned char *)conn->in + pos;
+        uint32_t length = substr_daemon_get_u32(frame);
+        if (length < SUBSTR_DAEMON_REQ_HEADER - 4 || length > SUBSTR_DAEMON_MAX_FRAME) {
+            rc = -1;
+            break;
+        }
+        if (conn->in_len - pos < 4 + (size_t)length) {
+            break;      // rest of the frame not read yet
+        }
+
+        size_t input_len = length - (SUBSTR_DAEMON_REQ_HEADER - 4);
+        char *input = substr_ctx_alloc(&daemon->arena, input_len + 1);
+        if (!input || batch_reserve(daemon) != 0) {
+            rc = -1;
+            break;
+        }
+        memcpy(input, frame + SUBSTR_DAEMON_REQ_HEADER, input_len);
+        input[input_len] = '\0';
+
+        unsigned dbms_id = frame[8] | frame[9] << 8;
+        unsigned flags   = frame[10] | frame[11] << 8;
+        const char *call = input;
+        const substr_func_syntax *f_syntax = daemon_find_syntax(daemon, dbms_id, flags, &call, &input_len);
+        size_t k = daemon->n_requests++;
+        daemon->requests[k].conn       = conn;
+        daemon->requests[k].request_id = substr_daemon_get_u32(frame + 4);
+        daemon->requests[k].slot       = DAEMON_NO_SLOT;
+        if (f_syntax) {
+            size_t slot = daemon->n_inputs++;
+            daemon->requests[k].slot = slot;
+            daemon->inputs[slot]   = call;
+            daemon->syntaxes[slot] = f_syntax;
+            daemon->ids[slot]      = flags & SUBSTR_DAEMON_FLAG_DIALECT ? DBMS_UNKNOWN : (int)dbms_id;
+        } else {
+            SUBSTR_TELEMETRY_COUNT(DBMS_UNKNOWN, UNKNOWN_DBMS_ID, input_len, 0);
+        }
+        conn->n_queued++;
+
+        pos += 4 + (size_t)length;
+    }
+
+    memmove(conn->in, conn->in + pos, conn->in_len - pos);
+    conn->in_len -= pos;
+    return rc;
+}
+
+static void daemon_read(substr_daemon *daemon, daemon_conn *conn)
+{
+    size_t quota = DAEMON_READ_QUOTA;
+    while (quota > 0) {
+        if (reserve(&conn->in, &conn->in_cap, conn->in_len + DAEMON_READ_CHUNK) != 0) {
+            conn_close(daemon, conn);
+            return;
+        }
+        ssize_t n = read(conn->fd, conn->in + conn->in_len, DAEMON_READ_CHUNK);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        if (n < 0) {
+            conn_close(daemon, conn);
+            return;
+        }
+        if (n == 0) {
+            // the peer is done sending, answer what it sent then close
+            conn->eof = 1;
+            break;
+        }
+        conn->in_len += n;
+        quota -= (size_t)n < quota ? (size_t)n : quota;
+    }
+
+    if (conn_parse_frames(daemon, conn) != 0) {
+        conn_close(daemon, conn);
+    } else if (conn->eof) {
+        conn_flush(daemon, conn);
+    }
+}
+
+/*
+    one pool task: translate SUBSTR_BATCH_BLOCK requests of the batch */
+static void daemon_task(void *arg, size_t task_index)
+{
+    substr_daemon *daemon = arg;
+    size_t base = task_index * SUBSTR_BATCH_BLOCK;
+    size_t n = daemon->n_inputs - base;
+    if (n > SUBSTR_BATCH_BLOCK) {
+        n = SUBSTR_BATCH_BLOCK;
+    }
+    translate_substr_batch_syntax(daemon->inputs + base, daemon->syntaxes + base, daemon->ids + base, n,
+                                  daemon->task_out[task_index], daemon->task_out_len[task_index],
+                                  daemon->offsets + base, daemon->lengths + base, daemon->status + base);
+}
+
+/*
+    translate the batch on the pool, queue the responses in request order
+    and send them */
+static void daemon_run_batch(substr_daemon *daemon)
+{
+    size_t n = daemon->n_inputs;
+    daemon->n_tasks = (n + SUBSTR_BATCH_BLOCK - 1) / SUBSTR_BATCH_BLOCK;
+
+    // an output is never longer than the target name, the input and a numeric tail
+    int out_of_memory = 0;
+    for (size_t t = 0; t < daemon->n_tasks; t++) {
+        size_t len = 0;
+        for (size_t k = t * SUBSTR_BATCH_BLOCK; k < n && k < (t + 1) * SUBSTR_BATCH_BLOCK; k++) {
+            const substr_func_syntax *f_syntax = daemon->syntaxes[k];
+            size_t name_len = f_syntax->func_name_len ? f_syntax->func_name_len : strlen(f_syntax->func_name);
+            len += name_len + strlen(daemon->inputs[k]) + SUBSTR_CMD_TAIL_MAX + 2;
+        }
+        daemon->task_out_len[t] = len;
+        daemon->task_out[t] = substr_ctx_alloc(&daemon->arena, len);
+        out_of_memory |= !daemon->task_out[t];
+    }
+
+    if (daemon->n_tasks == 0) {
+        // only unknown DBMS IDs in this batch
+    } else if (!out_of_memory && substr_pool_start(daemon->pool, daemon_task, daemon, daemon->n_tasks) == RET_SUCCESS) {
+        substr_pool_wait(daemon->pool);
+    } else {
+        for (size_t k = 0; k < n; k++) {
+            daemon->status[k]  = MEMORY_ALLOCATION_ERR;
+            daemon->lengths[k] = 0;
+        }
+    }
+
+    n = daemon->n_requests;
+    for (size_t k = 0; k < n; k++) {
+        daemon_conn *conn = daemon->requests[k].conn;
+        conn->n_queued--;
+        if (conn->closing) {
+            continue;
+        }
+
+        size_t slot = daemon->requests[k].slot;
+        FunctionStatus status = slot != DAEMON_NO_SLOT ? daemon->status[slot] : UNKNOWN_DBMS_ID;
+        size_t out_len = status == RET_SUCCESS ? daemon->lengths[slot] : 0;
+        const char *out = status == RET_SUCCESS ? daemon->task_out[slot / SUBSTR_BATCH_BLOCK] + daemon->offsets[slot] : "";
+
+        if (reserve(&conn->out, &conn->out_cap, conn->out_len + SUBSTR_DAEMON_RESP_HEADER + out_len) != 0) {
+            conn_close(daemon, conn);
+            continue;
+        }
+        unsigned char *frame = (unsigned char *)conn->out + conn->out_len;
+        substr_daemon_put_u32(frame, (uint32_t)(SUBSTR_DAEMON_RESP_HEADER - 4 + out_len));
+        substr_daemon_put_u32(frame + 4, daemon->requests[k].request_id);
+        substr_daemon_put_u32(frame + 8, (uint32_t)(int32_t)status);
+        memcpy(frame + SUBSTR_DAEMON_RESP_HEADER, out, out_len);
+        conn->out_len += SUBSTR_DAEMON_RESP_HEADER + out_len;
+    }
+
+    // flush each connection once, after all of its responses are queued
+    for (size_t k = 0; k < n; k++) {
+        daemon_conn *conn = daemon->requests[k].conn;
+        if (!conn->closing && (k + 1 == n || daemon->requests[k + 1].conn != conn)) {
+            conn_flush(daemon, conn);
+        }
+    }
+
+    if (daemon->reading_registry) {
+        substr_registry_exit(daemon->registry, &daemon->rd);
+        daemon->reading_registry = 0;
+    }
+    daemon->n_requests = 0;
+    daemon->n_inputs   = 0;
+    substr_ctx_reset(&daemon->arena);
+}
+
+/*
+    remove the socket of a daemon that is gone: the path must be a socket
+    that refuses connections. A live daemon or any other file is left in
+    place and bind fails on it */
+static void unlink_stale_socket(const struct sockaddr_un *addr)
+{
+    struct stat st;
+    if (lstat(addr->sun_path, &st) != 0 || !S_ISSOCK(st.st_mode)) {
+        return;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return;
+    }
+    // non-blocking, a live daemon with a full backlog answers EAGAIN
+    if (set_nonblocking(fd) == 0 && connect(fd, (const struct sockaddr *)addr, sizeof(*addr)) != 0
+        && errno == ECONNREFUSED) {
+        unlink(addr->sun_path);
+    }
+    close(fd);
+}
+
+substr_daemon *substr_daemon_create(const char *socket_path, const substr_func_syntax *f_syntax, size_t n_syntax,
+                        int n_threads)
+{
+    struct sockaddr_un addr = {0};
+    if (!socket_path || !f_syntax || n_syntax == 0 || strlen(socket_path) >= sizeof(addr.sun_path)) {
+        return NULL;
+    }
+
+    substr_daemon *daemon = calloc(1, sizeof(*daemon));
+    if (!daemon) {
+        return NULL;
+    }
+    daemon->listen_fd = daemon->epoll_fd = daemon->stop_pipe[0] = daemon->stop_pipe[1] = -1;
+    daemon->f_syntax = f_syntax;
+    daemon->n_syntax = n_syntax;
+    substr_ctx_init(&daemon->arena, NULL);
+
+    daemon->socket_path = strdup(socket_path);
+    daemon->pool = substr_pool_create(n_threads > 0 ? n_threads : 1);
+    if (!daemon->socket_path || !daemon->pool) {
+        goto FAIL;
+    }
+
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, socket_path, strlen(socket_path) + 1);
+    unlink_stale_socket(&addr);
+
+    daemon->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (daemon->listen_fd < 0 || set_nonblocking(daemon->listen_fd) != 0
+        || bind(daemon->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        goto FAIL;
+    }
+    daemon->bound = 1;
+    if (listen(daemon->listen_fd, SOMAXCONN) != 0) {
+        goto FAIL;
+    }
+
+    daemon->epoll_fd = epoll_create1(0);
+    if (daemon->epoll_fd < 0 || pipe(daemon->stop_pipe) != 0) {
+        goto FAIL;
+    }
+
+    struct epoll_event ev = {0};
+    ev.events   = EPOLLIN;
+    ev.data.ptr = &daemon->listen_fd;
+    if (epoll_ctl(daemon->epoll_fd, EPOLL_CTL_ADD, daemon->listen_fd, &ev) != 0) {
+        goto FAIL;
+    }
+    ev.data.ptr = &daemon->stop_pipe[0];
+    if (epoll_ctl(daemon->epoll_fd, EPOLL_CTL_ADD, daemon->stop_pipe[0], &ev) != 0) {
+        goto FAIL;
+    }
+
+    return daemon;
+
+FAIL:
+    substr_daemon_destroy(daemon);
+    return NULL;
+}
+
+/*
+    event loop: read every ready connection, translate what was read as one
+    batch, send the answers, repeat */
+FunctionStatus substr_daemon_run(substr_daemon *daemon)
+{
+    if (!daemon) {
+        return NULL_INPUT_POINTER;
+    }
+
+    struct epoll_event events[DAEMON_MAX_EVENTS];
+    for (;;) {
+        int n = epoll_wait(daemon->epoll_fd, events, DAEMON_MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return FILE_IO_ERR;
+        }
+
+        int stop = 0, reload = 0;
+        for (int i = 0; i < n; i++) {
+            void *ptr = events[i].data.ptr;
+            if (ptr == &daemon->listen_fd) {
+                daemon_accept(daemon);
+                continue;
+            }
+            if (ptr == &daemon->stop_pipe[0]) {
+                char cmd[64];
+                ssize_t n_cmd = read(daemon->stop_pipe[0], cmd, sizeof(cmd));
+                for (ssize_t c = 0; c < n_cmd; c++) {
+                    if (cmd[c] == DAEMON_CMD_RELOAD) {
+                        reload = 1;
+                    } else {
+                        stop = 1;
+                    }
+                }
+                continue;
+            }
+
+            daemon_conn *conn = ptr;
+            if (conn->closing) {
+                continue;
+            }
+            if (events[i].events & EPOLLOUT) {
+                conn_flush(daemon, conn);
+            }
+            if (!conn->closing && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+                daemon_read(daemon, conn);
+            }
+        }
+
+        if (daemon->n_requests > 0) {
+            daemon_run_batch(daemon);
+        }
+        conn_free_closed(daemon);
+
+        // between batches, the daemon holds no read section the load would wait for
+        if (reload && daemon->registry && daemon->config_path) {
+            substr_registry_load_file(daemon->registry, daemon->config_path, daemon->reload_diag);
+        }
+        if (stop) {
+            return RET_SUCCESS;
+        }
+    }
+}
+
+void substr_daemon_stop(substr_daemon *daemon)
+{
+    if (daemon && daemon->stop_pipe[1] >= 0) {
+        char c = DAEMON_CMD_STOP;
+        ssize_t rc = write(daemon->stop_pipe[1], &c, 1);
+        (void)rc;
+    }
+}
+
+void substr_daemon_reload(substr_daemon *daemon)
+{
+    if (daemon && daemon->stop_pipe[1] >= 0) {
+        char c = DAEMON_CMD_RELOAD;
+        ssize_t rc = write(daemon->stop_pipe[1], &c, 1);
+        (void)rc;
+    }
+}
+
+FunctionStatus substr_daemon_set_registry(substr_daemon *daemon, substr_registry *registry, const char *config_path,
+                        substr_diag *diag)
+{
+    if (!daemon || !registry) {
+        return NULL_INPUT_POINTER; // Error: Null pointer
+    }
+    char *path = config_path ? strdup(config_path) : NULL;
+    if (config_path && !path) {
+        return MEMORY_ALLOCATION_ERR;
+    }
+    free(daemon->config_path);
+    daemon->registry    = registry;
+    daemon->config_path = path;
+    daemon->reload_diag = diag;
+    return RET_SUCCESS;
+}
+
+void substr_daemon_destroy(substr_daemon *daemon)
+{
+    if (!daemon) {
+        return;
+    }
+
+    for (daemon_conn *conn = daemon->conns; conn; conn = conn->next) {
+        conn_close(daemon, conn);
+    }
+    conn_free_closed(daemon);
+    if (daemon->epoll_fd >= 0) {
+        close(daemon->epoll_fd);
+    }
+    if (daemon->listen_fd >= 0) {
+        close(daemon->listen_fd);
+    }
+    if (daemon->bound) {
+        unlink(daemon->socket_path);
+    }
+    if (daemon->stop_pipe[0] >= 0) {
+        close(daemon->stop_pipe[0]);
+        close(daemon->stop_pipe[1]);
+    }
+    if (daemon->pool) {
+        substr_pool_destroy(daemon->pool);
+    }
+
+    substr_ctx_destroy(&daemon->arena);
+    free(daemon->requests);
+    free(daemon->inputs);
+    free(daemon->ids);
+    free(daemon->syntaxes);
+    free(daemon->offsets);
+    free(daemon->lengths);
+    free(daemon->status);
+    free(daemon->task_out);
+    free(daemon->task_out_len);
+    free(daemon->socket_path);
+    free(daemon->config_path);
+    free(daemon);
+}
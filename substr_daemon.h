@@ -0,0 +1,58 @@
+#ifndef __substr_daemon_h__
+#define __substr_daemon_h__
+
+#include <stdint.h>
+
+#include "substr_wrapper.h"
+#include "substr_registry.h"
+
+// Wire protocol, all integers little-endian.
+// request:  u32 length | u32 request_id | u16 DBMS_id | u16 flags | input
+// response: u32 length | u32 request_id | i32 status  | output
+// length counts the bytes after the length field itself. Requests may be
+// pipelined; responses of one connection come back in request order.
+#define SUBSTR_DAEMON_REQ_HEADER   12
+#define SUBSTR_DAEMON_RESP_HEADER  12
+// request flag: the target is a dialect of the registry, DBMS_id is the
+// length of its name and the input is the name followed by the call
+#define SUBSTR_DAEMON_FLAG_DIALECT 0x0001
+// longest frame accepted, a longer one closes the connection
+#define SUBSTR_DAEMON_MAX_FRAME    (1 << 20)
+// unsent response bytes of a connection above which its requests are not read
+#define SUBSTR_DAEMON_MAX_PENDING  (4 << 20)
+
+typedef struct substr_daemon_struct substr_daemon;
+
+// Listen on a Unix socket at socket_path and translate with f_syntax[DBMS_id]
+// on n_threads workers. A socket left there by a daemon that is gone is
+// replaced; a live one or any other file is not. NULL if the socket or the
+// pool cannot be set up
+substr_daemon *substr_daemon_create(const char *socket_path, const substr_func_syntax *f_syntax, size_t n_syntax,
+                        int n_threads);
+
+// Serve until substr_daemon_stop is called. Requests read in one wake-up of
+// the event loop, from all connections, are translated as one batch
+FunctionStatus substr_daemon_run(substr_daemon *daemon);
+
+// Make substr_daemon_run return, safe from other threads and signal handlers
+void substr_daemon_stop(substr_daemon *daemon);
+
+// Answer the requests flagged SUBSTR_DAEMON_FLAG_DIALECT from registry, which
+// must outlive the daemon. Call before substr_daemon_run. config_path (may be
+// NULL) is loaded again on substr_daemon_reload, into diag (may be NULL) whose
+// sink hears of a rejected config; the previous dialects then stay in use
+FunctionStatus substr_daemon_set_registry(substr_daemon *daemon, substr_registry *registry, const char *config_path,
+                        substr_diag *diag);
+
+// Make substr_daemon_run reload the config of its registry between two
+// batches, safe from other threads and signal handlers (SIGHUP)
+void substr_daemon_reload(substr_daemon *daemon);
+
+// close every connection, remove the socket file and release the daemon
+void substr_daemon_destroy(substr_daemon *daemon);
+
+// little-endian helpers of the wire protocol
+void     substr_daemon_put_u32(unsigned char *p, uint32_t v);
+uint32_t substr_daemon_get_u32(const unsigned char *p);
+
+#endif // __substr_daemon_h__
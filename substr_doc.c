@@ -0,0 +1,685 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+
+#include "substr_doc.h"
+#include "substr_stream.h"
+
+// kinds of index entries
+enum {
+    DOC_CALL,           /* SUBSTR call, translated or passed through */
+    DOC_LOOK,           /* SUBSTR keyword that is not a call */
+    DOC_CHECKPOINT,     /* lexer state where a scan stopped between two steps */
+};
+
+/*
+    one entry of the index of a document. Past the index gap, pos and
+    out_pos are stored as distances from the end of the source and of the
+    output, so an edit leaves the entries after it as they are */
+typedef struct doc_entry_struct {
+    size_t pos     ;    /* start of the call or look, position of the checkpoint */
+    size_t out_pos ;    /* position of pos in the output */
+    size_t len     ;    /* call: source bytes; look: bytes looked at, SIZE_MAX up to the end */
+    char  *out     ;    /* translation of a call, NULL if it is passed through */
+    size_t out_len ;
+    int kind       ;
+    substr_lex_state lex ;  /* state of a checkpoint */
+} doc_entry;
+
+/*
+    the source is a gap buffer: bytes [0, gap_start) then, after gap_len
+    unused bytes, the rest. The index is sorted by position and has a gap
+    too: entries [0, index_gap) then the last index_n - index_gap entries
+    of index_cap. Edits move both gaps to where they happen */
+struct substr_doc_struct {
+    const substr_func_syntax *f_syntax ;
+    char *buf ;
+    size_t cap, gap_start, gap_len ;
+
+    doc_entry *index ;
+    size_t index_cap, index_gap, index_n ;
+
+    doc_entry *scan ;       /* entries found by the current rescan */
+    size_t scan_n, scan_cap ;
+
+    char *patch_text ;
+    size_t patch_cap ;
+
+    size_t n_calls, n_translated, n_open_looks, output_len, last_rescan ;
+};
+
+// where a rescan begins
+typedef struct doc_restart_struct {
+    size_t pos ;
+    substr_lex_state lex ;
+    size_t first ;          /* old entries from here on are scanned again */
+    size_t out_pos ;        /* position of pos in the output */
+} doc_restart;
+
+// one edit, the source bytes [offset, old_edit_end) become [offset, edit_end)
+typedef struct doc_edit_struct {
+    size_t offset, edit_end, old_edit_end ;
+    size_t old_len      ;   /* source length before the edit */
+    size_t tail         ;   /* source bytes after the edit */
+    size_t old_out_len  ;
+} doc_edit;
+
+/*
+    bytes a call name cannot follow, see substr_lex_next_call */
+static int is_name_prefix(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+        || c == '_' || c == '$' || c == '.';
+}
+
+static size_t doc_len(const substr_doc *doc)
+{
+    return doc->cap - doc->gap_len;
+}
+
+static size_t call_out_len(const doc_entry *call)
+{
+    return call->out ? call->out_len : call->len;
+}
+
+static doc_entry *doc_entry_at(const substr_doc *doc, size_t i)
+{
+    return i < doc->index_gap ? &doc->index[i] : &doc->index[i + doc->index_cap - doc->index_n];
+}
+
+static size_t doc_entry_pos(const substr_doc *doc, size_t i)
+{
+    const doc_entry *e = doc_entry_at(doc, i);
+    return i < doc->index_gap ? e->pos : doc_len(doc) - e->pos;
+}
+
+/*
+    make room for need elements in a growing array.
+    return 0 if success, -1 if out of memory */
+static int doc_reserve(void **array, size_t *cap, size_t need, size_t elem_size)
+{
+    if (need <= *cap) {
+        return 0;
+    }
+    size_t new_cap = *cap ? *cap : 64;
+    while (new_cap < need) {
+        new_cap *= 2;
+    }
+    void *grown = realloc(*array, new_cap * elem_size);
+    if (!grown) {
+        return -1;
+    }
+    *array = grown;
+    *cap = new_cap;
+    return 0;
+}
+
+static void doc_move_gap(substr_doc *doc, size_t pos)
+{
+    if (pos < doc->gap_start) {
+        memmove(doc->buf + pos + doc->gap_len, doc->buf + pos, doc->gap_start - pos);
+    } else if (pos > doc->gap_start) {
+        memmove(doc->buf + doc->gap_start, doc->buf + doc->gap_start + doc->gap_len, pos - doc->gap_start);
+    }
+    doc->gap_start = pos;
+}
+
+/*
+    grow the gap to at least need bytes.
+    return 0 if success, -1 if out of memory */
+static int doc_reserve_gap(substr_doc *doc, size_t need)
+{
+    if (doc->gap_len >= need) {
+        return 0;
+    }
+    size_t len = doc_len(doc);
+    size_t cap = doc->cap * 2 > len + need + SUBSTR_DOC_CHECKPOINT ? doc->cap * 2 : len + need + SUBSTR_DOC_CHECKPOINT;
+    char *buf = malloc(cap);
+    if (!buf) {
+        return -1;
+    }
+    size_t after = len - doc->gap_start;
+    memcpy(buf, doc->buf, doc->gap_start);
+    memcpy(buf + cap - after, doc->buf + doc->gap_start + doc->gap_len, after);
+    free(doc->buf);
+    doc->buf = buf;
+    doc->gap_len = cap - len;
+    doc->cap = cap;
+    return 0;
+}
+
+/*
+    move the index gap before entry i, switching the positions of the
+    entries it passes between absolute and counted from the end */
+static void doc_move_index_gap(substr_doc *doc, size_t i)
+{
+    size_t gap = doc->index_cap - doc->index_n;
+    size_t len = doc_len(doc), out_len = doc->output_len;
+
+    while (doc->index_gap > i) {
+        doc_entry *e = &doc->index[--doc->index_gap];
+        e->pos     = len - e->pos;
+        e->out_pos = out_len - e->out_pos;
+        doc->index[doc->index_gap + gap] = *e;
+    }
+    while (doc->index_gap < i) {
+        doc_entry *e = &doc->index[doc->index_gap + gap];
+        e->pos     = len - e->pos;
+        e->out_pos = out_len - e->out_pos;
+        doc->index[doc->index_gap++] = *e;
+    }
+}
+
+/*
+    translate one call, a call that fails to translate keeps out NULL.
+    return RET_SUCCESS or MEMORY_ALLOCATION_ERR */
+static FunctionStatus doc_translate(const substr_doc *doc, const char *call, size_t len, doc_entry *entry)
+{
+    substr_func_view f_view_in = {0};
+    substr_func_ref  f_ref_out;
+
+    entry->out = NULL;
+    entry->out_len = 0;
+    if (parse_substr_call_view(call, len, &f_view_in) != RET_SUCCESS
+        || gen_substr_func_ref(doc->f_syntax, call, &f_view_in, &f_ref_out) != RET_SUCCESS) {
+        return RET_SUCCESS;
+    }
+
+    size_t size = f_ref_out.func_name_len + 1 + f_ref_out.col_name_len + SUBSTR_CMD_TAIL_MAX + 1;
+    entry->out = malloc(size);
+    if (!entry->out) {
+        return MEMORY_ALLOCATION_ERR;
+    }
+    long int written = gen_substr_cmd_ref(&f_ref_out, entry->out, size);
+    if (written <= 0) {
+        free(entry->out);
+        entry->out = NULL;
+        return RET_SUCCESS;
+    }
+    entry->out_len = written;
+    return RET_SUCCESS;
+}
+
+/*
+    Latest point before an edit at offset where the old scan stood between
+    two steps, with no step before it that looked at offset or past it: the
+    end of a call (up to offset), or the start of a call, a look or a
+    checkpoint (before offset). Steps look at most one byte ahead but looks;
+    no checkpoint is kept inside the lookahead of a look, so only a look
+    that reached the end of the source (an unclosed "SUBSTR(") can push
+    the point back. Those are rare and rescanned to the end anyway, they
+    are searched one entry at a time
+*/
+static void doc_restart_point(const substr_doc *doc, size_t offset, doc_restart *rs)
+{
+    size_t lo = 0, hi = doc->index_n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (doc_entry_pos(doc, mid) < offset) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    rs->pos   = 0;
+    rs->lex   = SUBSTR_LEX_TEXT;
+    rs->first = 0;
+    if (lo > 0) {
+        const doc_entry *e = doc_entry_at(doc, lo - 1);
+        size_t pos = doc_entry_pos(doc, lo - 1);
+        if (e->kind == DOC_CALL && pos + e->len <= offset) {
+            rs->pos   = pos + e->len;
+            rs->first = lo;
+        } else if (e->kind == DOC_CHECKPOINT) {
+            rs->pos   = pos;
+            rs->lex   = e->lex;
+            rs->first = lo;
+        } else {
+            rs->pos   = pos;
+            rs->first = lo - 1;
+        }
+    }
+
+    for (size_t i = 0; doc->n_open_looks > 0 && i < rs->first; i++) {
+        const doc_entry *e = doc_entry_at(doc, i);
+        if (e->kind == DOC_LOOK && e->len == SIZE_MAX) {
+            rs->pos   = doc_entry_pos(doc, i);
+            rs->lex   = SUBSTR_LEX_TEXT;
+            rs->first = i;
+            break;
+        }
+    }
+}
+
+/*
+    output position of rs->pos, from the last entry kept before it */
+static size_t doc_restart_out_pos(const substr_doc *doc, const doc_restart *rs)
+{
+    if (rs->first == 0) {
+        return rs->pos;
+    }
+    const doc_entry *e = doc_entry_at(doc, rs->first - 1);
+    size_t pos = doc_entry_pos(doc, rs->first - 1);
+    if (e->kind == DOC_CALL) {
+        return e->out_pos + call_out_len(e) + (rs->pos - pos - e->len);
+    }
+    return e->out_pos + (rs->pos - pos);
+}
+
+static FunctionStatus doc_add_entry(substr_doc *doc, int kind, size_t pos, size_t len, substr_lex_state lex,
+                        const char *call)
+{
+    if (doc_reserve((void **)&doc->scan, &doc->scan_cap, doc->scan_n + 1, sizeof(doc_entry)) != 0) {
+        return MEMORY_ALLOCATION_ERR;
+    }
+    doc_entry *e = &doc->scan[doc->scan_n];
+    e->pos     = pos;
+    e->len     = len;
+    e->out     = NULL;
+    e->out_len = 0;
+    e->kind    = kind;
+    e->lex     = lex;
+    if (kind == DOC_CALL && doc_translate(doc, call, len, e) != RET_SUCCESS) {
+        return MEMORY_ALLOCATION_ERR;
+    }
+    doc->scan_n++;
+    return RET_SUCCESS;
+}
+
+/*
+    Scan the edited source from rs->pos, where the gap is, into scan.
+    The old entries from rs->first on are past the index gap, counted from
+    the end. Past the edited bytes, each call found and each stop is
+    compared with them: at the first old call or checkpoint met at the same
+    place in the same lexer state, the rest of the old index is still right
+    and the scan ends. Stops are taken every SUBSTR_DOC_CHECKPOINT bytes
+    and at the old checkpoints past the edit.
+    *n_replaced: number of old entries replaced by the scanned ones
+*/
+static FunctionStatus doc_rescan(substr_doc *doc, const doc_restart *rs, const doc_edit *ed, size_t *n_replaced,
+                        size_t *scan_end)
+{
+    const char *tail = doc->buf + doc->gap_start + doc->gap_len;
+    const doc_entry *old = doc->index + doc->index_cap - (doc->index_n - doc->index_gap);
+    size_t n_old = doc->index_n - doc->index_gap;
+    size_t base = rs->pos, len = doc_len(doc), n = len - base;
+    int prev_ident = base > 0 && is_name_prefix(doc->buf[base - 1]);
+    substr_lex_state lex = rs->lex;
+    size_t i = 0, last_cp = base, shadow_end = 0, j = 0, k = 0;
+    FunctionStatus rc = RET_SUCCESS;
+
+    doc->scan_n = 0;
+    *n_replaced = n_old;
+    *scan_end   = len;
+
+    /* an old entry is at or past the end of the edit if its pos <= ed->tail, it is now at len - pos */
+    while (i < n) {
+        while (k < n_old && (old[k].kind != DOC_CHECKPOINT || old[k].pos >= ed->tail || len - old[k].pos <= base + i)) {
+            k++;
+        }
+        size_t cp_target = k < n_old ? len - old[k].pos : SIZE_MAX;
+        size_t stop = last_cp + SUBSTR_DOC_CHECKPOINT < cp_target ? last_cp + SUBSTR_DOC_CHECKPOINT : cp_target;
+        stop = stop > base + i ? stop : base + i + 1;
+        size_t start, end;
+
+        int found = substr_lex_next_call(&lex, prev_ident, tail, n, stop - base, 1, &i, &start, &end);
+        if (found == SUBSTR_LEX_KEYWORD) {
+            if (end < n) {
+                shadow_end = base + end;
+            }
+            rc = doc_add_entry(doc, DOC_LOOK, base + start, end < n ? end - start : SIZE_MAX, SUBSTR_LEX_TEXT, NULL);
+            if (rc != RET_SUCCESS) {
+                return rc;
+            }
+            continue;
+        }
+        if (found == SUBSTR_LEX_CALL) {
+            size_t q = base + start;
+            if (q >= ed->edit_end) {
+                while (j < n_old && (old[j].pos > ed->tail || len - old[j].pos < q)) {
+                    j++;
+                }
+                size_t c = j;
+                while (c < n_old && old[c].kind == DOC_CHECKPOINT && len - old[c].pos == q) {
+                    c++;
+                }
+                if (c < n_old && old[c].kind == DOC_CALL && len - old[c].pos == q) {
+                    *n_replaced = j;
+                    *scan_end   = q;
+                    return RET_SUCCESS;
+                }
+            }
+            rc = doc_add_entry(doc, DOC_CALL, q, end - start, SUBSTR_LEX_TEXT, tail + start);
+            if (rc != RET_SUCCESS) {
+                return rc;
+            }
+            continue;
+        }
+        if (i >= n) {
+            break;
+        }
+
+        /* stopped between two steps, outside the lookahead of the last look */
+        size_t pos = base + i;
+        if (pos < shadow_end) {
+            continue;
+        }
+        if (pos == cp_target && lex == old[k].lex) {
+            *n_replaced = k;
+            *scan_end   = pos;
+            return RET_SUCCESS;
+        }
+        if (pos == cp_target || pos >= last_cp + SUBSTR_DOC_CHECKPOINT) {
+            rc = doc_add_entry(doc, DOC_CHECKPOINT, pos, 0, lex, NULL);
+            if (rc != RET_SUCCESS) {
+                return rc;
+            }
+            last_cp = pos;
+        }
+    }
+
+    return RET_SUCCESS;
+}
+
+/*
+    describe the change of the output between the n_replaced old entries
+    and the scanned ones, as one patch over the smallest range that holds
+    the edit and every call that changed */
+static FunctionStatus doc_make_patch(substr_doc *doc, const doc_restart *rs, const doc_edit *ed, size_t n_replaced,
+                        substr_doc_patch *patch)
+{
+    const doc_entry *old = doc->index + doc->index_cap - (doc->index_n - doc->index_gap);
+    const doc_entry *scan = doc->scan;
+    size_t len = doc_len(doc);
+
+#define OLD_POS(e)  (ed->old_len - (e)->pos)
+
+    /* calls before the edit that did not change */
+    size_t po = 0, pn = 0;
+    while (1) {
+        while (po < n_replaced && old[po].kind != DOC_CALL) {
+            po++;
+        }
+        while (pn < doc->scan_n && scan[pn].kind != DOC_CALL) {
+            pn++;
+        }
+        if (po == n_replaced || pn == doc->scan_n || OLD_POS(&old[po]) != scan[pn].pos || old[po].len != scan[pn].len
+            || scan[pn].pos + scan[pn].len > ed->offset) {
+            break;
+        }
+        po++;
+        pn++;
+    }
+
+    /* calls after the edit that did not change */
+    size_t so = n_replaced, sn = doc->scan_n;
+    while (1) {
+        while (so > po && old[so - 1].kind != DOC_CALL) {
+            so--;
+        }
+        while (sn > pn && scan[sn - 1].kind != DOC_CALL) {
+            sn--;
+        }
+        if (so == po || sn == pn || old[so - 1].pos > ed->tail || len - old[so - 1].pos != scan[sn - 1].pos
+            || old[so - 1].len != scan[sn - 1].len) {
+            break;
+        }
+        so--;
+        sn--;
+    }
+
+    /* the output changes over [from, to) of the new source */
+    size_t from = ed->offset, to = ed->edit_end;
+    long int removed = 0, text_len = 0, before = 0;
+    for (size_t i = po; i < so; i++) {
+        if (old[i].kind != DOC_CALL) {
+            continue;
+        }
+        size_t start = OLD_POS(&old[i]), end = start + old[i].len;
+        from = start < from ? start : from;
+        if (end > ed->old_edit_end && end - ed->old_edit_end + ed->edit_end > to) {
+            to = end - ed->old_edit_end + ed->edit_end;
+        }
+        removed += (long int)call_out_len(&old[i]) - (long int)old[i].len;
+    }
+    for (size_t i = 0; i < sn; i++) {
+        if (scan[i].kind != DOC_CALL) {
+            continue;
+        }
+        long int diff = (long int)call_out_len(&scan[i]) - (long int)scan[i].len;
+        if (i < pn) {
+            before += diff;
+            continue;
+        }
+        from = scan[i].pos < from ? scan[i].pos : from;
+        to = scan[i].pos + scan[i].len > to ? scan[i].pos + scan[i].len : to;
+        text_len += diff;
+    }
+    removed  += (long int)(to - ed->edit_end + ed->old_edit_end - from);
+    text_len += (long int)(to - from);
+
+#undef OLD_POS
+
+    if (doc_reserve((void **)&doc->patch_text, &doc->patch_cap, (size_t)text_len + 1, 1) != 0) {
+        return MEMORY_ALLOCATION_ERR;
+    }
+
+    /* the source from rs->pos on is after the gap */
+    const char *src = doc->buf + doc->gap_len;
+    char *dst = doc->patch_text;
+    size_t pos = from;
+    for (size_t i = pn; i < sn; i++) {
+        if (scan[i].kind != DOC_CALL || !scan[i].out) {
+            continue;
+        }
+        memcpy(dst, src + pos, scan[i].pos - pos);
+        dst += scan[i].pos - pos;
+        memcpy(dst, scan[i].out, scan[i].out_len);
+        dst += scan[i].out_len;
+        pos = scan[i].pos + scan[i].len;
+    }
+    memcpy(dst, src + pos, to - pos);
+    dst += to - pos;
+    *dst = '\0';
+
+    patch->offset   = rs->out_pos + (from - rs->pos) + before;
+    patch->removed  = removed;
+    patch->text     = doc->patch_text;
+    patch->text_len = text_len;
+    return RET_SUCCESS;
+}
+
+/*
+    replace the n_replaced old entries with the scanned ones, at the index
+    gap. The entries after them keep their distances from the ends */
+static FunctionStatus doc_splice(substr_doc *doc, const doc_restart *rs, size_t n_replaced)
+{
+    doc_entry *old = doc->index + doc->index_cap - (doc->index_n - doc->index_gap);
+    for (size_t i = 0; i < n_replaced; i++) {
+        doc->n_calls      -= old[i].kind == DOC_CALL;
+        doc->n_translated -= old[i].out != NULL;
+        doc->n_open_looks -= old[i].kind == DOC_LOOK && old[i].len == SIZE_MAX;
+        free(old[i].out);
+    }
+    doc->index_n -= n_replaced;
+
+    if (doc->index_cap - doc->index_n < doc->scan_n) {
+        size_t after = doc->index_n - doc->index_gap, cap = doc->index_cap;
+        if (doc_reserve((void **)&doc->index, &cap, doc->index_n + doc->scan_n, sizeof(doc_entry)) != 0) {
+            return MEMORY_ALLOCATION_ERR;
+        }
+        memmove(doc->index + cap - after, doc->index + doc->index_cap - after, after * sizeof(doc_entry));
+        doc->index_cap = cap;
+    }
+
+    size_t out_pos = rs->out_pos, pos = rs->pos;
+    for (size_t i = 0; i < doc->scan_n; i++) {
+        doc_entry *e = &doc->index[doc->index_gap + i];
+        *e = doc->scan[i];
+        e->out_pos = out_pos + (e->pos - pos);
+        if (e->kind == DOC_CALL) {
+            out_pos = e->out_pos + call_out_len(e);
+            pos = e->pos + e->len;
+        } else {
+            out_pos = e->out_pos;
+            pos = e->pos;
+        }
+        doc->n_calls      += e->kind == DOC_CALL;
+        doc->n_translated += e->out != NULL;
+        doc->n_open_looks += e->kind == DOC_LOOK && e->len == SIZE_MAX;
+    }
+    doc->index_gap += doc->scan_n;
+    doc->index_n   += doc->scan_n;
+    doc->scan_n = 0;
+    return RET_SUCCESS;
+}
+
+substr_doc *substr_doc_create(const substr_func_syntax *f_syntax, const char *text, size_t text_len)
+{
+    if (!f_syntax || (!text && text_len > 0)) {
+        return NULL;
+    }
+
+    substr_doc *doc = calloc(1, sizeof(*doc));
+    if (!doc) {
+        return NULL;
+    }
+    doc->f_syntax = f_syntax;
+    doc->cap = text_len + SUBSTR_DOC_CHECKPOINT;
+    doc->buf = malloc(doc->cap);
+    doc->gap_len = doc->cap;
+    if (!doc->buf
+        || doc_reserve((void **)&doc->index, &doc->index_cap, 1, sizeof(doc_entry)) != 0
+        || doc_reserve((void **)&doc->scan, &doc->scan_cap, 1, sizeof(doc_entry)) != 0) {
+        substr_doc_destroy(doc);
+        return NULL;
+    }
+
+    /* the text is one edit of the empty document */
+    substr_doc_patch patch;
+    if (substr_doc_edit(doc, 0, 0, text, text_len, &patch) != RET_SUCCESS) {
+        substr_doc_destroy(doc);
+        return NULL;
+    }
+    return doc;
+}
+
+void substr_doc_destroy(substr_doc *doc)
+{
+    if (!doc) {
+        return;
+    }
+    for (size_t i = 0; i < doc->index_n; i++) {
+        free(doc_entry_at(doc, i)->out);
+    }
+    for (size_t i = 0; i < doc->scan_n; i++) {
+        free(doc->scan[i].out);
+    }
+    free(doc->buf);
+    free(doc->index);
+    free(doc->scan);
+    free(doc->patch_text);
+    free(doc);
+}
+
+/*
+    on MEMORY_ALLOCATION_ERR the edit may be half applied,
+    the document can only be destroyed */
+FunctionStatus substr_doc_edit(substr_doc *doc, size_t offset, size_t removed, const char *text, size_t text_len,
+                        substr_doc_patch *patch)
+{
+    if (!doc || (!text && text_len > 0) || !patch) {
+        return NULL_INPUT_POINTER; // Error: Null pointer
+    }
+    if (offset > doc_len(doc) || removed > doc_len(doc) - offset) {
+        return EDIT_OUT_OF_RANGE; // Error: edit past the end of the document
+    }
+
+    doc_restart rs;
+    doc_restart_point(doc, offset, &rs);
+    doc_move_index_gap(doc, rs.first);
+    rs.out_pos = doc_restart_out_pos(doc, &rs);
+
+    doc_edit ed;
+    ed.offset       = offset;
+    ed.edit_end     = offset + text_len;
+    ed.old_edit_end = offset + removed;
+    ed.old_len      = doc_len(doc);
+    ed.tail         = ed.old_len - ed.old_edit_end;
+    ed.old_out_len  = doc->output_len;
+
+    /* apply the edit at the gap, then leave the gap at the restart point */
+    doc_move_gap(doc, offset);
+    doc->gap_len += removed;
+    if (doc_reserve_gap(doc, text_len) != 0) {
+        return MEMORY_ALLOCATION_ERR;
+    }
+    memcpy(doc->buf + doc->gap_start, text, text_len);
+    doc->gap_start += text_len;
+    doc->gap_len   -= text_len;
+    doc_move_gap(doc, rs.pos);
+
+    size_t n_replaced, scan_end;
+    FunctionStatus rc = doc_rescan(doc, &rs, &ed, &n_replaced, &scan_end);
+    if (rc == RET_SUCCESS) {
+        rc = doc_make_patch(doc, &rs, &ed, n_replaced, patch);
+    }
+    if (rc == RET_SUCCESS) {
+        rc = doc_splice(doc, &rs, n_replaced);
+    }
+    if (rc != RET_SUCCESS) {
+        return rc;
+    }
+
+    doc->output_len  = ed.old_out_len + patch->text_len - patch->removed;
+    doc->last_rescan = scan_end - rs.pos;
+    return RET_SUCCESS;
+}
+
+FunctionStatus substr_doc_render(const substr_doc *doc, char *out_str, size_t out_str_len, size_t *out_str_wrt)
+{
+    if (!doc || !out_str_wrt || (out_str && out_str_len == 0)) {
+        return NULL_INPUT_POINTER; // Error: Null pointer or zero length
+    }
+
+    *out_str_wrt = doc->output_len;
+    if (!out_str) {
+        return RET_SUCCESS;
+    }
+    if (doc->output_len + 1 > out_str_len) {
+        return TOO_SHORT_OUTPUT_BUFFER; // Error: output buffer too short
+    }
+
+    size_t len = doc_len(doc), pos = 0;
+    char *dst = out_str;
+    for (size_t i = 0; i <= doc->index_n; i++) {
+        const doc_entry *e = i < doc->index_n ? doc_entry_at(doc, i) : NULL;
+        if (e && (e->kind != DOC_CALL || !e->out)) {
+            continue;
+        }
+        size_t end = e ? doc_entry_pos(doc, i) : len;
+        /* source bytes [pos, end), around the gap */
+        while (pos < end) {
+            size_t run_end = pos < doc->gap_start && end > doc->gap_start ? doc->gap_start : end;
+            memcpy(dst, pos < doc->gap_start ? doc->buf + pos : doc->buf + pos + doc->gap_len, run_end - pos);
+            dst += run_end - pos;
+            pos = run_end;
+        }
+        if (e) {
+            memcpy(dst, e->out, e->out_len);
+            dst += e->out_len;
+            pos = end + e->len;
+        }
+    }
+    *dst = '\0';
+    return RET_SUCCESS;
+}
+
+void substr_doc_get_stats(const substr_doc *doc, substr_doc_stats *stats)
+{
+    stats->n_calls      = doc->n_calls;
+    stats->n_translated = doc->n_translated;
+    stats->output_len   = doc->output_len;
+    stats->last_rescan  = doc->last_rescan;
+}
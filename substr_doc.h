@@ -0,0 +1,51 @@
+#ifndef __substr_doc_h__
+#define __substr_doc_h__
+
+#include "substr_wrapper.h"
+
+// distance between the saved lexer states an edit can restart from
+#define SUBSTR_DOC_CHECKPOINT  4096
+
+typedef struct substr_doc_struct substr_doc;
+
+// change of the translated output caused by one edit: output bytes
+// [offset, offset + removed) are replaced by text[0, text_len)
+typedef struct substr_doc_patch_struct {
+    size_t offset     ;
+    size_t removed    ;
+    const char *text  ;  /* owned by the document, valid until its next edit */
+    size_t text_len   ;
+} substr_doc_patch;
+
+typedef struct substr_doc_stats_struct {
+    size_t n_calls      ;  /* SUBSTR calls in the document */
+    size_t n_translated ;  /* calls translated, the others are passed through unchanged */
+    size_t output_len   ;  /* length of the translated document */
+    size_t last_rescan  ;  /* source bytes scanned again by the last edit */
+} substr_doc_stats;
+
+// Copy text and index its SUBSTR calls (outside quotes and comments, as
+// substr_rewrite_feed finds them) with their translations to f_syntax.
+// NULL if out of memory
+substr_doc *substr_doc_create(const substr_func_syntax *f_syntax, const char *text, size_t text_len);
+
+// release a document and its index
+void substr_doc_destroy(substr_doc *doc);
+
+// Given
+//    offset, removed: source bytes [offset, offset + removed) to replace,
+//    text, text_len:  bytes inserted at offset
+// apply the edit, scan again only from the last saved lexer state before
+// offset until the scan meets the old index again, re-translate the calls
+// found on the way, and describe the change of the output in patch
+FunctionStatus substr_doc_edit(substr_doc *doc, size_t offset, size_t removed, const char *text, size_t text_len,
+                        substr_doc_patch *patch);
+
+// Write the whole translated document, null-terminated. A NULL out_str
+// returns the length in out_str_wrt
+FunctionStatus substr_doc_render(const substr_doc *doc, char *out_str, size_t out_str_len, size_t *out_str_wrt);
+
+// counters of a document
+void substr_doc_get_stats(const substr_doc *doc, substr_doc_stats *stats);
+
+#endif // __substr_doc_h__
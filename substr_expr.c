@@ -0,0 +1,567 @@
+#include <ctype.h>
+
+#include "substr_expr.h"
+
+typedef enum {
+    TOK_END = 0,
+    TOK_IDENT,
+    TOK_NUMBER,
+    TOK_STRING,
+    TOK_LPAREN,
+    TOK_RPAREN,
+    TOK_COMMA,
+    TOK_PARAM,
+    TOK_OP,
+} expr_tok_kind;
+
+typedef struct {
+    expr_tok_kind kind ;
+    size_t offset ;
+    size_t length ;
+} expr_token;
+
+/*
+    state of one parse: the input, the one-token lookahead and the first error */
+typedef struct {
+    const char *input ;
+    size_t len        ;
+    size_t pos        ;     /* next byte the tokenizer reads */
+    expr_token tok    ;     /* current token */
+    substr_ctx *ctx   ;
+    int depth         ;
+    FunctionStatus status ;
+    size_t err_pos    ;
+} expr_parser;
+
+static int is_ident_start(unsigned char c)
+{
+    return isalpha(c) || c == '_' || c >= 0x80;
+}
+
+static int is_ident_char(unsigned char c)
+{
+    return isalnum(c) || c == '_' || c == '$' || c == '#' || c == '.' || c >= 0x80;
+}
+
+/*
+    record the first error of a parse, return NULL for the caller to pass up */
+static substr_node *parse_fail(expr_parser *p, FunctionStatus status, size_t err_pos)
+{
+    if (p->status == RET_SUCCESS) {
+        p->status  = status;
+        p->err_pos = err_pos;
+    }
+    return NULL;
+}
+
+/*
+    read the next token into p->tok; every input byte is looked at once.
+    return 0 if success, -1 on an unterminated string literal */
+static int next_token(expr_parser *p)
+{
+    const char *s = p->input;
+    size_t i = p->pos;
+
+    while (i < p->len && isspace((unsigned char)s[i])) {
+        i++;
+    }
+    p->tok.offset = i;
+
+    if (i >= p->len) {
+        p->tok.kind   = TOK_END;
+        p->tok.length = 0;
+        p->pos = i;
+        return 0;
+    }
+
+    unsigned char c = s[i];
+    if (c == '(' || c == ')' || c == ',') {
+        p->tok.kind = c == '(' ? TOK_LPAREN : c == ')' ? TOK_RPAREN : TOK_COMMA;
+        i++;
+    } else if (c == '?') {
+        p->tok.kind = TOK_PARAM;
+        i++;
+    } else if (c == '"' || c == '\'') {
+        // a doubled quote inside the literal stands for one quote
+        const char *close = NULL;
+        size_t from = i + 1;
+        for (;;) {
+            close = memchr(s + from, c, p->len - from);
+            if (!close) {
+                parse_fail(p, FUNC_CALL_DQUOTE_MISMATCH, i);
+                return -1;
+            }
+            from = close - s + 1;
+            if (from >= p->len || (unsigned char)s[from] != c) {
+                break;
+            }
+            from++;
+        }
+        p->tok.kind = TOK_STRING;
+        i = from;
+    } else if (isdigit(c) || (c == '.' && i + 1 < p->len && isdigit((unsigned char)s[i + 1]))) {
+        while (i < p->len && (isdigit((unsigned char)s[i]) || s[i] == '.')) {
+            i++;
+        }
+        if (i < p->len && (s[i] == 'e' || s[i] == 'E')) {
+            size_t j = i + 1;
+            if (j < p->len && (s[j] == '+' || s[j] == '-')) {
+                j++;
+            }
+            if (j < p->len && isdigit((unsigned char)s[j])) {
+                for (i = j; i < p->len && isdigit((unsigned char)s[i]); i++) {
+                }
+            }
+        }
+        p->tok.kind = TOK_NUMBER;
+    } else if (is_ident_start(c)) {
+        while (i < p->len && is_ident_char((unsigned char)s[i])) {
+            i++;
+        }
+        p->tok.kind = TOK_IDENT;
+    } else {
+        p->tok.kind = TOK_OP;
+        i++;
+    }
+
+    p->tok.length = i - p->tok.offset;
+    p->pos = i;
+    return 0;
+}
+
+static substr_node *new_node(expr_parser *p, substr_node_kind kind, size_t offset)
+{
+    substr_node *node = substr_ctx_alloc(p->ctx, sizeof(*node));
+    if (!node) {
+        return parse_fail(p, MEMORY_ALLOCATION_ERR, offset);
+    }
+    memset(node, 0, sizeof(*node));
+    node->kind = kind;
+    node->span.offset = offset;
+    return node;
+}
+
+static void append_child(substr_node *parent, substr_node **last, substr_node *child)
+{
+    if (*last) {
+        (*last)->next = child;
+    } else {
+        parent->child = child;
+    }
+    *last = child;
+    parent->n_children++;
+}
+
+/*
+    value of a numeric token, set is_int only if it is a plain integer that
+    fits in a long int */
+static void number_value(substr_node *node, const char *s, size_t len, int negative)
+{
+    // accumulate as a negative number so LONG_MIN is representable
+    long int acc = 0;
+    node->is_int = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (s[i] < '0' || s[i] > '9') {
+            return;
+        }
+        int digit = s[i] - '0';
+        if (acc < (LONG_MIN + digit) / 10) {
+            return;
+        }
+        acc = acc * 10 - digit;
+    }
+    if (!negative) {
+        if (acc == LONG_MIN) {
+            return;
+        }
+        acc = -acc;
+    }
+    node->value  = acc;
+    node->is_int = 1;
+}
+
+static substr_node *parse_expr(expr_parser *p);
+
+/*
+    arguments of a call, the current token is the '(' */
+static substr_node *parse_call_args(expr_parser *p, substr_node *call)
+{
+    size_t lparen = p->tok.offset;
+    if (++p->depth > SUBSTR_EXPR_MAX_DEPTH) {
+        return parse_fail(p, FUNC_CALL_SYNTAX_ERR, lparen);
+    }
+    if (next_token(p) != 0) {
+        return NULL;
+    }
+
+    substr_node *last = NULL;
+    if (p->tok.kind != TOK_RPAREN) {
+        for (;;) {
+            substr_node *arg = parse_expr(p);
+            if (!arg) {
+                return NULL;
+            }
+            append_child(call, &last, arg);
+
+            if (p->tok.kind == TOK_COMMA) {
+                if (next_token(p) != 0) {
+                    return NULL;
+                }
+            } else if (p->tok.kind == TOK_RPAREN) {
+                break;
+            } else if (p->tok.kind == TOK_END) {
+                return parse_fail(p, FUNC_CALL_PARENS_MISMATCH, lparen);
+            } else {
+                return parse_fail(p, FUNC_CALL_SYNTAX_ERR, p->tok.offset);
+            }
+        }
+    }
+
+    call->span.length = p->tok.offset + 1 - call->span.offset;
+    p->depth--;
+    return next_token(p) == 0 ? call : NULL;
+}
+
+/*
+    operand := NUMBER | STRING | '?' | IDENT | IDENT '(' [expr {',' expr}] ')' | '(' expr ')' */
+static substr_node *parse_operand(expr_parser *p)
+{
+    expr_token tok = p->tok;
+    substr_node *node = NULL;
+
+    switch (tok.kind) {
+    case TOK_NUMBER:
+    case TOK_STRING:
+    case TOK_PARAM:
+        node = new_node(p, tok.kind == TOK_NUMBER ? SUBSTR_NODE_NUMBER
+                         : tok.kind == TOK_STRING ? SUBSTR_NODE_STRING : SUBSTR_NODE_PARAM, tok.offset);
+        if (!node) {
+            return NULL;
+        }
+        node->span.length = tok.length;
+        if (tok.kind == TOK_NUMBER) {
+            number_value(node, p->input + tok.offset, tok.length, 0);
+        }
+        return next_token(p) == 0 ? node : NULL;
+
+    case TOK_IDENT:
+        if (next_token(p) != 0) {
+            return NULL;
+        }
+        node = new_node(p, p->tok.kind == TOK_LPAREN ? SUBSTR_NODE_CALL : SUBSTR_NODE_IDENT, tok.offset);
+        if (!node) {
+            return NULL;
+        }
+        node->span.length = tok.length;
+        if (node->kind == SUBSTR_NODE_IDENT) {
+            return node;
+        }
+        node->name.offset = tok.offset;
+        node->name.length = tok.length;
+        return parse_call_args(p, node);
+
+    case TOK_LPAREN:
+        if (++p->depth > SUBSTR_EXPR_MAX_DEPTH) {
+            return parse_fail(p, FUNC_CALL_SYNTAX_ERR, tok.offset);
+        }
+        node = new_node(p, SUBSTR_NODE_GROUP, tok.offset);
+        if (!node || next_token(p) != 0) {
+            return NULL;
+        }
+        substr_node *inner = parse_expr(p);
+        if (!inner) {
+            return NULL;
+        }
+        if (p->tok.kind != TOK_RPAREN) {
+            return p->tok.kind == TOK_END ? parse_fail(p, FUNC_CALL_PARENS_MISMATCH, tok.offset)
+                                          : parse_fail(p, FUNC_CALL_SYNTAX_ERR, p->tok.offset);
+        }
+        node->child = inner;
+        node->n_children = 1;
+        node->span.length = p->tok.offset + 1 - tok.offset;
+        p->depth--;
+        return next_token(p) == 0 ? node : NULL;
+
+    case TOK_RPAREN:
+        return parse_fail(p, FUNC_CALL_PARENS_MISMATCH, tok.offset);
+
+    default:
+        return parse_fail(p, FUNC_CALL_SYNTAX_ERR, tok.offset);
+    }
+}
+
+/*
+    expr := {OP} operand {{OP} operand}, ended by ',' ')' or the end of input.
+    Operators are not interpreted, only the operands become children.
+    A single operand is returned as it is, and "-123" becomes one NUMBER */
+static substr_node *parse_expr(expr_parser *p)
+{
+    substr_node *expr = new_node(p, SUBSTR_NODE_EXPR, p->tok.offset);
+    if (!expr) {
+        return NULL;
+    }
+
+    substr_node *last = NULL;
+    int n_ops = 0, last_is_op = 0;
+    size_t end = p->tok.offset;
+
+    while (p->tok.kind != TOK_END && p->tok.kind != TOK_COMMA && p->tok.kind != TOK_RPAREN) {
+        if (p->tok.kind == TOK_OP) {
+            n_ops++;
+            last_is_op = 1;
+            end = p->tok.offset + p->tok.length;
+            if (next_token(p) != 0) {
+                return NULL;
+            }
+        } else {
+            substr_node *operand = parse_operand(p);
+            if (!operand) {
+                return NULL;
+            }
+            append_child(expr, &last, operand);
+            last_is_op = 0;
+            end = operand->span.offset + operand->span.length;
+        }
+    }
+
+    if (expr->n_children == 0 || last_is_op) {
+        return parse_fail(p, FUNC_CALL_SYNTAX_ERR, p->tok.offset);
+    }
+    expr->span.length = end - expr->span.offset;
+
+    if (expr->n_children == 1 && n_ops == 0) {
+        return expr->child;
+    }
+
+    // fold a signed numeric constant into one node
+    char sign = p->input[expr->span.offset];
+    if (expr->n_children == 1 && n_ops == 1 && expr->child->kind == SUBSTR_NODE_NUMBER
+        && (sign == '-' || sign == '+')) {
+        substr_node *number = expr->child;
+        if (number->is_int) {
+            number_value(number, p->input + number->span.offset, number->span.length, sign == '-');
+        }
+        number->span = expr->span;
+        return number;
+    }
+
+    return expr;
+}
+
+/*
+    parse an expression in one left-to-right pass: the tokenizer reads every
+    byte once and the parser never backtracks, so the cost is linear in the
+    input length. Nodes are allocated in ctx and live until it is reset.
+*/
+FunctionStatus parse_substr_expr(substr_ctx *ctx, const char *input_str, size_t input_len,
+                        substr_node **root_out, substr_diag *diag)
+{
+    if (!ctx || !input_str || !root_out) {
+        return substr_diag_report(diag, input_str, NULL_INPUT_POINTER, SUBSTR_STAGE_ARGS, 0);
+    }
+
+    expr_parser p = {0};
+    p.input = input_str;
+    p.len   = input_len;
+    p.ctx   = ctx;
+
+    *root_out = NULL;
+    substr_node *root = NULL;
+    if (next_token(&p) == 0) {
+        root = parse_expr(&p);
+    }
+    if (root && p.tok.kind != TOK_END) {
+        parse_fail(&p, p.tok.kind == TOK_RPAREN ? FUNC_CALL_PARENS_MISMATCH : FUNC_CALL_SYNTAX_ERR, p.tok.offset);
+    }
+    if (p.status != RET_SUCCESS) {
+        return substr_diag_report(diag, input_str, p.status, SUBSTR_STAGE_PARSE, p.err_pos);
+    }
+
+    *root_out = root;
+    return substr_diag_report(diag, input_str, RET_SUCCESS, SUBSTR_STAGE_NONE, 0);
+}
+
+/*
+    output of translate_substr_expr, writes stop once the buffer is full
+    but the length keeps counting, so a NULL buffer gives the size */
+typedef struct {
+    const char *input ;
+    const substr_func_syntax *f_syntax ;
+    char  *buf    ;
+    size_t cap    ;
+    size_t len    ;
+    FunctionStatus status ;
+    substr_stage stage    ;
+    size_t err_pos        ;
+} expr_emitter;
+
+static void emit_bytes(expr_emitter *e, const char *s, size_t n)
+{
+    if (e->buf && e->len + n < e->cap) {
+        memcpy(e->buf + e->len, s, n);
+    }
+    e->len += n;
+}
+
+static FunctionStatus emit_fail(expr_emitter *e, FunctionStatus status, substr_stage stage, size_t err_pos)
+{
+    e->status  = status;
+    e->stage   = stage;
+    e->err_pos = err_pos;
+    return status;
+}
+
+static int is_substr_call(const expr_emitter *e, const substr_node *node)
+{
+    static const char call_name[] = SUBSTR_EXPR_CALL_NAME;
+    if (node->kind != SUBSTR_NODE_CALL || node->name.length != sizeof(call_name) - 1) {
+        return 0;
+    }
+    const char *name = e->input + node->name.offset;
+    for (size_t i = 0; i < node->name.length; i++) {
+        if (toupper((unsigned char)name[i]) != call_name[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static FunctionStatus emit_node(expr_emitter *e, const substr_node *node, int is_root);
+
+/*
+    emit a substr call in the target syntax, its first argument translated
+    recursively and the start position and length checked against the target */
+static FunctionStatus emit_substr_call(expr_emitter *e, const substr_node *call)
+{
+    const substr_node *arg    = call->child;
+    const substr_node *start  = arg ? arg->next : NULL;
+    const substr_node *length = start ? start->next : NULL;
+
+    if (!start) {
+        return emit_fail(e, FUNC_CALL_WRONG_START_POS, SUBSTR_STAGE_PARSE, call->span.offset + call->span.length - 1);
+    }
+    if (start->kind != SUBSTR_NODE_NUMBER || !start->is_int) {
+        return emit_fail(e, FUNC_CALL_WRONG_START_POS, SUBSTR_STAGE_PARSE, start->span.offset);
+    }
+    if (length && (length->next || length->kind != SUBSTR_NODE_NUMBER || !length->is_int)) {
+        const substr_node *bad = length->next ? length->next : length;
+        return emit_fail(e, FUNC_CALL_WRONG_LENGTH, SUBSTR_STAGE_PARSE, bad->span.offset);
+    }
+
+    substr_func_view f_view = {0};
+    f_view.col_name   = arg->span;
+    f_view.start_tok  = start->span;
+    f_view.start_pos  = start->value;
+    if (length) {
+        f_view.length_tok = length->span;
+        f_view.length     = length->value < 0 ? 0 : length->value;  // treat negative length as 0
+    }
+
+    substr_func_ref f_ref;
+    FunctionStatus rc = gen_substr_func_ref(e->f_syntax, e->input, &f_view, &f_ref);
+    if (rc != RET_SUCCESS) {
+        return emit_fail(e, rc, SUBSTR_STAGE_GENERATE, start->span.offset);
+    }
+
+    emit_bytes(e, f_ref.func_name, f_ref.func_name_len);
+    emit_bytes(e, "(", 1);
+    rc = emit_node(e, arg, 0);
+    if (rc != RET_SUCCESS) {
+        return rc;
+    }
+
+    char tail[SUBSTR_CMD_TAIL_MAX + 1];
+    long int tail_len = gen_substr_cmd_tail(&f_ref, tail, sizeof(tail));
+    emit_bytes(e, tail, tail_len);
+    return RET_SUCCESS;
+}
+
+/*
+    emit a node as written in the input, with the substr calls inside it translated */
+static FunctionStatus emit_node(expr_emitter *e, const substr_node *node, int is_root)
+{
+    if (node->kind == SUBSTR_NODE_CALL && (is_root || is_substr_call(e, node))) {
+        return emit_substr_call(e, node);
+    }
+
+    size_t from = node->span.offset;
+    for (const substr_node *child = node->child; child; child = child->next) {
+        emit_bytes(e, e->input + from, child->span.offset - from);
+        FunctionStatus rc = emit_node(e, child, 0);
+        if (rc != RET_SUCCESS) {
+            return rc;
+        }
+        from = child->span.offset + child->span.length;
+    }
+    emit_bytes(e, e->input + from, node->span.offset + node->span.length - from);
+    return RET_SUCCESS;
+}
+
+/*
+    walk the tree from node into the caller's buffer, null-terminated */
+static FunctionStatus emit_tree(const char *input_str, const substr_node *node, int is_root,
+                        const substr_func_syntax *f_syntax, char *out_substr_string, size_t out_str_len,
+                        size_t *out_str_wrt, substr_diag *diag)
+{
+    expr_emitter e = {0};
+    e.input    = input_str;
+    e.f_syntax = f_syntax;
+    e.buf      = out_substr_string;
+    e.cap      = out_str_len;
+
+    FunctionStatus rc = emit_node(&e, node, is_root);
+    if (rc != RET_SUCCESS) {
+        return substr_diag_report(diag, input_str, rc, e.stage, e.err_pos);
+    }
+
+    if (out_substr_string) {
+        if (e.len >= out_str_len) {
+            return substr_diag_report(diag, input_str, TOO_SHORT_OUTPUT_BUFFER, SUBSTR_STAGE_EMIT,
+                                      node->span.offset + node->span.length);
+        }
+        out_substr_string[e.len] = '\0';
+    }
+    out_str_wrt[0] = e.len;
+
+    return substr_diag_report(diag, input_str, RET_SUCCESS, SUBSTR_STAGE_NONE, 0);
+}
+
+/*
+    Given an input substr function call whose first argument may be any
+    expression, including nested substr calls, and a target DBMS syntax,
+    translate it in one parse and one walk over the tree.
+    The tree is allocated in ctx, reset it between inputs or batches.
+    Pass a NULL out_substr_string to only get the exact output length in out_str_wrt.
+    return: 0: success
+           != 0: error code, also described in diag (may be NULL)
+*/
+FunctionStatus translate_substr_expr(substr_ctx *ctx, const char *input_str, const substr_func_syntax *f_syntax,
+                        char *out_substr_string, size_t out_str_len, size_t *out_str_wrt, substr_diag *diag)
+{
+    if (!ctx || !input_str || !f_syntax || (out_substr_string && out_str_len == 0) || !out_str_wrt) {
+        return substr_diag_report(diag, input_str, NULL_INPUT_POINTER, SUBSTR_STAGE_ARGS, 0);
+    }
+
+    size_t input_len = strlen(input_str);
+    substr_node *root = NULL;
+    FunctionStatus rc = parse_substr_expr(ctx, input_str, input_len, &root, diag);
+    if (rc != RET_SUCCESS) {
+        return rc;
+    }
+    if (root->kind != SUBSTR_NODE_CALL) {
+        return substr_diag_report(diag, input_str, FUNC_CALL_PARENS_MISMATCH, SUBSTR_STAGE_PARSE, root->span.offset);
+    }
+
+    return emit_tree(input_str, root, 1, f_syntax, out_substr_string, out_str_len, out_str_wrt, diag);
+}
+
+/*
+    emit the text of node, nested substr calls translated; see translate_substr_expr */
+FunctionStatus emit_substr_expr(const char *input_str, const substr_node *node, const substr_func_syntax *f_syntax,
+                        char *out_substr_string, size_t out_str_len, size_t *out_str_wrt, substr_diag *diag)
+{
+    if (!input_str || !node || !f_syntax || (out_substr_string && out_str_len == 0) || !out_str_wrt) {
+        return substr_diag_report(diag, input_str, NULL_INPUT_POINTER, SUBSTR_STAGE_ARGS, 0);
+    }
+    return emit_tree(input_str, node, 0, f_syntax, out_substr_string, out_str_len, out_str_wrt, diag);
+}
@@ -0,0 +1,58 @@
+#ifndef __substr_expr_h__
+#define __substr_expr_h__
+
+#include "substr_wrapper.h"
+
+// deepest nesting of parentheses and calls accepted by the parser
+#define SUBSTR_EXPR_MAX_DEPTH  256
+
+// function name of the nested calls translated by translate_substr_expr,
+// matched case-insensitively
+#define SUBSTR_EXPR_CALL_NAME  "SUBSTR"
+
+typedef enum {
+    SUBSTR_NODE_IDENT = 0,  /* column or keyword */
+    SUBSTR_NODE_NUMBER,     /* numeric constant, a leading sign is folded in */
+    SUBSTR_NODE_STRING,     /* "..." or '...' literal, quotes included */
+    SUBSTR_NODE_CALL,       /* name(arg, ...), the arguments are the children */
+    SUBSTR_NODE_GROUP,      /* (expr) */
+    SUBSTR_NODE_EXPR,       /* operands joined by operators, the operands are the children */
+    SUBSTR_NODE_PARAM,      /* ? placeholder of a template */
+} substr_node_kind;
+
+typedef struct substr_node_struct substr_node;
+
+// node of an expression tree, allocated in a substr_ctx.
+// Text between the children (operators, commas) is not stored,
+// it is read back from the input through the spans
+struct substr_node_struct {
+    substr_node_kind kind ;
+    int is_int            ;  /* NUMBER: integer that fits in value */
+    int n_children        ;
+    substr_view span      ;  /* whole node in the input */
+    substr_view name      ;  /* CALL: function name */
+    long int value        ;  /* NUMBER: value if is_int */
+    substr_node *child    ;  /* first child */
+    substr_node *next     ;  /* next sibling */
+};
+
+// Parse an expression in one pass over input_str into a tree allocated in ctx,
+// failures are described in diag (may be NULL)
+FunctionStatus parse_substr_expr(substr_ctx *ctx, const char *input_str, size_t input_len,
+                        substr_node **root_out, substr_diag *diag);
+
+// Translate a substr call whose first argument can be any expression.
+// The outermost call is translated whatever its name, nested calls named
+// SUBSTR_EXPR_CALL_NAME are translated recursively, everything else is
+// copied as written. Start position and length must be integer constants.
+// A NULL out_substr_string returns the exact output length in out_str_wrt
+FunctionStatus translate_substr_expr(substr_ctx *ctx, const char *input_str, const substr_func_syntax *f_syntax,
+                        char *out_substr_string, size_t out_str_len, size_t *out_str_wrt, substr_diag *diag);
+
+// Emit the text of node with the nested calls named SUBSTR_EXPR_CALL_NAME
+// translated, node itself included. A NULL out_substr_string returns the
+// exact output length in out_str_wrt
+FunctionStatus emit_substr_expr(const char *input_str, const substr_node *node, const substr_func_syntax *f_syntax,
+                        char *out_substr_string, size_t out_str_len, size_t *out_str_wrt, substr_diag *diag);
+
+#endif // __substr_expr_h__
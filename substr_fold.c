@@ -0,0 +1,114 @@
+#include "substr_fold.h"
+
+/*
+    evaluate SUBSTR(lit, start_pos, length) the way the target DBMS would.
+    start_pos is in the input's 1-based positions: the target receives
+    start_pos + shift_start in a base of 1 + shift_start, which selects the
+    same character, so the rules below work on input positions.
+    - start_pos < 0 counts from the end, only if the target allows it
+    - start_pos 0 is the first char on targets allowing negative starts (Oracle),
+      elsewhere the window starts before the first char and loses one char
+    - length 0 (or omitted, or negative) runs to the end
+    return RET_SUCCESS or SUBSTR_STARTPOS_NEGATIVE
+*/
+FunctionStatus fold_substr_literal(const substr_func_syntax *f_syntax, const char *lit, size_t lit_len,
+                        long int start_pos, long int length, substr_view *result)
+{
+    if (!f_syntax || !lit || !result) {
+        return NULL_INPUT_POINTER; // Error: Null pointer
+    }
+
+    if (start_pos < 0 && f_syntax->neg_start <= 0) {
+        return SUBSTR_STARTPOS_NEGATIVE;
+    }
+
+    long int n_chars = (long int)substr_scan_utf8_count(lit, lit_len);
+
+    // Oracle returns NULL for a start before the string, that is an empty literal
+    if (start_pos < -n_chars) {
+        result->offset = 0;
+        result->length = 0;
+        return RET_SUCCESS;
+    }
+
+    // first char of the window, counted from 0, may be out of [0, n_chars]
+    long int begin;
+    if (start_pos < 0) {
+        begin = n_chars + start_pos;
+    } else if (start_pos == 0) {
+        begin = f_syntax->neg_start > 0 ? 0 : -1;
+    } else {
+        begin = start_pos - 1;
+    }
+
+    long int end;
+    if (length <= 0) {
+        end = n_chars;
+    } else if (begin >= 0) {
+        end = length > n_chars - begin ? n_chars : begin + length;
+    } else {
+        end = length <= -begin ? 0 : begin + length;
+    }
+
+    if (begin < 0) {
+        begin = 0;
+    }
+    if (begin > n_chars) {
+        begin = n_chars;
+    }
+    if (end < begin) {
+        end = begin;
+    }
+
+    result->offset = substr_scan_utf8_offset(lit, lit_len, begin);
+    result->length = substr_scan_utf8_offset(lit + result->offset, lit_len - result->offset, end - begin);
+
+    return RET_SUCCESS;
+}
+
+/*
+    Given an input substr function call and a target DBMS syntax, write the
+    literal the call evaluates to if its first argument is a double-quoted
+    literal, otherwise translate it with translate_substr_func_diag.
+    A literal holding more quotes than its own two is not folded.
+    Pass a NULL out_substr_string to only get the exact output length in out_str_wrt.
+*/
+FunctionStatus translate_substr_func_fold(const char *input_str, const substr_func_syntax *f_syntax,
+                        char *out_substr_string, size_t out_str_len, size_t *out_str_wrt, substr_diag *diag)
+{
+    if (!input_str || !f_syntax || (out_substr_string && out_str_len == 0) || !out_str_wrt) {
+        return substr_diag_report(diag, input_str, NULL_INPUT_POINTER, SUBSTR_STAGE_ARGS, 0);
+    }
+
+    substr_func_view f_view = {0};
+    FunctionStatus rc = parse_substr_call_view_diag(input_str, strlen(input_str), &f_view, diag);
+    if (rc != RET_SUCCESS) {
+        return rc;
+    }
+
+    const char *lit   = input_str + f_view.col_name.offset + 1;
+    size_t lit_len    = f_view.col_name.length >= 2 ? f_view.col_name.length - 2 : 0;
+    if (input_str[f_view.col_name.offset] != '"' || memchr(lit, '"', lit_len)) {
+        return translate_substr_func_diag(input_str, f_syntax, out_substr_string, out_str_len, out_str_wrt, diag);
+    }
+
+    substr_view folded;
+    rc = fold_substr_literal(f_syntax, lit, lit_len, f_view.start_pos, f_view.length, &folded);
+    if (rc != RET_SUCCESS) {
+        return substr_diag_report(diag, input_str, rc, SUBSTR_STAGE_GENERATE, f_view.start_tok.offset);
+    }
+
+    size_t cmd_len = folded.length + 2;
+    if (out_substr_string) {
+        if (cmd_len >= out_str_len) {
+            return substr_diag_report(diag, input_str, TOO_SHORT_OUTPUT_BUFFER, SUBSTR_STAGE_EMIT, strlen(input_str));
+        }
+        out_substr_string[0] = '"';
+        memcpy(out_substr_string + 1, lit + folded.offset, folded.length);
+        out_substr_string[cmd_len - 1] = '"';
+        out_substr_string[cmd_len] = '\0';
+    }
+    out_str_wrt[0] = cmd_len;
+
+    return substr_diag_report(diag, input_str, RET_SUCCESS, SUBSTR_STAGE_NONE, 0);
+}
@@ -0,0 +1,17 @@
+#ifndef __substr_fold_h__
+#define __substr_fold_h__
+
+#include "substr_wrapper.h"
+
+// Evaluate a substr call on the body of a string literal (quotes excluded)
+// with the rules of the target syntax; positions count UTF-8 code points.
+// The result is returned as a byte range of lit in result
+FunctionStatus fold_substr_literal(const substr_func_syntax *f_syntax, const char *lit, size_t lit_len,
+                        long int start_pos, long int length, substr_view *result);
+
+// Same as translate_substr_func_diag, but a call on a double-quoted literal
+// is replaced by the literal it evaluates to, e.g. SUBSTR("abcdef", 2, 3) -> "bcd"
+FunctionStatus translate_substr_func_fold(const char *input_str, const substr_func_syntax *f_syntax,
+                        char *out_substr_string, size_t out_str_len, size_t *out_str_wrt, substr_diag *diag);
+
+#endif // __substr_fold_h__
@@ -0,0 +1,278 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "substr_intern.h"
+
+/*
+    one interned identifier, allocated in the arena of its shard. The
+    handle given out is str, the header sits just before it */
+typedef struct intern_entry_struct {
+    uint64_t hash ;
+    size_t   len  ;
+    char     str[];
+} intern_entry;
+
+/*
+    open-addressing table of entries, never more than half full. A grown
+    table replaces the old one, which is kept for readers still probing it */
+typedef struct intern_table_struct intern_table;
+struct intern_table_struct {
+    intern_table *retired ;     /* tables this one replaced */
+    size_t mask           ;
+    intern_entry *slots[] ;
+};
+
+/*
+    a shard: readers probe the table without locking, inserts take the lock */
+typedef struct intern_shard_struct {
+    intern_table   *table ;
+    pthread_mutex_t lock  ;
+    substr_ctx      arena ;
+    size_t n_idents, ident_bytes, table_bytes;
+} __attribute__((aligned(64))) intern_shard;
+
+struct substr_intern_struct {
+    intern_shard shards[SUBSTR_INTERN_SHARDS];
+};
+
+/*
+    FNV-1a over the identifier, mixed so that the top bits pick the shard */
+static uint64_t intern_hash(const char *str, size_t len)
+{
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)str[i];
+        h *= 1099511628211ULL;
+    }
+    return h ^ (h >> 29) * 0xbf58476d1ce4e5b9ULL;
+}
+
+/*
+    probe a table for str, safe without the lock: slots are written once,
+    after the entry they point to. return the handle, or NULL */
+static const char *intern_find(const intern_table *table, uint64_t hash, const char *str, size_t len)
+{
+    for (size_t s = hash & table->mask;; s = (s + 1) & table->mask) {
+        const intern_entry *entry = __atomic_load_n(&table->slots[s], __ATOMIC_ACQUIRE);
+        if (!entry) {
+            return NULL;
+        }
+        if (entry->hash == hash && entry->len == len && (len == 0 || memcmp(entry->str, str, len) == 0)) {
+            return entry->str;
+        }
+    }
+}
+
+/*
+    put an entry in the first free slot of its probe sequence */
+static void intern_place(intern_table *table, intern_entry *entry)
+{
+    size_t s = entry->hash & table->mask;
+    while (table->slots[s]) {
+        s = (s + 1) & table->mask;
+    }
+    __atomic_store_n(&table->slots[s], entry, __ATOMIC_RELEASE);
+}
+
+static intern_table *intern_table_create(size_t n_slots, size_t *table_bytes)
+{
+    intern_table *table = calloc(1, sizeof(intern_table) + n_slots * sizeof(intern_entry *));
+    if (table) {
+        table->mask = n_slots - 1;
+        *table_bytes += sizeof(intern_table) + n_slots * sizeof(intern_entry *);
+    }
+    return table;
+}
+
+/*
+    double the table of a shard, called with the lock held. The new table
+    is filled before it is published, readers of the old one that miss
+    come to the lock and see the new one */
+static int intern_grow(intern_shard *shard)
+{
+    intern_table *old = shard->table;
+    intern_table *table = intern_table_create(2 * (old->mask + 1), &shard->table_bytes);
+    if (!table) {
+        return -1;
+    }
+    for (size_t s = 0; s <= old->mask; s++) {
+        if (old->slots[s]) {
+            intern_place(table, old->slots[s]);
+        }
+    }
+    table->retired = old;
+    __atomic_store_n(&shard->table, table, __ATOMIC_RELEASE);
+    return 0;
+}
+
+void substr_intern_destroy(substr_intern *pool)
+{
+    if (!pool) {
+        return;
+    }
+    for (int k = 0; k < SUBSTR_INTERN_SHARDS; k++) {
+        intern_shard *shard = &pool->shards[k];
+        intern_table *table = shard->table;
+        while (table) {
+            intern_table *retired = table->retired;
+            free(table);
+            table = retired;
+        }
+        substr_ctx_destroy(&shard->arena);
+        pthread_mutex_destroy(&shard->lock);
+    }
+    free(pool);
+}
+
+substr_intern *substr_intern_create(void)
+{
+    void *mem = NULL;
+    if (posix_memalign(&mem, 64, sizeof(substr_intern)) != 0) {
+        return NULL;
+    }
+
+    substr_intern *pool = mem;
+    memset(pool, 0, sizeof(*pool));
+    for (int k = 0; k < SUBSTR_INTERN_SHARDS; k++) {
+        intern_shard *shard = &pool->shards[k];
+        pthread_mutex_init(&shard->lock, NULL);
+        substr_ctx_init(&shard->arena, NULL);
+        shard->table = intern_table_create(SUBSTR_INTERN_MIN_SLOTS, &shard->table_bytes);
+        if (!shard->table) {
+            for (k++; k < SUBSTR_INTERN_SHARDS; k++) {
+                pthread_mutex_init(&pool->shards[k].lock, NULL);
+            }
+            substr_intern_destroy(pool);
+            return NULL;
+        }
+    }
+    return pool;
+}
+
+/*
+    look the identifier up in its shard without locking; on a miss, take
+    the shard lock, look again in the current table and insert it
+*/
+const char *substr_intern_ident(substr_intern *pool, const char *str, size_t len)
+{
+    if (!pool || (!str && len > 0)) {
+        return NULL;
+    }
+
+    uint64_t hash = intern_hash(str, len);
+    intern_shard *shard = &pool->shards[hash >> 60 & (SUBSTR_INTERN_SHARDS - 1)];
+    const char *ident = intern_find(__atomic_load_n(&shard->table, __ATOMIC_ACQUIRE), hash, str, len);
+    if (ident) {
+        return ident;
+    }
+
+    pthread_mutex_lock(&shard->lock);
+    ident = intern_find(shard->table, hash, str, len);
+    if (!ident && (2 * (shard->n_idents + 1) <= shard->table->mask + 1 || intern_grow(shard) == 0)) {
+        intern_entry *entry = substr_ctx_alloc(&shard->arena, offsetof(intern_entry, str) + len + 1);
+        if (entry) {
+            entry->hash = hash;
+            entry->len  = len;
+            if (len > 0) {
+                memcpy(entry->str, str, len);
+            }
+            entry->str[len] = '\0';
+            intern_place(shard->table, entry);
+            shard->n_idents++;
+            shard->ident_bytes += len;
+            ident = entry->str;
+        }
+    }
+    pthread_mutex_unlock(&shard->lock);
+    return ident;
+}
+
+size_t substr_intern_len(const char *ident)
+{
+    return ((const intern_entry *)(ident - offsetof(intern_entry, str)))->len;
+}
+
+void substr_intern_get_stats(substr_intern *pool, substr_intern_stats *stats)
+{
+    if (!stats) {
+        return;
+    }
+    memset(stats, 0, sizeof(*stats));
+    if (!pool) {
+        return;
+    }
+
+    stats->mem_bytes = sizeof(*pool);
+    for (int k = 0; k < SUBSTR_INTERN_SHARDS; k++) {
+        intern_shard *shard = &pool->shards[k];
+        pthread_mutex_lock(&shard->lock);
+        stats->n_idents    += shard->n_idents;
+        stats->ident_bytes += shard->ident_bytes;
+        stats->mem_bytes   += shard->table_bytes + shard->arena.n_sys_bytes;
+        pthread_mutex_unlock(&shard->lock);
+    }
+}
+
+/*
+    Parse input substr function call string, the column name is interned:
+    a column seen before costs no allocation and compares with ==
+*/
+FunctionStatus parse_substr_call_intern(substr_intern *pool, const char *input_str, substr_func *f_struct_out)
+{
+    if (!pool || !input_str || !f_struct_out) {
+        return NULL_INPUT_POINTER; // Error: Null pointer
+    }
+
+    f_struct_out->func_name = NULL;
+    f_struct_out->col_name  = NULL;
+
+    substr_func_view f_view = {0};
+    FunctionStatus rc = parse_substr_call_view(input_str, strlen(input_str), &f_view);
+    if (rc != RET_SUCCESS) {
+        return rc;
+    }
+
+    const char *col_name = substr_intern_ident(pool, input_str + f_view.col_name.offset, f_view.col_name.length);
+    if (!col_name) {
+        return MEMORY_ALLOCATION_ERR; // Error: Memory allocation failed
+    }
+
+    f_struct_out->col_name  = (char *)col_name;
+    f_struct_out->start_pos = f_view.start_pos;
+    f_struct_out->length    = f_view.length;
+
+    return RET_SUCCESS; // Success
+}
+
+/*
+    generate a translated substring function with interned names.
+    return RET_SUCCESS, SUBSTR_STARTPOS_NEGATIVE or MEMORY_ALLOCATION_ERR */
+FunctionStatus gen_substr_func_intern(substr_intern *pool, const substr_func_syntax *f_syntax,
+                    const substr_func *f_struct_in, substr_func *f_struct_out)
+{
+    if (!pool || !f_syntax || !f_syntax->func_name || !f_struct_in || !f_struct_out || !f_struct_in->col_name) {
+        return NULL_INPUT_POINTER; // Error: Null pointer
+    }
+
+    // check if negative start position is allowed
+    if (f_struct_in->start_pos < 0 && f_syntax->neg_start <= 0) {
+        return SUBSTR_STARTPOS_NEGATIVE;
+    }
+
+    size_t func_name_len = f_syntax->func_name_len ? f_syntax->func_name_len : strlen(f_syntax->func_name);
+    const char *func_name = substr_intern_ident(pool, f_syntax->func_name, func_name_len);
+    const char *col_name  = substr_intern_ident(pool, f_struct_in->col_name, strlen(f_struct_in->col_name));
+    if (!func_name || !col_name) {
+        return MEMORY_ALLOCATION_ERR; // Error: Memory allocation failed
+    }
+
+    f_struct_out->func_name = (char *)func_name;
+    f_struct_out->col_name  = (char *)col_name;
+    f_struct_out->start_pos = f_struct_in->start_pos + f_syntax->shift_start;
+    f_struct_out->length    = f_struct_in->length;
+
+    return RET_SUCCESS; // Success
+}
@@ -0,0 +1,45 @@
+#ifndef __substr_intern_h__
+#define __substr_intern_h__
+
+#include "substr_wrapper.h"
+
+// independent hash tables of a pool, inserts only lock the one they go to
+#define SUBSTR_INTERN_SHARDS    16
+// initial slots of the table of a shard, doubled when half full
+#define SUBSTR_INTERN_MIN_SLOTS 64
+
+typedef struct substr_intern_struct substr_intern;
+
+typedef struct substr_intern_stats_struct {
+    size_t n_idents    ;  /* distinct identifiers in the pool */
+    size_t ident_bytes ;  /* their total length */
+    size_t mem_bytes   ;  /* memory used by the pool: arenas and tables */
+} substr_intern_stats;
+
+// create an empty pool, NULL if out of memory
+substr_intern *substr_intern_create(void);
+
+// release a pool and every identifier in it, no thread may be using it
+void substr_intern_destroy(substr_intern *pool);
+
+// Handle of str[0, len): a null-terminated copy owned by the pool, the same
+// pointer for equal strings, so handles compare with ==. Lookups of known
+// identifiers take no lock and allocate nothing. Safe from any thread.
+// NULL if out of memory
+const char *substr_intern_ident(substr_intern *pool, const char *str, size_t len);
+
+// length of an identifier returned by substr_intern_ident, without strlen
+size_t substr_intern_len(const char *ident);
+
+// sum the counters of every shard, safe while other threads use the pool
+void substr_intern_get_stats(substr_intern *pool, substr_intern_stats *stats);
+
+// same as parse_substr_call_ctx, col_name is a handle of pool; it must not
+// be freed or modified and lives until the pool is destroyed
+FunctionStatus parse_substr_call_intern(substr_intern *pool, const char *input_str, substr_func *f_struct_out);
+
+// same as gen_substr_func_ctx, both names of f_struct_out are handles of pool
+FunctionStatus gen_substr_func_intern(substr_intern *pool, const substr_func_syntax *f_syntax,
+                    const substr_func *f_struct_in, substr_func *f_struct_out);
+
+#endif // __substr_intern_h__
@@ -0,0 +1,255 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "substr_daemon.h"
+
+/*
+    Load generator of the translation daemon.
+
+    Usage: c-substr-loadgen SOCKET [-c CONNECTIONS] [-d DEPTH] [-n REQUESTS] [-i DBMS_ID]
+
+    Every connection runs on its own thread and keeps DEPTH requests in
+    flight, so requests are pipelined. The latency of a request is measured
+    from the write that sends it to the read that completes its response.
+    A summary is printed as one JSON object.
+*/
+
+#define LOADGEN_MAX_CONNS  256
+
+static const char *loadgen_inputs[] = {
+    "SUBSTR(col_name, 2, 5)",
+    "SUBSTR(col_name, -1, 5)",
+    "SUBSTR(\"an interesting test for substring function(), cool\", 1)",
+    "SUBSTR(customer_last_name, 10, 20)",
+};
+#define LOADGEN_N_INPUTS  (sizeof(loadgen_inputs) / sizeof(loadgen_inputs[0]))
+
+typedef struct {
+    const char *socket_path ;
+    int dbms_id ;
+    size_t depth ;
+    size_t n_requests ;
+    unsigned long long *latency_ns ;    /* one per request */
+    size_t n_ok, n_failed ;
+    int error ;
+} loadgen_conn;
+
+static unsigned long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int write_all(int fd, const unsigned char *buf, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static int connect_socket(const char *socket_path)
+{
+    struct sockaddr_un addr = {0};
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, socket_path, strlen(socket_path) + 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+/*
+    one connection: send until depth requests are in flight, then read
+    whatever responses arrived, until every request is answered */
+static void *loadgen_run(void *arg)
+{
+    loadgen_conn *c = arg;
+    int fd = connect_socket(c->socket_path);
+    unsigned long long *sent_ns = malloc(c->depth * sizeof(*sent_ns));
+    size_t out_cap = c->depth * (SUBSTR_DAEMON_REQ_HEADER + 128);
+    unsigned char *out = malloc(out_cap);
+    size_t in_cap = 64 * 1024, in_len = 0;
+    unsigned char *in = malloc(in_cap);
+    if (fd < 0 || !sent_ns || !out || !in) {
+        c->error = 1;
+        goto END;
+    }
+
+    size_t sent = 0, received = 0;
+    while (received < c->n_requests) {
+        size_t out_len = 0;
+        unsigned long long t = now_ns();
+        while (sent < c->n_requests && sent - received < c->depth) {
+            const char *input = loadgen_inputs[sent % LOADGEN_N_INPUTS];
+            size_t input_len = strlen(input);
+            unsigned char *frame = out + out_len;
+            substr_daemon_put_u32(frame, (uint32_t)(SUBSTR_DAEMON_REQ_HEADER - 4 + input_len));
+            substr_daemon_put_u32(frame + 4, (uint32_t)sent);
+            frame[8]  = (unsigned char)c->dbms_id;
+            frame[9]  = (unsigned char)(c->dbms_id >> 8);
+            frame[10] = frame[11] = 0;
+            memcpy(frame + SUBSTR_DAEMON_REQ_HEADER, input, input_len);
+            out_len += SUBSTR_DAEMON_REQ_HEADER + input_len;
+            sent_ns[sent % c->depth] = t;
+            sent++;
+        }
+        if (out_len > 0 && write_all(fd, out, out_len) != 0) {
+            c->error = 1;
+            goto END;
+        }
+
+        ssize_t n = read(fd, in + in_len, in_cap - in_len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            c->error = 1;
+            goto END;
+        }
+        in_len += n;
+        t = now_ns();
+
+        size_t pos = 0;
+        while (in_len - pos >= SUBSTR_DAEMON_RESP_HEADER) {
+            uint32_t length = substr_daemon_get_u32(in + pos);
+            if (in_len - pos < 4 + (size_t)length) {
+                break;
+            }
+            uint32_t id = substr_daemon_get_u32(in + pos + 4);
+            int32_t status = (int32_t)substr_daemon_get_u32(in + pos + 8);
+            if (id != (uint32_t)received) {
+                c->error = 1;   // responses must come back in order
+                goto END;
+            }
+            c->latency_ns[received] = t - sent_ns[received % c->depth];
+            if (status == RET_SUCCESS) {
+                c->n_ok++;
+            } else {
+                c->n_failed++;
+            }
+            received++;
+            pos += 4 + (size_t)length;
+        }
+        memmove(in, in + pos, in_len - pos);
+        in_len -= pos;
+    }
+
+END:
+    if (fd >= 0) {
+        close(fd);
+    }
+    free(sent_ns);
+    free(out);
+    free(in);
+    return NULL;
+}
+
+static int compare_ull(const void *a, const void *b)
+{
+    unsigned long long x = *(const unsigned long long *)a, y = *(const unsigned long long *)b;
+    return x < y ? -1 : x > y;
+}
+
+int main(int argc, char **argv)
+{
+    const char *socket_path = NULL;
+    long n_conns = 4, depth = 32, n_requests = 100000, dbms_id = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            n_conns = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            depth = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            n_requests = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            dbms_id = atol(argv[++i]);
+        } else if (!socket_path) {
+            socket_path = argv[i];
+        } else {
+            socket_path = NULL;
+            break;
+        }
+    }
+    if (!socket_path || n_conns < 1 || n_conns > LOADGEN_MAX_CONNS || depth < 1 || n_requests < 1 || dbms_id < 0) {
+        fprintf(stderr, "Usage: %s SOCKET [-c CONNECTIONS] [-d DEPTH] [-n REQUESTS] [-i DBMS_ID]\n", argv[0]);
+        return 2;
+    }
+
+    loadgen_conn conns[LOADGEN_MAX_CONNS];
+    pthread_t threads[LOADGEN_MAX_CONNS];
+    unsigned long long *latency_ns = malloc((size_t)n_conns * n_requests * sizeof(*latency_ns));
+    if (!latency_ns) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    unsigned long long start = now_ns();
+    for (long i = 0; i < n_conns; i++) {
+        memset(&conns[i], 0, sizeof(conns[i]));
+        conns[i].socket_path = socket_path;
+        conns[i].dbms_id     = (int)dbms_id;
+        conns[i].depth       = depth;
+        conns[i].n_requests  = n_requests;
+        conns[i].latency_ns  = latency_ns + i * n_requests;
+        if (pthread_create(&threads[i], NULL, loadgen_run, &conns[i]) != 0) {
+            conns[i].error = 1;
+            threads[i] = pthread_self();
+        }
+    }
+
+    size_t n_ok = 0, n_failed = 0;
+    int errors = 0;
+    for (long i = 0; i < n_conns; i++) {
+        if (!pthread_equal(threads[i], pthread_self())) {
+            pthread_join(threads[i], NULL);
+        }
+        n_ok     += conns[i].n_ok;
+        n_failed += conns[i].n_failed;
+        errors   += conns[i].error;
+    }
+    double seconds = (now_ns() - start) / 1e9;
+
+    if (errors) {
+        fprintf(stderr, "%d connection(s) failed, is the daemon running on %s?\n", errors, socket_path);
+        free(latency_ns);
+        return 1;
+    }
+
+    size_t total = (size_t)n_conns * n_requests;
+    qsort(latency_ns, total, sizeof(*latency_ns), compare_ull);
+    printf("{\"connections\": %ld, \"depth\": %ld, \"requests\": %zu, \"ok\": %zu, \"failed\": %zu, "
+           "\"seconds\": %.3f, \"requests_per_sec\": %.0f, "
+           "\"p50_us\": %.1f, \"p99_us\": %.1f, \"p999_us\": %.1f, \"max_us\": %.1f}\n",
+           n_conns, depth, total, n_ok, n_failed, seconds, total / seconds,
+           latency_ns[total / 2] / 1e3, latency_ns[total * 99 / 100] / 1e3,
+           latency_ns[total * 999 / 1000] / 1e3, latency_ns[total - 1] / 1e3);
+
+    free(latency_ns);
+    return 0;
+}
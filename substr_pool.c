@@ -0,0 +1,225 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+
+#include "substr_pool.h"
+
+/* 
+    a worker and the range of task indices it still owns */
+typedef struct substr_pool_worker_struct {
+    pthread_mutex_t lock ;
+    size_t next ;           /* next task to run */
+    size_t end  ;           /* one past the last owned task */
+    pthread_t thread ;
+    int index ;
+    substr_pool *pool ;
+} substr_pool_worker;
+
+struct substr_pool_struct {
+    int n_threads ;
+    substr_pool_worker *workers ;
+
+    pthread_mutex_t lock ;
+    pthread_cond_t  run_cond  ;     /* a new run started or shutdown */
+    pthread_cond_t  done_cond ;     /* the current run finished */
+    unsigned long   run_id    ;
+    int             shutdown  ;
+
+    substr_task_fn fn ;
+    void          *arg ;
+    int            n_left ;         /* workers that joined the current run and left it */
+};
+
+/* 
+    take the lowest task of the worker's own range.
+    return 1 and set *task_index, or 0 if the range is empty */
+static int pool_take_own(substr_pool_worker *w, size_t *task_index)
+{
+    int found = 0;
+    pthread_mutex_lock(&w->lock);
+    if (w->next < w->end) {
+        *task_index = w->next++;
+        found = 1;
+    }
+    pthread_mutex_unlock(&w->lock);
+    return found;
+}
+
+/* 
+    move the upper half of a victim's range to an idle worker.
+    return 1 if anything was stolen */
+static int pool_steal(substr_pool_worker *w)
+{
+    substr_pool *pool = w->pool;
+
+    for (int k = 1; k < pool->n_threads; k++) {
+        substr_pool_worker *victim = &pool->workers[(w->index + k) % pool->n_threads];
+        size_t lo = 0, hi = 0;
+
+        pthread_mutex_lock(&victim->lock);
+        size_t left = victim->end - victim->next;
+        if (left > 0) {
+            hi = victim->end;
+            lo = victim->end - (left + 1) / 2;
+            victim->end = lo;
+        }
+        pthread_mutex_unlock(&victim->lock);
+
+        if (hi > lo) {
+            pthread_mutex_lock(&w->lock);
+            w->next = lo;
+            w->end  = hi;
+            pthread_mutex_unlock(&w->lock);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void *pool_worker_main(void *arg)
+{
+    substr_pool_worker *w = arg;
+    substr_pool *pool = w->pool;
+    unsigned long seen_run = 0;
+
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (!pool->shutdown && pool->run_id == seen_run) {
+            pthread_cond_wait(&pool->run_cond, &pool->lock);
+        }
+        if (pool->shutdown) {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        seen_run = pool->run_id;
+        substr_task_fn fn = pool->fn;
+        void *fn_arg = pool->arg;
+        pthread_mutex_unlock(&pool->lock);
+
+        size_t task_index;
+        while (pool_take_own(w, &task_index) || (pool_steal(w) && pool_take_own(w, &task_index))) {
+            fn(fn_arg, task_index);
+        }
+
+        // A worker leaves once no range has tasks left, but another may still
+        // run the last ones. The run is only over once every worker has joined
+        // and left it: no worker then touches the ranges until the next run,
+        // and none can miss a run and join the next one late.
+        pthread_mutex_lock(&pool->lock);
+        if (++pool->n_left == pool->n_threads) {
+            pthread_cond_broadcast(&pool->done_cond);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+substr_pool *substr_pool_create(int n_threads)
+{
+    if (n_threads < 1) {
+        n_threads = 1;
+    }
+
+    substr_pool *pool = calloc(1, sizeof(*pool));
+    if (!pool) {
+        return NULL;
+    }
+    pool->workers = calloc(n_threads, sizeof(*pool->workers));
+    if (!pool->workers) {
+        free(pool);
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->run_cond, NULL);
+    pthread_cond_init(&pool->done_cond, NULL);
+
+    for (int i = 0; i < n_threads; i++) {
+        substr_pool_worker *w = &pool->workers[i];
+        pthread_mutex_init(&w->lock, NULL);
+        w->index = i;
+        w->pool  = pool;
+        if (pthread_create(&w->thread, NULL, pool_worker_main, w) != 0) {
+            pthread_mutex_destroy(&w->lock);
+            break;
+        }
+        pool->n_threads++;
+    }
+    pool->n_left = pool->n_threads;     // no run in progress
+
+    if (pool->n_threads == 0) {
+        substr_pool_destroy(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+void substr_pool_destroy(substr_pool *pool)
+{
+    if (!pool) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->run_cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->n_threads; i++) {
+        pthread_join(pool->workers[i].thread, NULL);
+        pthread_mutex_destroy(&pool->workers[i].lock);
+    }
+
+    pthread_cond_destroy(&pool->done_cond);
+    pthread_cond_destroy(&pool->run_cond);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->workers);
+    free(pool);
+}
+
+FunctionStatus substr_pool_start(substr_pool *pool, substr_task_fn fn, void *arg, size_t n_tasks)
+{
+    if (!pool || !fn) {
+        return NULL_INPUT_POINTER; // Error: Null pointer
+    }
+    if (n_tasks == 0) {
+        return RET_SUCCESS;
+    }
+
+    // split the tasks into one contiguous range per worker, published
+    // together with the new run so a worker sees either all or nothing of it
+    size_t per_worker = n_tasks / pool->n_threads;
+    size_t extra      = n_tasks % pool->n_threads;
+    size_t next = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (int i = 0; i < pool->n_threads; i++) {
+        substr_pool_worker *w = &pool->workers[i];
+        size_t count = per_worker + ((size_t)i < extra);
+        pthread_mutex_lock(&w->lock);
+        w->next = next;
+        w->end  = next + count;
+        pthread_mutex_unlock(&w->lock);
+        next += count;
+    }
+    pool->fn     = fn;
+    pool->arg    = arg;
+    pool->n_left = 0;
+    pool->run_id++;
+    pthread_cond_broadcast(&pool->run_cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    return RET_SUCCESS;
+}
+
+void substr_pool_wait(substr_pool *pool)
+{
+    if (!pool) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->n_left < pool->n_threads) {
+        pthread_cond_wait(&pool->done_cond, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
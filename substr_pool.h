@@ -0,0 +1,30 @@
+#ifndef __substr_pool_h__
+#define __substr_pool_h__
+
+#include <stddef.h>
+
+#include "func_status.h"
+
+// one task of a run, called with the run argument and the task index
+typedef void (*substr_task_fn)(void *arg, size_t task_index);
+
+typedef struct substr_pool_struct substr_pool;
+
+// start a pool of n_threads workers, NULL if out of memory or threads
+substr_pool *substr_pool_create(int n_threads);
+
+// stop the workers and release the pool, no run may be in progress
+void substr_pool_destroy(substr_pool *pool);
+
+// Start running fn(arg, 0) ... fn(arg, n_tasks - 1) on the workers and return
+// at once. Each worker owns a contiguous range of task indices, takes them
+// lowest first, and steals the upper half of another worker's range when its
+// own is empty, so early tasks tend to finish first. One run at a time:
+// call substr_pool_wait before starting the next one.
+FunctionStatus substr_pool_start(substr_pool *pool, substr_task_fn fn, void *arg, size_t n_tasks);
+
+// wait until every task of the current run is finished and every worker has
+// left it, so the pool can be started again
+void substr_pool_wait(substr_pool *pool);
+
+#endif // __substr_pool_h__
@@ -0,0 +1,597 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "substr_registry.h"
+#include "substr_telemetry.h"
+
+// seeds tried for one bucket before the table is rebuilt with twice the slots
+#define REGISTRY_MAX_SEED  (1u << 16)
+
+typedef struct registry_entry_struct {
+    const char *name          ;  /* dialect name, null-terminated */
+    size_t name_len           ;
+    substr_func_syntax syntax ;  /* func_name points into the table text */
+    int DBMS_id               ;  /* telemetry key, see registry_dbms_id */
+} registry_entry;
+
+/*
+    hash-and-displace perfect hash: the high half of the name hash picks a
+    bucket, the seed of the bucket mixed with the hash picks the slot.
+    Seeds are chosen at build time so that no two names share a slot */
+struct substr_registry_table_struct {
+    size_t n_entries  ;
+    size_t slot_mask  ;     /* slots - 1, power of two */
+    size_t bucket_mask;     /* buckets - 1, power of two */
+    uint32_t *seeds   ;     /* per bucket */
+    uint32_t *slots   ;     /* entry index + 1, 0 if empty */
+    registry_entry *entries;
+    char *text        ;     /* names, null-terminated */
+};
+
+/*
+    readers count themselves in the counter of the epoch they began in;
+    a writer swaps the table, moves to the next epoch and waits until the
+    counter of the previous one drains. The counters get their own lines */
+typedef struct registry_readers_struct {
+    unsigned long n ;
+    char pad[64 - sizeof(unsigned long)];
+} registry_readers;
+
+struct substr_registry_struct {
+    registry_readers readers[2];
+    substr_registry_table *current ;
+    unsigned long epoch            ;
+    pthread_mutex_t load_lock      ;  /* serializes the writers */
+};
+
+// one parsed line of a config, names are views into the text
+typedef struct registry_line_struct {
+    substr_view dialect   ;
+    substr_view func_name ;
+    int neg_start         ;
+    int shift_start       ;
+    size_t offset         ;  /* of the line in the text */
+} registry_line;
+
+static char registry_lower(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+}
+
+/*
+    FNV-1a over the lowercased name */
+static uint64_t registry_hash(const char *name, size_t len)
+{
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)registry_lower(name[i]);
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+/*
+    slot of a name hash under a bucket seed, splitmix64 finalizer */
+static uint64_t registry_slot(uint64_t h, uint32_t seed)
+{
+    h += seed * 0x9E3779B97F4A7C15ULL;
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+    return h ^ (h >> 31);
+}
+
+static int registry_name_eq(const char *a, size_t a_len, const char *b, size_t b_len)
+{
+    if (a_len != b_len) {
+        return 0;
+    }
+    for (size_t i = 0; i < a_len; i++) {
+        if (registry_lower(a[i]) != registry_lower(b[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+    DBMS_ID a dialect is counted under in the telemetry, found by its name so
+    that it does not depend on the order of the config. Dialects that are not
+    one of the built-in DBMS count under DBMS_UNKNOWN */
+static int registry_dbms_id(const char *name, size_t name_len)
+{
+    static const char *const dbms_names[DBMS_UNKNOWN] = { "oracle", "sqlserver", "postgresql", "mysql", "sqlite" };
+    for (int i = DBMS_ORACLE; i < DBMS_UNKNOWN; i++) {
+        if (registry_name_eq(dbms_names[i], strlen(dbms_names[i]), name, name_len)) {
+            return i;
+        }
+    }
+    return DBMS_UNKNOWN;
+}
+
+/*
+    dialect names may also hold '-' and '.', e.g. "mysql-5.7" */
+static int registry_is_name_char(char c, int first, int dialect)
+{
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '_'
+        || (!first && c >= '0' && c <= '9')
+        || (!first && dialect && (c == '-' || c == '.'));
+}
+
+static int registry_is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+/*
+    parse an integer field of a config line into [min, max] */
+static int registry_parse_int(const char *text, size_t *pos, size_t len, long min, long max, int *value)
+{
+    size_t i = *pos;
+    int neg = 0;
+    long v = 0;
+
+    if (i < len && (text[i] == '-' || text[i] == '+')) {
+        neg = text[i] == '-';
+        i++;
+    }
+    if (i >= len || text[i] < '0' || text[i] > '9') {
+        return 0;
+    }
+    while (i < len && text[i] >= '0' && text[i] <= '9') {
+        v = v * 10 + (text[i] - '0');
+        if (v > 1000000) {
+            return 0;
+        }
+        i++;
+    }
+    v = neg ? -v : v;
+    if (v < min || v > max) {
+        return 0;
+    }
+    *value = (int)v;
+    *pos = i;
+    return 1;
+}
+
+/*
+    parse the line starting at *pos and move *pos to the next one.
+    return 1 if the line holds an entry, 0 if it is blank or a comment,
+    -1 on a malformed line with *err_pos at the bad field */
+static int registry_parse_line(const char *text, size_t len, size_t *pos, registry_line *line, size_t *err_pos)
+{
+    size_t i = *pos;
+    int field = 0;
+
+    line->offset = i;
+    while (1) {
+        while (i < len && registry_is_space(text[i])) {
+            i++;
+        }
+        if (i >= len || text[i] == '\n' || text[i] == '#') {
+            break;
+        }
+        if (field >= 4) {
+            *err_pos = i;
+            return -1;
+        }
+
+        size_t start = i;
+        int ok = 0;
+        if (field < 2) {
+            while (i < len && registry_is_name_char(text[i], i == start, field == 0)) {
+                i++;
+            }
+            ok = i > start;
+            substr_view *v = field == 0 ? &line->dialect : &line->func_name;
+            v->offset = start;
+            v->length = i - start;
+        } else if (field == 2) {
+            ok = registry_parse_int(text, &i, len, 0, 1, &line->neg_start);
+        } else {
+            ok = registry_parse_int(text, &i, len, -1000, 1000, &line->shift_start);
+        }
+        if (!ok || (i < len && !registry_is_space(text[i]) && text[i] != '\n' && text[i] != '#')) {
+            *err_pos = start;
+            return -1;
+        }
+        field++;
+    }
+
+    while (i < len && text[i] != '\n') {
+        i++;
+    }
+    *pos = i < len ? i + 1 : i;
+
+    if (field == 0) {
+        return 0;
+    }
+    if (field < 4) {
+        *err_pos = line->offset;
+        return -1;
+    }
+    return 1;
+}
+
+/*
+    choose a seed per bucket so that every entry gets its own slot,
+    buckets with the most entries first. return 0 if some bucket found no
+    seed, -1 on duplicate names with *dup set to the second one */
+static int registry_place(substr_registry_table *t, const uint64_t *hashes, size_t *dup)
+{
+    size_t n_buckets = t->bucket_mask + 1;
+    size_t *bucket_start = calloc(n_buckets + 1, sizeof(size_t));
+    size_t *order = malloc((t->n_entries + 1) * sizeof(size_t));
+    size_t *by_size = malloc(n_buckets * sizeof(size_t));
+    int rc = 0;
+
+    if (!bucket_start || !order || !by_size) {
+        rc = -2;
+        goto END;
+    }
+
+    /* entries grouped by bucket, counting sort */
+    for (size_t i = 0; i < t->n_entries; i++) {
+        bucket_start[(hashes[i] >> 32) & t->bucket_mask]++;
+    }
+    for (size_t b = 1; b < n_buckets; b++) {
+        bucket_start[b] += bucket_start[b - 1];
+    }
+    bucket_start[n_buckets] = t->n_entries;
+    for (size_t i = t->n_entries; i-- > 0;) {
+        order[--bucket_start[(hashes[i] >> 32) & t->bucket_mask]] = i;
+    }
+
+    /* buckets by decreasing size, one sweep per size: buckets hold few entries */
+    size_t max_size = 0;
+    for (size_t b = 0; b < n_buckets; b++) {
+        size_t size = bucket_start[b + 1] - bucket_start[b];
+        max_size = size > max_size ? size : max_size;
+    }
+    size_t n_sorted = 0;
+    for (size_t size = max_size; size > 0; size--) {
+        for (size_t b = 0; b < n_buckets; b++) {
+            if (bucket_start[b + 1] - bucket_start[b] == size) {
+                by_size[n_sorted++] = b;
+            }
+        }
+    }
+
+    for (size_t k = 0; k < n_sorted; k++) {
+        size_t b = by_size[k];
+        size_t first = bucket_start[b], last = bucket_start[b + 1];
+
+        for (size_t i = first; i < last; i++) {
+            for (size_t j = first; j < i; j++) {
+                const registry_entry *x = &t->entries[order[i]], *y = &t->entries[order[j]];
+                if (registry_name_eq(x->name, x->name_len, y->name, y->name_len)) {
+                    *dup = order[i] > order[j] ? order[i] : order[j];
+                    rc = -1;
+                    goto END;
+                }
+            }
+        }
+
+        uint32_t seed;
+        for (seed = 1; seed < REGISTRY_MAX_SEED; seed++) {
+            size_t i;
+            for (i = first; i < last; i++) {
+                size_t slot = registry_slot(hashes[order[i]], seed) & t->slot_mask;
+                if (t->slots[slot]) {
+                    break;
+                }
+                t->slots[slot] = (uint32_t)order[i] + 1;
+            }
+            if (i == last) {
+                break;
+            }
+            while (i-- > first) {
+                t->slots[registry_slot(hashes[order[i]], seed) & t->slot_mask] = 0;
+            }
+        }
+        if (seed == REGISTRY_MAX_SEED) {
+            goto END;
+        }
+        t->seeds[b] = seed;
+    }
+    rc = 1;
+
+END:
+    free(bucket_start);
+    free(order);
+    free(by_size);
+    return rc;
+}
+
+/*
+    build the table of the lines of a config, in one allocation */
+static FunctionStatus registry_build(const char *text, const registry_line *lines, size_t n_lines,
+                        substr_registry_table **table_out, size_t *err_pos)
+{
+    size_t text_bytes = 0;
+    for (size_t i = 0; i < n_lines; i++) {
+        text_bytes += lines[i].dialect.length + 1 + lines[i].func_name.length + 1;
+    }
+
+    uint64_t *hashes = malloc((n_lines + 1) * sizeof(uint64_t));
+    if (!hashes) {
+        return MEMORY_ALLOCATION_ERR;
+    }
+    for (size_t i = 0; i < n_lines; i++) {
+        hashes[i] = registry_hash(text + lines[i].dialect.offset, lines[i].dialect.length);
+    }
+
+    FunctionStatus rc = RET_SUCCESS;
+    substr_registry_table *t = NULL;
+    size_t n_slots = 2;
+    while (n_slots < 2 * n_lines) {
+        n_slots *= 2;
+    }
+
+    while (1) {
+        size_t n_buckets = n_slots / 2;
+        size_t size = sizeof(*t) + n_lines * sizeof(registry_entry)
+                    + (n_slots + n_buckets) * sizeof(uint32_t) + text_bytes;
+        t = calloc(1, size);
+        if (!t) {
+            rc = MEMORY_ALLOCATION_ERR;
+            goto END;
+        }
+        t->n_entries   = n_lines;
+        t->slot_mask   = n_slots - 1;
+        t->bucket_mask = n_buckets - 1;
+        t->entries = (registry_entry *)(t + 1);
+        t->slots   = (uint32_t *)(t->entries + n_lines);
+        t->seeds   = t->slots + n_slots;
+        t->text    = (char *)(t->seeds + n_buckets);
+
+        char *p = t->text;
+        for (size_t i = 0; i < n_lines; i++) {
+            registry_entry *e = &t->entries[i];
+            memcpy(p, text + lines[i].dialect.offset, lines[i].dialect.length);
+            p[lines[i].dialect.length] = '\0';
+            e->name     = p;
+            e->name_len = lines[i].dialect.length;
+            p += e->name_len + 1;
+
+            memcpy(p, text + lines[i].func_name.offset, lines[i].func_name.length);
+            p[lines[i].func_name.length] = '\0';
+            e->syntax.func_name     = p;
+            e->syntax.func_name_len = lines[i].func_name.length;
+            e->syntax.neg_start     = lines[i].neg_start;
+            e->syntax.shift_start   = lines[i].shift_start;
+            e->DBMS_id              = registry_dbms_id(e->name, e->name_len);
+            p += e->syntax.func_name_len + 1;
+        }
+
+        size_t dup = 0;
+        int placed = registry_place(t, hashes, &dup);
+        if (placed == 1) {
+            break;
+        }
+        free(t);
+        t = NULL;
+        if (placed == -1) {
+            *err_pos = lines[dup].offset;
+            rc = CONFIG_SYNTAX_ERR;
+            goto END;
+        }
+        if (placed == -2) {
+            rc = MEMORY_ALLOCATION_ERR;
+            goto END;
+        }
+        n_slots *= 2;   /* no seed found: retry with a sparser table */
+    }
+    *table_out = t;
+
+END:
+    free(hashes);
+    return rc;
+}
+
+substr_registry *substr_registry_create(void)
+{
+    substr_registry *reg = calloc(1, sizeof(*reg));
+    if (!reg) {
+        return NULL;
+    }
+    if (pthread_mutex_init(&reg->load_lock, NULL) != 0) {
+        free(reg);
+        return NULL;
+    }
+
+    size_t err_pos = 0;
+    if (registry_build("", NULL, 0, &reg->current, &err_pos) != RET_SUCCESS) {
+        pthread_mutex_destroy(&reg->load_lock);
+        free(reg);
+        return NULL;
+    }
+    return reg;
+}
+
+void substr_registry_destroy(substr_registry *reg)
+{
+    if (!reg) {
+        return;
+    }
+    free(reg->current);
+    pthread_mutex_destroy(&reg->load_lock);
+    free(reg);
+}
+
+/*
+    publish a new table and wait for the grace period of the old one:
+    every reader that may hold it began in the epoch being closed */
+static void registry_swap(substr_registry *reg, substr_registry_table *table)
+{
+    pthread_mutex_lock(&reg->load_lock);
+
+    substr_registry_table *old = __atomic_exchange_n(&reg->current, table, __ATOMIC_SEQ_CST);
+    unsigned long epoch = __atomic_load_n(&reg->epoch, __ATOMIC_RELAXED);
+    __atomic_store_n(&reg->epoch, epoch + 1, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&reg->readers[epoch & 1].n, __ATOMIC_SEQ_CST) != 0) {
+        sched_yield();
+    }
+
+    pthread_mutex_unlock(&reg->load_lock);
+    free(old);
+}
+
+FunctionStatus substr_registry_load_buffer(substr_registry *reg, const char *text, size_t text_len,
+                        substr_diag *diag)
+{
+    if (!reg || !text) {
+        return substr_diag_report(diag, text, NULL_INPUT_POINTER, SUBSTR_STAGE_ARGS, 0);
+    }
+
+    /* first pass counts the entries, the second one keeps them */
+    size_t n_lines = 0, pos = 0, err_pos = 0;
+    registry_line line;
+    while (pos < text_len) {
+        int got = registry_parse_line(text, text_len, &pos, &line, &err_pos);
+        if (got < 0) {
+            return substr_diag_report(diag, text, CONFIG_SYNTAX_ERR, SUBSTR_STAGE_PARSE, err_pos);
+        }
+        n_lines += got;
+    }
+
+    registry_line *lines = malloc((n_lines + 1) * sizeof(registry_line));
+    if (!lines) {
+        return substr_diag_report(diag, text, MEMORY_ALLOCATION_ERR, SUBSTR_STAGE_PARSE, 0);
+    }
+    n_lines = 0;
+    pos = 0;
+    while (pos < text_len) {
+        n_lines += registry_parse_line(text, text_len, &pos, &lines[n_lines], &err_pos);
+    }
+
+    substr_registry_table *table = NULL;
+    FunctionStatus rc = registry_build(text, lines, n_lines, &table, &err_pos);
+    free(lines);
+    if (rc != RET_SUCCESS) {
+        return substr_diag_report(diag, text, rc, SUBSTR_STAGE_PARSE, err_pos);
+    }
+
+    registry_swap(reg, table);
+    return substr_diag_report(diag, text, RET_SUCCESS, SUBSTR_STAGE_NONE, 0);
+}
+
+FunctionStatus substr_registry_load_file(substr_registry *reg, const char *path, substr_diag *diag)
+{
+    if (!reg || !path) {
+        return substr_diag_report(diag, NULL, NULL_INPUT_POINTER, SUBSTR_STAGE_ARGS, 0);
+    }
+
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return substr_diag_report(diag, NULL, FILE_IO_ERR, SUBSTR_STAGE_ARGS, 0);
+    }
+
+    FunctionStatus rc = RET_SUCCESS;
+    size_t cap = 4096, len = 0;
+    char *text = malloc(cap);
+    while (text) {
+        len += fread(text + len, 1, cap - len, f);
+        if (len < cap) {
+            break;
+        }
+        char *grown = realloc(text, cap * 2);
+        if (!grown) {
+            free(text);
+            text = NULL;
+            break;
+        }
+        text = grown;
+        cap *= 2;
+    }
+
+    if (!text) {
+        rc = substr_diag_report(diag, NULL, MEMORY_ALLOCATION_ERR, SUBSTR_STAGE_ARGS, 0);
+        goto END;
+    }
+    if (ferror(f)) {
+        rc = substr_diag_report(diag, NULL, FILE_IO_ERR, SUBSTR_STAGE_ARGS, len);
+        goto END;
+    }
+    rc = substr_registry_load_buffer(reg, text, len, diag);
+
+END:
+    free(text);
+    fclose(f);
+    return rc;
+}
+
+void substr_registry_enter(substr_registry *reg, substr_registry_read *rd)
+{
+    /* retry if a writer closed the epoch between reading it and counting
+       ourselves in it, the writer may not have seen the count */
+    while (1) {
+        unsigned long epoch = __atomic_load_n(&reg->epoch, __ATOMIC_SEQ_CST);
+        __atomic_add_fetch(&reg->readers[epoch & 1].n, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&reg->epoch, __ATOMIC_SEQ_CST) == epoch) {
+            rd->epoch = epoch;
+            break;
+        }
+        __atomic_sub_fetch(&reg->readers[epoch & 1].n, 1, __ATOMIC_SEQ_CST);
+    }
+    rd->table = __atomic_load_n(&reg->current, __ATOMIC_SEQ_CST);
+}
+
+void substr_registry_exit(substr_registry *reg, substr_registry_read *rd)
+{
+    __atomic_sub_fetch(&reg->readers[rd->epoch & 1].n, 1, __ATOMIC_RELEASE);
+    rd->table = NULL;
+}
+
+/*
+    entry of the dialect named name in t, NULL if none */
+static const registry_entry *registry_find_entry(const substr_registry_table *t, const char *name, size_t name_len)
+{
+    if (!t || !name || t->n_entries == 0) {
+        return NULL;
+    }
+
+    uint64_t h = registry_hash(name, name_len);
+    uint32_t seed = t->seeds[(h >> 32) & t->bucket_mask];
+    uint32_t index = t->slots[registry_slot(h, seed) & t->slot_mask];
+    if (!seed || !index) {
+        return NULL;
+    }
+
+    const registry_entry *e = &t->entries[index - 1];
+    return registry_name_eq(e->name, e->name_len, name, name_len) ? e : NULL;
+}
+
+const substr_func_syntax *substr_registry_find(const substr_registry_read *rd, const char *name, size_t name_len)
+{
+    const registry_entry *e = registry_find_entry(rd->table, name, name_len);
+    return e ? &e->syntax : NULL;
+}
+
+size_t substr_registry_count(const substr_registry_read *rd)
+{
+    return rd->table ? rd->table->n_entries : 0;
+}
+
+FunctionStatus translate_substr_func_dialect(substr_registry *reg, const char *dialect, const char *input_str,
+                        char *out_substr_string, size_t out_str_len, size_t *out_str_wrt)
+{
+    if (!reg || !dialect) {
+        return NULL_INPUT_POINTER; // Error: Null pointer
+    }
+
+    substr_registry_read rd;
+    substr_registry_enter(reg, &rd);
+
+    FunctionStatus rc = UNKNOWN_DBMS_ID;
+    const registry_entry *e = registry_find_entry(rd.table, dialect, strlen(dialect));
+    if (e) {
+        rc = translate_substr_func_counted(input_str, &e->syntax, e->DBMS_id,
+                                           out_substr_string, out_str_len, out_str_wrt, NULL);
+    }
+
+    substr_registry_exit(reg, &rd);
+    return rc;
+}
@@ -0,0 +1,58 @@
+#ifndef __substr_registry_h__
+#define __substr_registry_h__
+
+#include "substr_wrapper.h"
+
+// Config file of a registry, one dialect per line, '#' starts a comment:
+//     dialect_name  func_name  neg_start  shift_start
+//     oracle        substr     1          0
+// dialect names are matched case-insensitively and must be unique
+typedef struct substr_registry_struct substr_registry;
+
+// immutable table of dialects, replaced as a whole on every load
+typedef struct substr_registry_table_struct substr_registry_table;
+
+// read section of a registry, see substr_registry_enter
+typedef struct substr_registry_read_struct {
+    const substr_registry_table *table ;  /* table current when the section began */
+    unsigned long epoch                ;
+} substr_registry_read;
+
+// create an empty registry, NULL if out of memory
+substr_registry *substr_registry_create(void);
+
+// release a registry, no read section may be open
+void substr_registry_destroy(substr_registry *reg);
+
+// Parse a config and build its table with a perfect hash on the dialect
+// names, then swap it in. Readers are never blocked: the previous table is
+// released once the read sections that may use it have ended. On failure the
+// previous table stays in place and diag (may be NULL) holds the byte offset
+// of the bad line
+FunctionStatus substr_registry_load_buffer(substr_registry *reg, const char *text, size_t text_len,
+                        substr_diag *diag);
+
+// same as substr_registry_load_buffer, reading the config from path
+FunctionStatus substr_registry_load_file(substr_registry *reg, const char *path, substr_diag *diag);
+
+// Begin a read section: the entries found through rd stay valid until
+// substr_registry_exit, even if another thread loads a new config meanwhile.
+// Takes no lock
+void substr_registry_enter(substr_registry *reg, substr_registry_read *rd);
+
+// end a read section begun with substr_registry_enter
+void substr_registry_exit(substr_registry *reg, substr_registry_read *rd);
+
+// syntax of a dialect in the table of rd, NULL if the name is unknown
+const substr_func_syntax *substr_registry_find(const substr_registry_read *rd, const char *name, size_t name_len);
+
+// number of dialects in the table of rd
+size_t substr_registry_count(const substr_registry_read *rd);
+
+// translate_substr_func to the dialect of that name, UNKNOWN_DBMS_ID if the
+// registry does not have it. Counted in the telemetry under the DBMS_ID of the
+// same name (oracle, sqlserver, ...), other dialects under DBMS_UNKNOWN
+FunctionStatus translate_substr_func_dialect(substr_registry *reg, const char *dialect, const char *input_str,
+                        char *out_substr_string, size_t out_str_len, size_t *out_str_wrt);
+
+#endif // __substr_registry_h__
@@ -0,0 +1,306 @@
+#include <stdint.h>
+
+#include "substr_rules.h"
+
+static int is_ident_char(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+        || c == '_' || c == '$';
+}
+
+static int is_blank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static char to_lower(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? (char)(c | 0x20) : c;
+}
+
+/*
+    FNV-1a of a lowercased name */
+static uint64_t rule_hash(const char *name, size_t len)
+{
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ (unsigned char)to_lower(name[i])) * 1099511628211ULL;
+    }
+    return h;
+}
+
+static int same_name(const char *a, const char *b, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (to_lower(a[i]) != to_lower(b[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+    1 if the order of a rule maps the first n output arguments onto the
+    first n input arguments, for every accepted n */
+static int rule_order_valid(const substr_rule *rule)
+{
+    if (!rule->order) {
+        return 1;
+    }
+    if (strlen(rule->order) < (size_t)rule->max_args) {
+        return 0;
+    }
+    for (int n = rule->min_args; n <= rule->max_args; n++) {
+        unsigned seen = 0;
+        for (int i = 0; i < n; i++) {
+            int from = rule->order[i] - '0';
+            if (from < 0 || from >= n || (seen & (1u << from))) {
+                return 0;
+            }
+            seen |= 1u << from;
+        }
+    }
+    return 1;
+}
+
+void substr_rule_set_destroy(substr_rule_set *set)
+{
+    if (!set) {
+        return;
+    }
+    free(set->rules);
+    free(set->slots);
+    set->rules = NULL;
+    set->slots = NULL;
+    set->n_rules = 0;
+}
+
+FunctionStatus substr_rule_set_init(substr_rule_set *set, const substr_rule *rules, size_t n_rules)
+{
+    if (!set || (!rules && n_rules > 0)) {
+        return NULL_INPUT_POINTER; // Error: Null pointer
+    }
+
+    FunctionStatus rc = RET_SUCCESS;
+    size_t n_slots = 8;
+    while (n_slots < 2 * n_rules) {
+        n_slots *= 2;
+    }
+
+    memset(set, 0, sizeof(*set));
+    set->rules = malloc((n_rules ? n_rules : 1) * sizeof(substr_rule));
+    set->slots = malloc(n_slots * sizeof(int));
+    if (!set->rules || !set->slots) {
+        rc = MEMORY_ALLOCATION_ERR;
+        goto END;
+    }
+    if (n_rules > 0) {
+        memcpy(set->rules, rules, n_rules * sizeof(substr_rule));
+    }
+    set->n_rules   = n_rules;
+    set->slot_mask = n_slots - 1;
+    set->starts['\''] = set->starts['"'] = set->starts['-'] = set->starts['/'] = 1;
+    for (size_t s = 0; s < n_slots; s++) {
+        set->slots[s] = -1;
+    }
+
+    for (size_t r = 0; r < n_rules; r++) {
+        substr_rule *rule = &set->rules[r];
+        if (!rule->name || !rule->to_name) {
+            rc = CONFIG_SYNTAX_ERR;
+            goto END;
+        }
+        rule->name_len    = rule->name_len ? rule->name_len : strlen(rule->name);
+        rule->to_name_len = rule->to_name_len ? rule->to_name_len : strlen(rule->to_name);
+
+        int valid = rule->name_len > 0 && !(rule->name[0] >= '0' && rule->name[0] <= '9')
+                 && rule->min_args >= 0 && rule->min_args <= rule->max_args && rule->max_args <= SUBSTR_RULE_MAX_ARGS
+                 && (rule->index_args >> rule->max_args) == 0
+                 && (rule->neg == SUBSTR_NEG_ALLOW || rule->neg == SUBSTR_NEG_REJECT)
+                 && rule_order_valid(rule);
+        for (size_t i = 0; valid && i < rule->name_len; i++) {
+            valid = is_ident_char(rule->name[i]);
+        }
+        if (!valid) {
+            rc = CONFIG_SYNTAX_ERR;
+            goto END;
+        }
+
+        size_t s = rule_hash(rule->name, rule->name_len) & set->slot_mask;
+        for (; set->slots[s] >= 0; s = (s + 1) & set->slot_mask) {
+            const substr_rule *other = &set->rules[set->slots[s]];
+            if (other->name_len == rule->name_len && same_name(other->name, rule->name, rule->name_len)) {
+                rc = CONFIG_SYNTAX_ERR; // duplicate name
+                goto END;
+            }
+        }
+        set->slots[s] = (int)r;
+
+        unsigned char first = (unsigned char)to_lower(rule->name[0]);
+        set->starts[first] = 1;
+        if (first >= 'a' && first <= 'z') {
+            set->starts[first - 'a' + 'A'] = 1;
+        }
+    }
+
+    END:
+    if (rc != RET_SUCCESS) {
+        substr_rule_set_destroy(set);
+    }
+    return rc;
+}
+
+int substr_rule_set_find(const substr_rule_set *set, const char *name, size_t len)
+{
+    for (size_t s = rule_hash(name, len) & set->slot_mask; set->slots[s] >= 0; s = (s + 1) & set->slot_mask) {
+        const substr_rule *rule = &set->rules[set->slots[s]];
+        if (rule->name_len == len && same_name(rule->name, name, len)) {
+            return set->slots[s];
+        }
+    }
+    return -1;
+}
+
+void substr_rule_from_syntax(const substr_func_syntax *f_syntax, substr_rule *rule)
+{
+    rule->name        = "substr";
+    rule->name_len    = 6;
+    rule->to_name     = f_syntax->func_name;
+    rule->to_name_len = f_syntax->func_name_len ? f_syntax->func_name_len : strlen(f_syntax->func_name);
+    rule->min_args    = 2;
+    rule->max_args    = 3;
+    rule->order       = NULL;
+    rule->index_args  = SUBSTR_RULE_ARG(1);
+    rule->shift       = f_syntax->shift_start;
+    rule->neg         = f_syntax->neg_start > 0 ? SUBSTR_NEG_ALLOW : SUBSTR_NEG_REJECT;
+}
+
+/*
+    value of an argument written as an integer constant, with an optional
+    sign. return 1 if it is one and fits in a long int */
+static int parse_const(const char *text, size_t len, long int *value)
+{
+    size_t i = 0;
+    int negative = 0;
+    if (i < len && (text[i] == '-' || text[i] == '+')) {
+        negative = text[i] == '-';
+        i++;
+    }
+    if (i == len) {
+        return 0;
+    }
+
+    unsigned long int v = 0, limit = negative ? (unsigned long int)LONG_MAX + 1 : LONG_MAX;
+    for (; i < len; i++) {
+        if (text[i] < '0' || text[i] > '9') {
+            return 0;
+        }
+        unsigned long int digit = text[i] - '0';
+        if (v > (limit - digit) / 10) {
+            return 0;
+        }
+        v = v * 10 + digit;
+    }
+    *value = negative ? (long int)(0 - v) : (long int)v;
+    return 1;
+}
+
+/*
+    add one argument text[start, end) without its surrounding blanks */
+static FunctionStatus add_arg(substr_rule_call *out, const char *text, size_t start, size_t end)
+{
+    while (start < end && is_blank(text[start])) {
+        start++;
+    }
+    while (end > start && is_blank(text[end - 1])) {
+        end--;
+    }
+    if (start == end || out->n_args == SUBSTR_RULE_MAX_ARGS) {
+        return FUNC_CALL_SYNTAX_ERR; // Error: empty argument or too many
+    }
+    out->args[out->n_args].offset = start;
+    out->args[out->n_args].length = end - start;
+    out->n_args++;
+    return RET_SUCCESS;
+}
+
+FunctionStatus substr_rule_parse(const substr_rule *rule, const char *call, size_t len, substr_rule_call *out)
+{
+    if (!rule || !call || !out) {
+        return NULL_INPUT_POINTER; // Error: Null pointer
+    }
+
+    size_t i = 0;
+    out->n_args = 0;
+    while (i < len && is_ident_char(call[i])) {
+        i++;
+    }
+    out->name.offset = 0;
+    out->name.length = i;
+    while (i < len && is_blank(call[i])) {
+        i++;
+    }
+    if (i == len || call[i] != '(' || call[len - 1] != ')' || len - 1 == i) {
+        return FUNC_CALL_SYNTAX_ERR; // Error: not name(...)
+    }
+    out->open = i;
+
+    /* split the arguments on the commas outside quotes and parentheses */
+    size_t close = len - 1, arg_start = i + 1, depth = 0;
+    int blank = 1;
+    for (size_t p = i + 1; p < close; p++) {
+        char c = call[p];
+        blank = blank && is_blank(c);
+        if (c == '\'' || c == '"') {
+            const char *end_quote = memchr(call + p + 1, c, close - p - 1);
+            if (!end_quote) {
+                return FUNC_CALL_DQUOTE_MISMATCH; // Error: quote not closed
+            }
+            p = end_quote - call;
+        } else if (c == '(') {
+            depth++;
+        } else if (c == ')') {
+            if (depth == 0) {
+                return FUNC_CALL_PARENS_MISMATCH; // Error: ')' closes the call early
+            }
+            depth--;
+        } else if (c == ',' && depth == 0) {
+            FunctionStatus rc = add_arg(out, call, arg_start, p);
+            if (rc != RET_SUCCESS) {
+                return rc;
+            }
+            arg_start = p + 1;
+        }
+    }
+    if (depth != 0) {
+        return FUNC_CALL_PARENS_MISMATCH; // Error: '(' not closed
+    }
+    if (!blank || out->n_args > 0) {
+        FunctionStatus rc = add_arg(out, call, arg_start, close);
+        if (rc != RET_SUCCESS) {
+            return rc;
+        }
+    }
+    if (out->n_args < rule->min_args || out->n_args > rule->max_args) {
+        return FUNC_CALL_SYNTAX_ERR; // Error: number of arguments
+    }
+
+    /* positions written as constants are shifted here, the others when written */
+    for (int a = 0; a < out->n_args; a++) {
+        out->is_const[a] = 0;
+        if (!(rule->index_args & SUBSTR_RULE_ARG(a))
+            || !parse_const(call + out->args[a].offset, out->args[a].length, &out->value[a])) {
+            continue;
+        }
+        if (out->value[a] < 0 && rule->neg == SUBSTR_NEG_REJECT) {
+            return SUBSTR_STARTPOS_NEGATIVE; // Error: negative position
+        }
+        if ((rule->shift > 0 && out->value[a] > LONG_MAX - rule->shift)
+            || (rule->shift < 0 && out->value[a] < LONG_MIN - rule->shift)) {
+            return FUNC_CALL_WRONG_START_POS; // Error: shifted position overflows
+        }
+        out->value[a] += rule->shift;
+        out->is_const[a] = 1;
+    }
+    return RET_SUCCESS;
+}
@@ -0,0 +1,81 @@
+#ifndef __substr_rules_h__
+#define __substr_rules_h__
+
+#include "substr_wrapper.h"
+
+// most arguments of a call rewritten by a rule
+#define SUBSTR_RULE_MAX_ARGS  8
+
+// bit of the index_args of a rule for argument i (0-based)
+#define SUBSTR_RULE_ARG(i)    (1u << (i))
+
+// what a rule does with an index argument written as a negative constant
+typedef enum {
+    SUBSTR_NEG_ALLOW = 0,   /* rewritten like any other value */
+    SUBSTR_NEG_REJECT,      /* the call is left as written */
+} substr_neg_policy;
+
+// Rewrite of one function, the substr_func_syntax of any function:
+//    name:       function name in the input, matched case-insensitively
+//    to_name:    function name written in the output
+//    min_args, max_args: calls with another number of arguments are left as written
+//    order:      output argument i is input argument order[i] - '0', e.g. "102"
+//                swaps the first two; NULL keeps the input order
+//    index_args: SUBSTR_RULE_ARG bits of the input arguments that are positions
+//    shift:      added to the positions, the index base difference of the target
+//    neg:        policy for positions written as negative constants
+typedef struct substr_rule_struct {
+    const char *name      ;
+    const char *to_name   ;
+    int min_args, max_args ;
+    const char *order     ;
+    unsigned index_args   ;
+    long int shift        ;
+    substr_neg_policy neg ;
+    size_t name_len, to_name_len ;  /* set by SUBSTR_RULE or substr_rule_set_init; 0 if not known */
+} substr_rule;
+
+// initializer of a rule table entry with literal names
+#define SUBSTR_RULE(name, to_name, min_args, max_args, order, index_args, shift, neg) \
+    { name, to_name, min_args, max_args, order, index_args, shift, neg, sizeof(name) - 1, sizeof(to_name) - 1 }
+
+// rule table compiled for lookup by name
+typedef struct substr_rule_set_struct {
+    substr_rule *rules     ;  /* copy of the table */
+    size_t n_rules         ;
+    int    *slots          ;  /* open-addressing hash of the lowercased names, rule index or -1 */
+    size_t  slot_mask      ;
+    unsigned char starts[256] ;  /* 1 for the bytes a scan of plain text stops on: the first
+                                    bytes of the names, in both cases, quotes and comment starts */
+} substr_rule_set;
+
+// a call split for its rule; the views are offsets into the call text
+typedef struct substr_rule_call_struct {
+    substr_view name  ;                       /* function name as written */
+    size_t open       ;                       /* offset of '(' */
+    int n_args        ;
+    substr_view args [SUBSTR_RULE_MAX_ARGS] ; /* arguments, without surrounding blanks */
+    int is_const     [SUBSTR_RULE_MAX_ARGS] ; /* index argument written as an integer constant */
+    long int value   [SUBSTR_RULE_MAX_ARGS] ; /* its value with the shift applied */
+} substr_rule_call;
+
+// Copy and compile a rule table. return CONFIG_SYNTAX_ERR for a duplicate
+// name, a bad argument range or an order that is not a permutation
+FunctionStatus substr_rule_set_init(substr_rule_set *set, const substr_rule *rules, size_t n_rules);
+
+// release the memory of a rule set
+void substr_rule_set_destroy(substr_rule_set *set);
+
+// index of the rule named name[0, len), any case, -1 if none
+int substr_rule_set_find(const substr_rule_set *set, const char *name, size_t len);
+
+// the rule doing what f_syntax does to SUBSTR calls
+void substr_rule_from_syntax(const substr_func_syntax *f_syntax, substr_rule *rule);
+
+// Split call[0, len), a name, '(', arguments and the closing ')', and check
+// it against rule: number of arguments and negative positions.
+// return RET_SUCCESS, SUBSTR_STARTPOS_NEGATIVE, FUNC_CALL_WRONG_START_POS if a
+//        shifted position overflows, or a FUNC_CALL_* syntax error
+FunctionStatus substr_rule_parse(const substr_rule *rule, const char *call, size_t len, substr_rule_call *out);
+
+#endif // __substr_rules_h__
@@ -0,0 +1,264 @@
+#include <string.h>
+
+#include "substr_scan.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SUBSTR_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+const substr_scan_set substr_scan_call_set = { {'(', ')', '"', ','}, 4 };
+
+typedef uint64_t (*scan64_fn)(const substr_scan_set *set, const char *buf);
+typedef uint64_t (*lead64_fn)(const char *buf);
+
+/* 
+    portable fallback, one byte at a time */
+static uint64_t scan64_scalar(const substr_scan_set *set, const char *buf)
+{
+    uint64_t mask = 0;
+    for (int i = 0; i < SUBSTR_SCAN_BLOCK; i++) {
+        unsigned char c = (unsigned char)buf[i];
+        for (int k = 0; k < set->n_chars; k++) {
+            if (c == set->chars[k]) {
+                mask |= (uint64_t)1 << i;
+                break;
+            }
+        }
+    }
+    return mask;
+}
+
+/* 
+    portable fallback: bit i is set if buf[i] starts a UTF-8 code point,
+    i.e. it is not a continuation byte 10xxxxxx */
+static uint64_t lead64_scalar(const char *buf)
+{
+    uint64_t mask = 0;
+    for (int i = 0; i < SUBSTR_SCAN_BLOCK; i++) {
+        if (((unsigned char)buf[i] & 0xC0) != 0x80) {
+            mask |= (uint64_t)1 << i;
+        }
+    }
+    return mask;
+}
+
+#ifdef SUBSTR_SCAN_X86
+/* 
+    SSE2: 4 x 16 bytes, part of every x86-64 CPU */
+static uint64_t scan64_sse2(const substr_scan_set *set, const char *buf)
+{
+    __m128i b0 = _mm_loadu_si128((const __m128i *)(buf));
+    __m128i b1 = _mm_loadu_si128((const __m128i *)(buf + 16));
+    __m128i b2 = _mm_loadu_si128((const __m128i *)(buf + 32));
+    __m128i b3 = _mm_loadu_si128((const __m128i *)(buf + 48));
+    __m128i m0 = _mm_setzero_si128(), m1 = m0, m2 = m0, m3 = m0;
+
+    for (int k = 0; k < set->n_chars; k++) {
+        __m128i c = _mm_set1_epi8((char)set->chars[k]);
+        m0 = _mm_or_si128(m0, _mm_cmpeq_epi8(b0, c));
+        m1 = _mm_or_si128(m1, _mm_cmpeq_epi8(b1, c));
+        m2 = _mm_or_si128(m2, _mm_cmpeq_epi8(b2, c));
+        m3 = _mm_or_si128(m3, _mm_cmpeq_epi8(b3, c));
+    }
+
+    return  (uint64_t)(uint16_t)_mm_movemask_epi8(m0)
+         | ((uint64_t)(uint16_t)_mm_movemask_epi8(m1) << 16)
+         | ((uint64_t)(uint16_t)_mm_movemask_epi8(m2) << 32)
+         | ((uint64_t)(uint16_t)_mm_movemask_epi8(m3) << 48);
+}
+
+/* 
+    continuation bytes 0x80..0xBF are -128..-65 as signed chars,
+    every other byte compares greater than -65 */
+static uint64_t lead64_sse2(const char *buf)
+{
+    __m128i cont = _mm_set1_epi8(-65);
+    uint64_t mask = 0;
+    for (int i = 0; i < 4; i++) {
+        __m128i b = _mm_loadu_si128((const __m128i *)(buf + 16 * i));
+        mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpgt_epi8(b, cont)) << (16 * i);
+    }
+    return mask;
+}
+
+/* 
+    AVX2: 2 x 32 bytes, only used if the CPU supports it */
+__attribute__((target("avx2")))
+static uint64_t scan64_avx2(const substr_scan_set *set, const char *buf)
+{
+    __m256i b0 = _mm256_loadu_si256((const __m256i *)(buf));
+    __m256i b1 = _mm256_loadu_si256((const __m256i *)(buf + 32));
+    __m256i m0 = _mm256_setzero_si256(), m1 = m0;
+
+    for (int k = 0; k < set->n_chars; k++) {
+        __m256i c = _mm256_set1_epi8((char)set->chars[k]);
+        m0 = _mm256_or_si256(m0, _mm256_cmpeq_epi8(b0, c));
+        m1 = _mm256_or_si256(m1, _mm256_cmpeq_epi8(b1, c));
+    }
+
+    return  (uint64_t)(uint32_t)_mm256_movemask_epi8(m0)
+         | ((uint64_t)(uint32_t)_mm256_movemask_epi8(m1) << 32);
+}
+
+__attribute__((target("avx2")))
+static uint64_t lead64_avx2(const char *buf)
+{
+    __m256i cont = _mm256_set1_epi8(-65);
+    __m256i b0 = _mm256_loadu_si256((const __m256i *)(buf));
+    __m256i b1 = _mm256_loadu_si256((const __m256i *)(buf + 32));
+
+    return  (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi8(b0, cont))
+         | ((uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi8(b1, cont)) << 32);
+}
+#endif
+
+static scan64_fn scan64_impl = NULL;
+static lead64_fn lead64_impl = NULL;
+static const char *scan64_name = NULL;
+
+/* 
+    pick the widest implementation the CPU supports, once.
+    Racing threads all store the same values. */
+static scan64_fn scan64_select(void)
+{
+    scan64_fn fn = __atomic_load_n(&scan64_impl, __ATOMIC_ACQUIRE);
+    if (fn) {
+        return fn;
+    }
+
+    const char *name = "scalar";
+    lead64_fn lead = lead64_scalar;
+    fn = scan64_scalar;
+#ifdef SUBSTR_SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        fn = scan64_avx2;
+        lead = lead64_avx2;
+        name = "avx2";
+    } else {
+        fn = scan64_sse2;
+        lead = lead64_sse2;
+        name = "sse2";
+    }
+#endif
+    __atomic_store_n(&scan64_name, name, __ATOMIC_RELAXED);
+    __atomic_store_n(&lead64_impl, lead, __ATOMIC_RELAXED);
+    __atomic_store_n(&scan64_impl, fn, __ATOMIC_RELEASE);
+    return fn;
+}
+
+const char *substr_scan_impl(void)
+{
+    scan64_select();
+    return __atomic_load_n(&scan64_name, __ATOMIC_RELAXED);
+}
+
+/* 
+    a short block is copied to a padded buffer so the kernels can always
+    read SUBSTR_SCAN_BLOCK bytes, then the bits past len are cleared */
+uint64_t substr_scan_block(const substr_scan_set *set, const char *buf, size_t len)
+{
+    scan64_fn fn = scan64_select();
+
+    if (len >= SUBSTR_SCAN_BLOCK) {
+        return fn(set, buf);
+    }
+    if (len == 0) {
+        return 0;
+    }
+
+    char padded[SUBSTR_SCAN_BLOCK];
+    memcpy(padded, buf, len);
+    memset(padded + len, 0, SUBSTR_SCAN_BLOCK - len);
+    return fn(set, padded) & (((uint64_t)1 << len) - 1);
+}
+
+void substr_scan_bitmap(const substr_scan_set *set, const char *buf, size_t len, uint64_t *bitmap)
+{
+    scan64_fn fn = scan64_select();
+    size_t n_full = len / SUBSTR_SCAN_BLOCK;
+
+    for (size_t w = 0; w < n_full; w++) {
+        bitmap[w] = fn(set, buf + w * SUBSTR_SCAN_BLOCK);
+    }
+    if (len % SUBSTR_SCAN_BLOCK) {
+        bitmap[n_full] = substr_scan_block(set, buf + n_full * SUBSTR_SCAN_BLOCK, len % SUBSTR_SCAN_BLOCK);
+    }
+}
+
+size_t substr_scan_find(const substr_scan_set *set, const char *buf, size_t len, size_t from)
+{
+    while (from < len) {
+        size_t n = len - from;
+        uint64_t mask = substr_scan_block(set, buf + from, n < SUBSTR_SCAN_BLOCK ? n : SUBSTR_SCAN_BLOCK);
+        if (mask) {
+            return from + __builtin_ctzll(mask);
+        }
+        from += SUBSTR_SCAN_BLOCK;
+    }
+    return len;
+}
+
+/* 
+    the lead kernel is published before scan64_impl, so it is set once
+    scan64_select returns */
+static lead64_fn lead64_select(void)
+{
+    scan64_select();
+    return __atomic_load_n(&lead64_impl, __ATOMIC_RELAXED);
+}
+
+uint64_t substr_scan_utf8_block(const char *buf, size_t len)
+{
+    lead64_fn fn = lead64_select();
+
+    if (len >= SUBSTR_SCAN_BLOCK) {
+        return fn(buf);
+    }
+    if (len == 0) {
+        return 0;
+    }
+
+    char padded[SUBSTR_SCAN_BLOCK];
+    memcpy(padded, buf, len);
+    memset(padded + len, 0, SUBSTR_SCAN_BLOCK - len);
+    return fn(padded) & (((uint64_t)1 << len) - 1);
+}
+
+size_t substr_scan_utf8_count(const char *buf, size_t len)
+{
+    lead64_fn fn = lead64_select();
+    size_t n_full = len / SUBSTR_SCAN_BLOCK;
+    size_t count = 0;
+
+    for (size_t w = 0; w < n_full; w++) {
+        count += __builtin_popcountll(fn(buf + w * SUBSTR_SCAN_BLOCK));
+    }
+    if (len % SUBSTR_SCAN_BLOCK) {
+        count += __builtin_popcountll(substr_scan_utf8_block(buf + n_full * SUBSTR_SCAN_BLOCK, len % SUBSTR_SCAN_BLOCK));
+    }
+    return count;
+}
+
+/* 
+    whole blocks are skipped by their popcount, the block holding the
+    code point is resolved by clearing lower bits */
+size_t substr_scan_utf8_offset(const char *buf, size_t len, size_t n_chars)
+{
+    size_t from = 0;
+    while (from < len) {
+        size_t n = len - from;
+        uint64_t mask = substr_scan_utf8_block(buf + from, n < SUBSTR_SCAN_BLOCK ? n : SUBSTR_SCAN_BLOCK);
+        size_t in_block = __builtin_popcountll(mask);
+        if (n_chars < in_block) {
+            for (; n_chars > 0; n_chars--) {
+                mask &= mask - 1;
+            }
+            return from + __builtin_ctzll(mask);
+        }
+        n_chars -= in_block;
+        from += SUBSTR_SCAN_BLOCK;
+    }
+    return len;
+}
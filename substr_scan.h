@@ -0,0 +1,45 @@
+#ifndef __substr_scan_h__
+#define __substr_scan_h__
+
+#include <stddef.h>
+#include <stdint.h>
+
+// bytes covered by one word of a structural bitmap
+#define SUBSTR_SCAN_BLOCK  64
+// most bytes one scan set can look for
+#define SUBSTR_SCAN_MAX_CHARS 8
+
+// bytes to look for, such as parens, quotes and commas
+typedef struct substr_scan_set_struct {
+    unsigned char chars[SUBSTR_SCAN_MAX_CHARS] ;
+    int n_chars ;
+} substr_scan_set;
+
+// delimiters of a substr call: ( ) " ,
+extern const substr_scan_set substr_scan_call_set;
+
+// name of the implementation picked at run time: "avx2", "sse2" or "scalar"
+const char *substr_scan_impl(void);
+
+// Bitmap of the bytes of buf[0, len) found in set, len <= SUBSTR_SCAN_BLOCK.
+// bit i is set if buf[i] is one of the chars of set
+uint64_t substr_scan_block(const substr_scan_set *set, const char *buf, size_t len);
+
+// Bitmap of the bytes of buf[0, len) found in set, one word per
+// SUBSTR_SCAN_BLOCK bytes: bitmap must hold (len + 63) / 64 words
+void substr_scan_bitmap(const substr_scan_set *set, const char *buf, size_t len, uint64_t *bitmap);
+
+// position of the first byte of buf[from, len) found in set, len if none
+size_t substr_scan_find(const substr_scan_set *set, const char *buf, size_t len, size_t from);
+
+// Bitmap of the UTF-8 code point starts of buf[0, len), len <= SUBSTR_SCAN_BLOCK.
+// bit i is set if buf[i] is not a continuation byte
+uint64_t substr_scan_utf8_block(const char *buf, size_t len);
+
+// number of UTF-8 code points in buf[0, len)
+size_t substr_scan_utf8_count(const char *buf, size_t len);
+
+// byte offset of code point n_chars (counted from 0) of buf[0, len), len if there are fewer
+size_t substr_scan_utf8_offset(const char *buf, size_t len, size_t n_chars);
+
+#endif // __substr_scan_h__
@@ -0,0 +1,202 @@
+#include "substr_source.h"
+#include "substr_telemetry.h"
+
+static int is_ident_char(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+        || c == '_' || c == '$';
+}
+
+void substr_source_set_destroy(substr_source_set *set)
+{
+    if (!set) {
+        return;
+    }
+    free(set->next);
+    free(set->accept);
+    set->next    = NULL;
+    set->accept  = NULL;
+    set->n_nodes = 0;
+}
+
+/*
+    walk the trie along name, adding the missing nodes.
+    return the node where name ends */
+static int source_insert(substr_source_set *set, const char *name, size_t len)
+{
+    int node = 0;
+    for (size_t i = 0; i < len; i++) {
+        int *edge = &set->next[node * set->n_classes + set->classes[(unsigned char)name[i]]];
+        if (*edge == 0) {
+            *edge = (int)set->n_nodes++;
+        }
+        node = *edge;
+    }
+    return node;
+}
+
+FunctionStatus substr_source_set_init(substr_source_set *set, const substr_func_syntax *sources, size_t n_sources)
+{
+    if (!set || !sources) {
+        return NULL_INPUT_POINTER; // Error: Null pointer
+    }
+
+    FunctionStatus rc = RET_SUCCESS;
+    size_t max_nodes = 1;
+
+    memset(set, 0, sizeof(*set));
+    set->sources   = sources;
+    set->n_sources = n_sources;
+    set->n_classes = 1;
+
+    // one column per byte of the names, both cases of a letter share it
+    for (size_t k = 0; k < n_sources; k++) {
+        const char *name = sources[k].func_name;
+        size_t len = !name ? 0 : sources[k].func_name_len ? sources[k].func_name_len : strlen(name);
+        if (len == 0) {
+            return CONFIG_SYNTAX_ERR; // Error: no name
+        }
+        for (size_t i = 0; i < len; i++) {
+            unsigned char c = (unsigned char)name[i];
+            unsigned char lower = (c >= 'A' && c <= 'Z') ? c | 0x20 : c;
+            if (!is_ident_char(name[i])) {
+                return CONFIG_SYNTAX_ERR; // Error: not an identifier
+            }
+            if (!set->classes[lower]) {
+                set->classes[lower] = (unsigned char)set->n_classes++;
+                if (lower >= 'a' && lower <= 'z') {
+                    set->classes[lower - 'a' + 'A'] = set->classes[lower];
+                }
+            }
+        }
+        max_nodes += len;
+    }
+
+    set->next   = calloc(max_nodes * set->n_classes, sizeof(int));
+    set->accept = malloc(max_nodes * sizeof(int));
+    if (!set->next || !set->accept) {
+        rc = MEMORY_ALLOCATION_ERR;
+        goto END;
+    }
+    for (size_t n = 0; n < max_nodes; n++) {
+        set->accept[n] = -1;
+    }
+    set->n_nodes = 1;
+
+    for (size_t k = 0; k < n_sources; k++) {
+        size_t len = sources[k].func_name_len ? sources[k].func_name_len : strlen(sources[k].func_name);
+        int node = source_insert(set, sources[k].func_name, len);
+        int first = set->accept[node];
+        if (first < 0) {
+            set->accept[node] = (int)k;
+        } else if (sources[first].shift_start != sources[k].shift_start) {
+            rc = CONFIG_SYNTAX_ERR; // Error: one name, two index bases
+            goto END;
+        }
+    }
+
+    END:
+    if (rc != RET_SUCCESS) {
+        substr_source_set_destroy(set);
+    }
+    return rc;
+}
+
+int substr_source_find(const substr_source_set *set, const char *name, size_t len)
+{
+    int node = 0;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char cls = set->classes[(unsigned char)name[i]];
+        if (cls == 0 || (node = set->next[node * set->n_classes + cls]) == 0) {
+            return -1;
+        }
+    }
+    return set->accept[node];
+}
+
+/*
+    recognize the dialect of a parsed call and bring its start position to
+    the input base, the same base the shift_start of a target is counted from */
+static FunctionStatus source_normalize(const substr_source_set *set, const char *input_str,
+                        substr_func_view *f_view, int *source_id)
+{
+    int id = substr_source_find(set, input_str + f_view->func_name.offset, f_view->func_name.length);
+    if (id < 0) {
+        return UNKNOWN_FUNC_NAME;
+    }
+    long int shift = set->sources[id].shift_start;
+    if ((shift > 0 && f_view->start_pos < LONG_MIN + shift) || (shift < 0 && f_view->start_pos > LONG_MAX + shift)) {
+        return FUNC_CALL_WRONG_START_POS; // Error: position out of range in the input base
+    }
+    f_view->start_pos -= shift;
+    if (source_id) {
+        *source_id = id;
+    }
+    return RET_SUCCESS;
+}
+
+FunctionStatus parse_substr_call_source(const substr_source_set *set, const char *input_str, size_t input_len,
+                        substr_func_view *f_view_out, int *source_id)
+{
+    if (!set || !input_str || !f_view_out) {
+        return NULL_INPUT_POINTER; // Error: Null pointer
+    }
+
+    FunctionStatus rc = parse_substr_call_view(input_str, input_len, f_view_out);
+    if (rc == RET_SUCCESS) {
+        rc = source_normalize(set, input_str, f_view_out, source_id);
+    }
+    return rc;
+}
+
+/*
+    translate a call in any source dialect of set to f_syntax: parse, find
+    the dialect from the name already delimited by the parse, move the start
+    position from its base to the target base and write the command.
+    Counted in the telemetry under the target, see substr_telemetry_key.
+*/
+FunctionStatus translate_substr_func_from(const substr_source_set *set, const char *input_str,
+                        const substr_func_syntax *f_syntax, char *out_substr_string, size_t out_str_len,
+                        size_t *out_str_wrt, int *source_id)
+{
+    FunctionStatus rc = RET_SUCCESS;
+    size_t input_len = 0;
+    long int wrt_size = 0;
+    substr_func_view f_view_in = {0};
+    substr_func_ref f_ref_out;
+    SUBSTR_TELEMETRY_TIMER(timer);
+
+    if (!set || !input_str || !f_syntax || (out_substr_string && out_str_len == 0) || !out_str_wrt) {
+        rc = NULL_INPUT_POINTER; // Error: Null pointer or zero length
+        goto END;
+    }
+
+    input_len = strlen(input_str);
+    rc = parse_substr_call_source(set, input_str, input_len, &f_view_in, source_id);
+    SUBSTR_TELEMETRY_LAP(timer, SUBSTR_STAGE_PARSE, 1);
+    if (rc != RET_SUCCESS) {
+        goto END;
+    }
+
+    rc = gen_substr_func_ref(f_syntax, input_str, &f_view_in, &f_ref_out);
+    SUBSTR_TELEMETRY_LAP(timer, SUBSTR_STAGE_GENERATE, 1);
+    if (rc != RET_SUCCESS) {
+        goto END;
+    }
+
+    wrt_size = gen_substr_cmd_ref(&f_ref_out, out_substr_string, out_str_len);
+    SUBSTR_TELEMETRY_LAP(timer, SUBSTR_STAGE_EMIT, 1);
+    if (wrt_size <= 0) {
+        rc = wrt_size;
+        wrt_size = 0;
+        goto END;
+    }
+
+    out_str_wrt[0] = wrt_size; // number of chars written
+
+END:
+    if (out_substr_string) {
+        SUBSTR_TELEMETRY_COUNT(substr_telemetry_key(f_syntax), rc, input_len, (size_t)wrt_size);
+    }
+    return rc;
+}
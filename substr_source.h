@@ -0,0 +1,47 @@
+#ifndef __substr_source_h__
+#define __substr_source_h__
+
+#include "substr_wrapper.h"
+
+// Source dialects recognized by the function name of a call, compiled into
+// a trie over case-folded bytes: one table step per byte of the name
+typedef struct substr_source_set_struct {
+    const substr_func_syntax *sources ;  /* the caller's table, must outlive the set */
+    size_t n_sources       ;
+    unsigned char classes[256] ;         /* column of each byte in next, 0 if no name uses it */
+    size_t n_classes       ;             /* columns of next, column 0 included */
+    int    *next           ;             /* next[node * n_classes + class], 0 if no edge */
+    int    *accept         ;             /* index in sources of the name ending at a node, or -1 */
+    size_t  n_nodes        ;
+} substr_source_set;
+
+// Compile the function names of sources, matched case-insensitively. A name
+// used by several sources with the same shift_start resolves to the first.
+// return CONFIG_SYNTAX_ERR for an empty name, a name that is not an
+// identifier, or one name with different index bases
+FunctionStatus substr_source_set_init(substr_source_set *set, const substr_func_syntax *sources, size_t n_sources);
+
+// release the memory of a source set
+void substr_source_set_destroy(substr_source_set *set);
+
+// index in sources of the dialect named name[0, len), any case, -1 if none
+int substr_source_find(const substr_source_set *set, const char *name, size_t len);
+
+// Same as parse_substr_call_view, the function name must be one of set.
+// *source_id (may be NULL) is the index of its dialect in the sources and
+// start_pos is brought from that dialect's index base to the input base.
+// return UNKNOWN_FUNC_NAME if no source dialect uses the name
+FunctionStatus parse_substr_call_source(const substr_source_set *set, const char *input_str, size_t input_len,
+                        substr_func_view *f_view_out, int *source_id);
+
+// Given
+//    set:       source dialects recognized by function name
+//    input_str: a substr call in any of these dialects
+//    f_syntax:  target DBMS syntax
+// translate in one pass, from the index base of the source dialect to the
+// one of the target. *source_id (may be NULL) is the dialect recognized
+FunctionStatus translate_substr_func_from(const substr_source_set *set, const char *input_str,
+                        const substr_func_syntax *f_syntax, char *out_substr_string, size_t out_str_len,
+                        size_t *out_str_wrt, int *source_id);
+
+#endif // __substr_source_h__
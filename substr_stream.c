@@ -0,0 +1,860 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "substr_stream.h"
+#include "substr_scan.h"
+#include "substr_pool.h"
+#include "substr_telemetry.h"
+
+static const char substr_keyword[] = "substr";
+
+// bytes that can start something of interest in plain SQL text
+static const substr_scan_set text_scan_set = { {'\'', '"', '-', '/', 's', 'S'}, 6 };
+// bytes that matter while looking for the end of a statement
+static const substr_scan_set stmt_scan_set = { {'\'', '"', '-', '/', ';'}, 5 };
+// bytes that matter while looking for the end of a call
+static const substr_scan_set call_scan_set = { {'(', ')', '\'', '"'}, 4 };
+
+/* 
+    characters of an identifier, a SUBSTR keyword must not be part of a longer one */
+static int is_ident_char(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+        || c == '_' || c == '$';
+}
+
+/* 
+    characters a keyword cannot follow: identifiers, and the '.' of a
+    qualified name such as x.SUBSTR(c, 1), which is not the built-in */
+static int is_name_prefix(char c)
+{
+    return is_ident_char(c) || c == '.';
+}
+
+/* 
+    case-insensitive compare of an identifier against the SUBSTR keyword */
+static int is_substr_keyword(const char *ident, size_t len)
+{
+    if (len != sizeof(substr_keyword) - 1) {
+        return 0;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if ((ident[i] | 0x20) != substr_keyword[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* 
+    find the ')' matching the '(' at buf[open], skipping quoted text.
+    return its position, or len if the call is not closed inside buf */
+static size_t find_call_end(const char *buf, size_t len, size_t open)
+{
+    size_t depth = 0;
+
+    for (size_t i = open; i < len; i = substr_scan_find(&call_scan_set, buf, len, i + 1)) {
+        char c = buf[i];
+        if (c == '"' || c == '\'') {
+            const char *close = memchr(buf + i + 1, c, len - i - 1);
+            if (!close) {
+                break;
+            }
+            i = close - buf;
+        } else if (c == '(') {
+            depth++;
+        } else if (--depth == 0) {
+            return i;
+        }
+    }
+    return len;
+}
+
+/* 
+    write every gathered span to the sink and release the scratch space */
+static FunctionStatus rewriter_flush(substr_rewriter *rw)
+{
+    if (rw->iov_cnt > 0 && rw->sink(rw->sink_ctx, rw->iov, rw->iov_cnt) != 0) {
+        return FILE_IO_ERR;
+    }
+    rw->iov_cnt = 0;
+    rw->scratch_used = 0;
+    return RET_SUCCESS;
+}
+
+/* 
+    queue one span of output, flushing first if the iovec array is full */
+static FunctionStatus rewriter_push(substr_rewriter *rw, const char *data, size_t len)
+{
+    if (len == 0) {
+        return RET_SUCCESS;
+    }
+    if (rw->iov_cnt == SUBSTR_STREAM_IOV) {
+        FunctionStatus rc = rewriter_flush(rw);
+        if (rc != RET_SUCCESS) {
+            return rc;
+        }
+    }
+    rw->iov[rw->iov_cnt].iov_base = (void *)data;
+    rw->iov[rw->iov_cnt].iov_len  = len;
+    rw->iov_cnt++;
+    rw->n_bytes_out += len;
+    return RET_SUCCESS;
+}
+
+/* 
+    translate the SUBSTR call in call[0, len) and queue it as spans:
+    function name, '(' and the column are not copied, only the formatted
+    numeric tail goes to the scratch buffer.
+    return RET_SUCCESS if queued, or the error code of the translation */
+static FunctionStatus rewriter_emit_call(substr_rewriter *rw, const char *call, size_t len)
+{
+    substr_func_view f_view_in = {0};
+    substr_func_ref  f_ref_out;
+
+    FunctionStatus rc = parse_substr_call_view(call, len, &f_view_in);
+    if (rc == RET_SUCCESS) {
+        rc = gen_substr_func_ref(rw->f_syntax, call, &f_view_in, &f_ref_out);
+    }
+    if (rc != RET_SUCCESS) {
+        return rc;
+    }
+
+    // the tail and the 4 spans must fit in the current writev
+    if (rw->iov_cnt + 4 > SUBSTR_STREAM_IOV || SUBSTR_STREAM_SCRATCH - rw->scratch_used <= SUBSTR_CMD_TAIL_MAX) {
+        rc = rewriter_flush(rw);
+        if (rc != RET_SUCCESS) {
+            return rc;
+        }
+    }
+
+    char *tail = rw->scratch + rw->scratch_used;
+    long int tail_len = gen_substr_cmd_tail(&f_ref_out, tail, SUBSTR_STREAM_SCRATCH - rw->scratch_used);
+    rw->scratch_used += tail_len;
+
+    rewriter_push(rw, f_ref_out.func_name, f_ref_out.func_name_len);
+    rewriter_push(rw, "(", 1);
+    rewriter_push(rw, f_ref_out.col_name, f_ref_out.col_name_len);
+    rewriter_push(rw, tail, tail_len);
+
+    return RET_SUCCESS;
+}
+
+void substr_rewriter_init(substr_rewriter *rw, const substr_func_syntax *f_syntax,
+                        substr_sink_fn sink, void *sink_ctx)
+{
+    memset(rw, 0, sizeof(*rw));
+    rw->f_syntax = f_syntax;
+    rw->sink     = sink;
+    rw->sink_ctx = sink_ctx;
+    rw->lex      = SUBSTR_LEX_TEXT;
+}
+
+/*
+    the lexer of the rewriter: skip quotes and comments, stop on the next
+    SUBSTR call, or with rules on the next call of one of its names, the
+    index of the rule in *rule. Scanning stops early when a call (or a
+    construct that needs one more byte of lookahead) is cut by the end of
+    buf and more input follows; a pending call longer than
+    SUBSTR_STREAM_MAX_CALL is given up as text.
+*/
+static int lex_next(substr_lex_state *lex, int prev_ident, const char *buf, size_t len, size_t stop,
+                        int is_final, const substr_rule_set *rules, size_t *pos, size_t *call_start,
+                        size_t *call_end, int *rule)
+{
+    size_t i = *pos;
+    int found = SUBSTR_LEX_STOP;
+
+    while (i < len && i < stop) {
+        char c = buf[i];
+
+        if (*lex == SUBSTR_LEX_SQUOTE || *lex == SUBSTR_LEX_DQUOTE) {
+            const char *close = memchr(buf + i, *lex == SUBSTR_LEX_SQUOTE ? '\'' : '"', len - i);
+            if (!close) {
+                i = len;
+                break;
+            }
+            *lex = SUBSTR_LEX_TEXT;
+            i = close - buf + 1;
+            continue;
+        }
+
+        if (*lex == SUBSTR_LEX_LINE_COMMENT) {
+            const char *eol = memchr(buf + i, '\n', len - i);
+            if (!eol) {
+                i = len;
+                break;
+            }
+            *lex = SUBSTR_LEX_TEXT;
+            i = eol - buf + 1;
+            continue;
+        }
+
+        if (*lex == SUBSTR_LEX_BLOCK_COMMENT) {
+            const char *star = memchr(buf + i, '*', len - i);
+            if (!star) {
+                i = len;
+                break;
+            }
+            i = star - buf;
+            if (i + 1 == len && !is_final) {
+                break;  // need the next byte to know if the comment ends
+            }
+            if (i + 1 < len && buf[i + 1] == '/') {
+                *lex = SUBSTR_LEX_TEXT;
+                i += 2;
+            } else {
+                i++;
+            }
+            continue;
+        }
+
+        // plain SQL text, skip to the next byte that may start a quote, a comment or a call
+        if (rules && !rules->starts[(unsigned char)c]) {
+            for (i++; i < len && !rules->starts[(unsigned char)buf[i]]; i++) {
+            }
+            continue;
+        }
+        if (!rules && c != '\'' && c != '"' && c != '-' && c != '/' && (c | 0x20) != 's') {
+            i = substr_scan_find(&text_scan_set, buf, len, i + 1);
+            continue;
+        }
+
+        if (c == '\'') {
+            *lex = SUBSTR_LEX_SQUOTE;
+            i++;
+        } else if (c == '"') {
+            *lex = SUBSTR_LEX_DQUOTE;
+            i++;
+        } else if (c == '-' || c == '/') {
+            if (i + 1 == len && !is_final) {
+                break;  // need the next byte to know if a comment starts
+            }
+            if (i + 1 < len && c == '-' && buf[i + 1] == '-') {
+                *lex = SUBSTR_LEX_LINE_COMMENT;
+                i += 2;
+            } else if (i + 1 < len && c == '/' && buf[i + 1] == '*') {
+                *lex = SUBSTR_LEX_BLOCK_COMMENT;
+                i += 2;
+            } else {
+                i++;
+            }
+        } else if (i > 0 ? is_name_prefix(buf[i - 1]) : prev_ident) {
+            i++;    // 's' inside a longer or qualified identifier
+        } else {
+            size_t ident_end = i;
+            while (ident_end < len && is_ident_char(buf[ident_end])) {
+                ident_end++;
+            }
+            int can_wait = !is_final && len - i < SUBSTR_STREAM_MAX_CALL;
+            if (ident_end == len && can_wait) {
+                break;  // identifier may continue in the next chunk
+            }
+            *rule = rules ? substr_rule_set_find(rules, buf + i, ident_end - i)
+                          : (is_substr_keyword(buf + i, ident_end - i) ? 0 : -1);
+            if (*rule < 0) {
+                i = ident_end;
+                continue;
+            }
+
+            size_t open = ident_end;
+            while (open < len && (buf[open] == ' ' || buf[open] == '\t' || buf[open] == '\n' || buf[open] == '\r')) {
+                open++;
+            }
+            if (open == len && can_wait) {
+                break;
+            }
+            if (open == len || buf[open] != '(') {
+                *call_start = i;
+                *call_end   = open < len ? open + 1 : len;
+                i = ident_end;
+                found = SUBSTR_LEX_KEYWORD;
+                break;
+            }
+
+            size_t close = find_call_end(buf, len, open);
+            if (close == len) {
+                if (can_wait) {
+                    break;  // call is cut by the end of the chunk
+                }
+                *call_start = i;    // never closed, keep it as text
+                *call_end   = len;
+                i = ident_end;
+                found = SUBSTR_LEX_KEYWORD;
+                break;
+            }
+
+            *call_start = i;
+            *call_end   = close + 1;
+            i = close + 1;
+            found = SUBSTR_LEX_CALL;
+            break;
+        }
+    }
+
+    *pos = i;
+    return found;
+}
+
+int substr_lex_next_call(substr_lex_state *lex, int prev_ident, const char *buf, size_t len, size_t stop,
+                        int is_final, size_t *pos, size_t *call_start, size_t *call_end)
+{
+    int rule;
+    return lex_next(lex, prev_ident, buf, len, stop, is_final, NULL, pos, call_start, call_end, &rule);
+}
+
+static FunctionStatus rewriter_scan(substr_rewriter *rw, const char *buf, size_t len, int is_final,
+                        substr_lex_state *lex, int prev_ident, int depth, size_t *consumed);
+
+/*
+    rewrite the complete text[0, len) inside a call, with its own lexer state */
+static FunctionStatus rewriter_scan_text(substr_rewriter *rw, const char *text, size_t len, int depth)
+{
+    substr_lex_state lex = SUBSTR_LEX_TEXT;
+    size_t consumed = 0;
+    return rewriter_scan(rw, text, len, 1, &lex, 0, depth, &consumed);
+}
+
+/*
+    queue prefix followed by v in decimal, both written to the scratch buffer */
+static FunctionStatus rewriter_push_long(substr_rewriter *rw, const char *prefix, long int v)
+{
+    size_t prefix_len = strlen(prefix);
+
+    // flush first so that the push below cannot reuse the scratch space
+    if (rw->iov_cnt == SUBSTR_STREAM_IOV || SUBSTR_STREAM_SCRATCH - rw->scratch_used < prefix_len + 20) {
+        FunctionStatus rc = rewriter_flush(rw);
+        if (rc != RET_SUCCESS) {
+            return rc;
+        }
+    }
+
+    char *text = rw->scratch + rw->scratch_used;
+    memcpy(text, prefix, prefix_len);
+    size_t text_len = prefix_len + gen_substr_long(text + prefix_len, v);
+    rw->scratch_used += text_len;
+    return rewriter_push(rw, text, text_len);
+}
+
+/*
+    1 if an argument is a plain column reference, written as is before a shift */
+static int is_simple_arg(const char *arg, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (!is_ident_char(arg[i]) && arg[i] != '.') {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+    queue one argument of a rule call: a constant position already shifted,
+    an expression position followed by the shift, any other argument with
+    its own calls rewritten */
+static FunctionStatus rewriter_emit_arg(substr_rewriter *rw, const substr_rule *rule,
+                        const substr_rule_call *parsed, const char *call, int a, int depth)
+{
+    const char *arg = call + parsed->args[a].offset;
+    size_t arg_len  = parsed->args[a].length;
+
+    if (parsed->is_const[a]) {
+        return rewriter_push_long(rw, "", parsed->value[a]);
+    }
+    if (!(rule->index_args & SUBSTR_RULE_ARG(a)) || rule->shift == 0) {
+        return rewriter_scan_text(rw, arg, arg_len, depth + 1);
+    }
+
+    int simple = is_simple_arg(arg, arg_len);
+    FunctionStatus rc = simple ? RET_SUCCESS : rewriter_push(rw, "(", 1);
+    if (rc == RET_SUCCESS) {
+        rc = rewriter_scan_text(rw, arg, arg_len, depth + 1);
+    }
+    if (rc == RET_SUCCESS && !simple) {
+        rc = rewriter_push(rw, ")", 1);
+    }
+    if (rc == RET_SUCCESS) {
+        rc = rule->shift < 0 && rule->shift != LONG_MIN ? rewriter_push_long(rw, " - ", -rule->shift)
+                                                        : rewriter_push_long(rw, " + ", rule->shift);
+    }
+    return rc;
+}
+
+/*
+    rewrite the call of rule in call[0, len) as the target name and the
+    arguments in their target order. A call the rule rejects is queued as
+    written, with the calls in its arguments rewritten.
+    return RET_SUCCESS if translated, FILE_IO_ERR, or why the call was rejected */
+static FunctionStatus rewriter_emit_rule(substr_rewriter *rw, const substr_rule *rule, const char *call,
+                        size_t len, int depth)
+{
+    substr_rule_call parsed;
+    FunctionStatus rc = depth < SUBSTR_STREAM_MAX_NESTING ? substr_rule_parse(rule, call, len, &parsed)
+                                                          : FUNC_CALL_SYNTAX_ERR;
+    if (rc != RET_SUCCESS) {
+        const char *open = memchr(call, '(', len);
+        if (depth >= SUBSTR_STREAM_MAX_NESTING || !open) {
+            return rewriter_push(rw, call, len) == RET_SUCCESS ? rc : FILE_IO_ERR;
+        }
+        size_t head = open - call + 1;
+        FunctionStatus io_rc = rewriter_push(rw, call, head);
+        if (io_rc == RET_SUCCESS) {
+            io_rc = rewriter_scan_text(rw, call + head, len - head - 1, depth + 1);
+        }
+        if (io_rc == RET_SUCCESS) {
+            io_rc = rewriter_push(rw, call + len - 1, 1);
+        }
+        return io_rc == RET_SUCCESS ? rc : io_rc;
+    }
+
+    rc = rewriter_push(rw, rule->to_name, rule->to_name_len);
+    if (rc == RET_SUCCESS) {
+        rc = rewriter_push(rw, "(", 1);
+    }
+    for (int k = 0; rc == RET_SUCCESS && k < parsed.n_args; k++) {
+        if (k > 0) {
+            rc = rewriter_push(rw, ", ", 2);
+        }
+        if (rc == RET_SUCCESS) {
+            rc = rewriter_emit_arg(rw, rule, &parsed, call, rule->order ? rule->order[k] - '0' : k, depth);
+        }
+    }
+    if (rc == RET_SUCCESS) {
+        rc = rewriter_push(rw, ")", 1);
+    }
+    return rc;
+}
+
+void substr_rewriter_init_rules(substr_rewriter *rw, const substr_rule_set *rules,
+                        substr_sink_fn sink, void *sink_ctx)
+{
+    substr_rewriter_init(rw, NULL, sink, sink_ctx);
+    rw->rules = rules;
+}
+
+/*
+    queue buf with its calls translated, up to where the lexer stops.
+    With a rule table every call is queued by rewriter_emit_rule, rejected
+    ones included; a SUBSTR call that fails to translate stays a span of buf.
+    Every call is counted in the telemetry like a translation, under the
+    target syntax or, with rules, DBMS_UNKNOWN; the output of a rule call
+    includes the calls nested in it.
+*/
+static FunctionStatus rewriter_scan(substr_rewriter *rw, const char *buf, size_t len, int is_final,
+                        substr_lex_state *lex, int prev_ident, int depth, size_t *consumed)
+{
+    FunctionStatus rc = RET_SUCCESS;
+    size_t span_start = 0;  // start of text not yet queued
+    size_t i = 0, call_start, call_end;
+    int found, rule;
+
+    while ((found = lex_next(lex, prev_ident, buf, len, len, is_final, rw->rules, &i, &call_start, &call_end,
+                        &rule)) != SUBSTR_LEX_STOP) {
+        if (found != SUBSTR_LEX_CALL) {
+            continue;   // keyword without a call, plain text
+        }
+        rw->n_calls++;
+
+        // queue the text before the call, then try to translate it
+        rc = rewriter_push(rw, buf + span_start, call_start - span_start);
+        if (rc != RET_SUCCESS) {
+            return rc;
+        }
+        span_start = call_start;
+#if SUBSTR_TELEMETRY
+        size_t bytes_out = rw->n_bytes_out;
+#endif
+
+        if (rw->rules) {
+            rc = rewriter_emit_rule(rw, &rw->rules->rules[rule], buf + call_start, call_end - call_start, depth);
+            span_start = call_end;
+        } else {
+            rc = rewriter_emit_call(rw, buf + call_start, call_end - call_start);
+            if (rc == RET_SUCCESS) {
+                span_start = call_end;
+            }
+        }
+        if (rc == FILE_IO_ERR) {
+            return rc;
+        }
+        if (rc == RET_SUCCESS) {
+            rw->n_translated++;
+        }
+        SUBSTR_TELEMETRY_COUNT(rw->rules ? DBMS_UNKNOWN : substr_telemetry_key(rw->f_syntax), rc,
+                               call_end - call_start, rc == RET_SUCCESS ? rw->n_bytes_out - bytes_out : 0);
+    }
+
+    *consumed = i;
+    return rewriter_push(rw, buf + span_start, i - span_start);
+}
+
+/*
+    scan buf for SUBSTR calls, or the calls of the rule table, outside of
+    quotes and comments. Text between calls is queued as spans of buf, each
+    call is translated, and calls that fail to translate are passed through
+    unchanged.
+*/
+FunctionStatus substr_rewrite_feed(substr_rewriter *rw, const char *buf, size_t len, int is_final,
+                        size_t *consumed)
+{
+    if (!rw || (!rw->f_syntax && !rw->rules) || !rw->sink || (!buf && len > 0) || !consumed) {
+        return NULL_INPUT_POINTER; // Error: Null pointer
+    }
+
+    size_t i = 0;
+    FunctionStatus rc = rewriter_scan(rw, buf, len, is_final, &rw->lex, rw->prev_ident, 0, &i);
+    if (rc != RET_SUCCESS) {
+        return rc;
+    }
+
+    if (i > 0) {
+        rw->prev_ident = is_name_prefix(buf[i - 1]);
+    }
+    *consumed = i;
+    return rewriter_flush(rw);
+}
+
+/* 
+    sink writing spans to a file descriptor, partial writes are resumed */
+static int fd_sink(void *sink_ctx, struct iovec *iov, int iov_cnt)
+{
+    int fd = *(const int *)sink_ctx;
+
+    while (iov_cnt > 0) {
+        ssize_t written = writev(fd, iov, iov_cnt);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        while (iov_cnt > 0 && (size_t)written >= iov->iov_len) {
+            written -= iov->iov_len;
+            iov++;
+            iov_cnt--;
+        }
+        if (iov_cnt > 0) {
+            iov->iov_base = (char *)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+    return 0;
+}
+
+/* 
+    rewrite a whole mmap'd regular file in one pass */
+static FunctionStatus rewrite_mapped(int fd_in, size_t size, substr_rewriter *rw)
+{
+    if (size == 0) {
+        return RET_SUCCESS;
+    }
+
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd_in, 0);
+    if (map == MAP_FAILED) {
+        return FILE_IO_ERR;
+    }
+    posix_madvise(map, size, POSIX_MADV_SEQUENTIAL);
+
+    size_t consumed = 0;
+    FunctionStatus rc = substr_rewrite_feed(rw, map, size, 1, &consumed);
+
+    munmap(map, size);
+    return rc;
+}
+
+/* 
+    rewrite a pipe or terminal read in fixed-size chunks. Memory is bounded
+    by one chunk plus the longest call kept across a chunk boundary. */
+static FunctionStatus rewrite_chunked(int fd_in, substr_rewriter *rw)
+{
+    size_t cap = SUBSTR_STREAM_CHUNK + SUBSTR_STREAM_MAX_CALL;
+    char *buf = malloc(cap);
+    if (!buf) {
+        return MEMORY_ALLOCATION_ERR;
+    }
+
+    FunctionStatus rc = RET_SUCCESS;
+    size_t held = 0;    // bytes of an unfinished call carried from the last chunk
+    int eof = 0;
+
+    while (rc == RET_SUCCESS && !eof) {
+        ssize_t got = read(fd_in, buf + held, cap - held < SUBSTR_STREAM_CHUNK ? cap - held : SUBSTR_STREAM_CHUNK);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            rc = FILE_IO_ERR;
+            break;
+        }
+        eof = (got == 0);
+
+        size_t len = held + got;
+        size_t consumed = 0;
+        rc = substr_rewrite_feed(rw, buf, len, eof, &consumed);
+
+        held = len - consumed;
+        if (held > 0 && consumed > 0) {
+            memmove(buf, buf + consumed, held);
+        }
+    }
+
+    free(buf);
+    return rc;
+}
+
+/*
+    rewrite fd_in with a rewriter set up to write to a file descriptor */
+static FunctionStatus rewrite_fd_with(int fd_in, substr_rewriter *rw)
+{
+    struct stat st;
+    if (fstat(fd_in, &st) == 0 && S_ISREG(st.st_mode)) {
+        return rewrite_mapped(fd_in, (size_t)st.st_size, rw);
+    }
+    return rewrite_chunked(fd_in, rw);
+}
+
+/*
+    rewrite every SUBSTR call of fd_in to the f_syntax syntax into fd_out
+*/
+FunctionStatus substr_rewrite_fd(int fd_in, int fd_out, const substr_func_syntax *f_syntax)
+{
+    if (!f_syntax) {
+        return NULL_INPUT_POINTER; // Error: Null pointer
+    }
+
+    substr_rewriter rw;
+    substr_rewriter_init(&rw, f_syntax, fd_sink, &fd_out);
+    return rewrite_fd_with(fd_in, &rw);
+}
+
+/*
+    rewrite the calls of every rule of rules in fd_in into fd_out
+*/
+FunctionStatus substr_rewrite_fd_rules(int fd_in, int fd_out, const substr_rule_set *rules)
+{
+    if (!rules) {
+        return NULL_INPUT_POINTER; // Error: Null pointer
+    }
+
+    substr_rewriter rw;
+    substr_rewriter_init_rules(&rw, rules, fd_sink, &fd_out);
+    return rewrite_fd_with(fd_in, &rw);
+}
+
+/* 
+    growable output of one chunk rewritten by a worker */
+typedef struct chunk_output_struct {
+    char  *data ;
+    size_t len  ;
+    size_t cap  ;
+} chunk_output;
+
+/* 
+    sink appending spans to a chunk_output */
+static int buffer_sink(void *sink_ctx, struct iovec *iov, int iov_cnt)
+{
+    chunk_output *out = sink_ctx;
+
+    for (int i = 0; i < iov_cnt; i++) {
+        if (out->len + iov[i].iov_len > out->cap) {
+            size_t cap = out->cap ? out->cap : 4096;
+            while (cap < out->len + iov[i].iov_len) {
+                cap *= 2;
+            }
+            char *data = realloc(out->data, cap);
+            if (!data) {
+                return -1;
+            }
+            out->data = data;
+            out->cap  = cap;
+        }
+        memcpy(out->data + out->len, iov[i].iov_base, iov[i].iov_len);
+        out->len += iov[i].iov_len;
+    }
+    return 0;
+}
+
+/*
+    end of the first statement of buf[from, len) that ends at or after
+    min_end: one past a ';' that is not inside quotes or comments.
+    return len if the text has no such ';'
+*/
+static size_t next_statement_end(const char *buf, size_t len, size_t from, size_t min_end)
+{
+    size_t i = from;
+
+    while ((i = substr_scan_find(&stmt_scan_set, buf, len, i)) < len) {
+        char c = buf[i];
+        const char *skip_to = NULL;
+
+        if (c == ';') {
+            if (i >= min_end) {
+                return i + 1;
+            }
+            i++;
+        } else if (c == '\'' || c == '"') {
+            skip_to = memchr(buf + i + 1, c, len - i - 1);
+            if (!skip_to) {
+                return len;
+            }
+            i = skip_to - buf + 1;
+        } else if (c == '-' && i + 1 < len && buf[i + 1] == '-') {
+            skip_to = memchr(buf + i + 2, '\n', len - i - 2);
+            if (!skip_to) {
+                return len;
+            }
+            i = skip_to - buf + 1;
+        } else if (c == '/' && i + 1 < len && buf[i + 1] == '*') {
+            for (i += 2; i + 1 < len && !(buf[i] == '*' && buf[i + 1] == '/'); i++) {
+            }
+            i += 2;
+        } else {
+            i++;
+        }
+    }
+    return len;
+}
+
+/* 
+    shared state of a parallel rewrite, chunk k is text[bounds[k], bounds[k + 1]) */
+typedef struct parallel_job_struct {
+    const char *text ;
+    const size_t *bounds ;
+    const substr_func_syntax *f_syntax ;
+
+    chunk_output   *outputs ;
+    FunctionStatus *status  ;
+    int            *done    ;
+    pthread_mutex_t lock ;
+    pthread_cond_t  cond ;      /* a chunk is done */
+} parallel_job;
+
+/* 
+    pool task: rewrite one chunk into its own output buffer */
+static void rewrite_chunk_task(void *arg, size_t k)
+{
+    parallel_job *job = arg;
+    size_t chunk_len = job->bounds[k + 1] - job->bounds[k];
+    substr_rewriter rw;
+    size_t consumed = 0;
+
+    substr_rewriter_init(&rw, job->f_syntax, buffer_sink, &job->outputs[k]);
+    FunctionStatus rc = substr_rewrite_feed(&rw, job->text + job->bounds[k], chunk_len, 1, &consumed);
+
+    pthread_mutex_lock(&job->lock);
+    job->status[k] = rc;
+    job->done[k]   = 1;
+    pthread_cond_broadcast(&job->cond);
+    pthread_mutex_unlock(&job->lock);
+}
+
+/* 
+    split the mapped text on statement boundaries, rewrite the chunks on the
+    pool and write the outputs in input order as soon as each one is ready */
+static FunctionStatus rewrite_mapped_parallel(const char *text, size_t size, int fd_out,
+                        const substr_func_syntax *f_syntax, int n_threads)
+{
+    size_t chunk_size = size / ((size_t)n_threads * 16);
+    if (chunk_size < SUBSTR_PARALLEL_MIN_CHUNK) {
+        chunk_size = SUBSTR_PARALLEL_MIN_CHUNK;
+    } else if (chunk_size > SUBSTR_PARALLEL_MAX_CHUNK) {
+        chunk_size = SUBSTR_PARALLEL_MAX_CHUNK;
+    }
+
+    size_t max_chunks = size / chunk_size + 1;
+    size_t *bounds          = malloc((max_chunks + 1) * sizeof(*bounds));
+    chunk_output *outputs   = calloc(max_chunks, sizeof(*outputs));
+    FunctionStatus *status  = calloc(max_chunks, sizeof(*status));
+    int *done               = calloc(max_chunks, sizeof(*done));
+    substr_pool *pool       = NULL;
+    FunctionStatus rc       = RET_SUCCESS;
+
+    if (!bounds || !outputs || !status || !done) {
+        rc = MEMORY_ALLOCATION_ERR;
+        goto END;
+    }
+
+    // every chunk is at least chunk_size long, so there are at most max_chunks
+    size_t n_chunks = 0;
+    bounds[0] = 0;
+    while (bounds[n_chunks] < size) {
+        bounds[n_chunks + 1] = next_statement_end(text, size, bounds[n_chunks], bounds[n_chunks] + chunk_size);
+        n_chunks++;
+    }
+
+    pool = substr_pool_create(n_threads);
+    if (!pool) {
+        rc = MEMORY_ALLOCATION_ERR;
+        goto END;
+    }
+
+    parallel_job job = { text, bounds, f_syntax, outputs, status, done,
+                         PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER };
+    substr_pool_start(pool, rewrite_chunk_task, &job, n_chunks);
+
+    for (size_t k = 0; k < n_chunks; k++) {
+        pthread_mutex_lock(&job.lock);
+        while (!done[k]) {
+            pthread_cond_wait(&job.cond, &job.lock);
+        }
+        pthread_mutex_unlock(&job.lock);
+
+        if (rc == RET_SUCCESS) {
+            rc = status[k];
+        }
+        if (rc == RET_SUCCESS && outputs[k].len > 0) {
+            struct iovec iov = { outputs[k].data, outputs[k].len };
+            if (fd_sink(&fd_out, &iov, 1) != 0) {
+                rc = FILE_IO_ERR;
+            }
+        }
+        free(outputs[k].data);
+        outputs[k].data = NULL;
+    }
+
+    substr_pool_wait(pool);
+    pthread_cond_destroy(&job.cond);
+    pthread_mutex_destroy(&job.lock);
+
+    END:
+    substr_pool_destroy(pool);
+    free(done);
+    free(status);
+    free(outputs);
+    free(bounds);
+    return rc;
+}
+
+/*
+    rewrite a regular file on n_threads workers, other inputs and small
+    files go through substr_rewrite_fd
+*/
+FunctionStatus substr_rewrite_fd_parallel(int fd_in, int fd_out, const substr_func_syntax *f_syntax, int n_threads)
+{
+    if (!f_syntax) {
+        return NULL_INPUT_POINTER; // Error: Null pointer
+    }
+
+    struct stat st;
+    if (n_threads <= 1 || fstat(fd_in, &st) != 0 || !S_ISREG(st.st_mode)
+        || (size_t)st.st_size < 2 * SUBSTR_PARALLEL_MIN_CHUNK) {
+        return substr_rewrite_fd(fd_in, fd_out, f_syntax);
+    }
+
+    size_t size = (size_t)st.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd_in, 0);
+    if (map == MAP_FAILED) {
+        return FILE_IO_ERR;
+    }
+    posix_madvise(map, size, POSIX_MADV_WILLNEED);
+
+    FunctionStatus rc = rewrite_mapped_parallel(map, size, fd_out, f_syntax, n_threads);
+
+    munmap(map, size);
+    return rc;
+}
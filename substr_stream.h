@@ -0,0 +1,111 @@
+#ifndef __substr_stream_h__
+#define __substr_stream_h__
+
+#include <sys/uio.h>
+
+#include "substr_wrapper.h"
+#include "substr_rules.h"
+
+// bytes read at a time when the input is not a regular file (pipes, stdin)
+#define SUBSTR_STREAM_CHUNK     (64 * 1024)
+// longest SUBSTR call kept across chunk boundaries, longer ones pass through unchanged
+#define SUBSTR_STREAM_MAX_CALL  (1024 * 1024)
+// size range of the statement-aligned chunks of a parallel rewrite
+#define SUBSTR_PARALLEL_MIN_CHUNK  (64 * 1024)
+#define SUBSTR_PARALLEL_MAX_CHUNK  (4 * 1024 * 1024)
+// output spans gathered before one writev
+#define SUBSTR_STREAM_IOV       64
+// room for the translated ", start, length)" pieces waiting in one writev
+#define SUBSTR_STREAM_SCRATCH   (SUBSTR_STREAM_IOV * 32)
+// deepest rule call rewritten inside the arguments of another, deeper ones pass through unchanged
+#define SUBSTR_STREAM_MAX_NESTING  64
+
+// where the rewriter sends its output, iov may be modified by the sink.
+// return 0 if all spans are written, -1 otherwise
+typedef int (*substr_sink_fn)(void *sink_ctx, struct iovec *iov, int iov_cnt);
+
+// lexical state carried from one chunk to the next
+typedef enum {
+    SUBSTR_LEX_TEXT = 0,
+    SUBSTR_LEX_SQUOTE,          /* inside '...' */
+    SUBSTR_LEX_DQUOTE,          /* inside "..." */
+    SUBSTR_LEX_LINE_COMMENT,    /* inside -- ... */
+    SUBSTR_LEX_BLOCK_COMMENT,   /* inside a block comment */
+} substr_lex_state;
+
+// state of a rewriter finding SUBSTR calls, or the calls of a rule table, in arbitrary SQL text
+typedef struct substr_rewriter_struct {
+    const substr_func_syntax *f_syntax ;  /* target DBMS syntax */
+    const substr_rule_set    *rules    ;  /* rewrite rules used instead of f_syntax, or NULL */
+    substr_sink_fn sink     ;
+    void          *sink_ctx ;
+
+    substr_lex_state lex    ;
+    int prev_ident          ;  /* 1 if the last byte consumed is part of an identifier or a '.' */
+
+    struct iovec iov[SUBSTR_STREAM_IOV] ;
+    int          iov_cnt   ;
+    char   scratch[SUBSTR_STREAM_SCRATCH] ;
+    size_t scratch_used    ;
+
+    size_t n_calls         ;  /* SUBSTR or rule calls found */
+    size_t n_translated    ;  /* calls rewritten, the others pass through unchanged */
+    size_t n_bytes_out     ;  /* bytes queued for the sink */
+} substr_rewriter;
+
+// results of substr_lex_next_call
+#define SUBSTR_LEX_STOP     0
+#define SUBSTR_LEX_CALL     1
+#define SUBSTR_LEX_KEYWORD  2
+
+// Given
+//    lex:        lexical state at buf[*pos], updated as the scan goes
+//    prev_ident: 1 if the byte before buf[0] is part of an identifier or a '.';
+//                a call qualified by a schema or an object is not the built-in
+//    stop:       the scan also stops at its first step at or past stop
+//    is_final:   1 if no more input follows buf
+// find the next SUBSTR call in buf[*pos, len) outside quotes and comments.
+// return SUBSTR_LEX_CALL with the call in buf[*call_start, *call_end) and
+//        *pos at its end,
+//        SUBSTR_LEX_KEYWORD for a SUBSTR keyword that is not a call, with the
+//        keyword at *call_start, *call_end past the last byte looked at to
+//        decide it, and *pos after the keyword,
+//        SUBSTR_LEX_STOP with *pos where the scan stopped; when more input
+//        follows, the bytes from *pos on must be passed again with it
+int substr_lex_next_call(substr_lex_state *lex, int prev_ident, const char *buf, size_t len, size_t stop,
+                        int is_final, size_t *pos, size_t *call_start, size_t *call_end);
+
+// set up a rewriter for a target DBMS syntax and an output sink
+void substr_rewriter_init(substr_rewriter *rw, const substr_func_syntax *f_syntax,
+                        substr_sink_fn sink, void *sink_ctx);
+
+// Set up a rewriter applying every rule of rules in the same scan. Calls a
+// rule rejects are left as written, the calls in their arguments are still
+// rewritten
+void substr_rewriter_init_rules(substr_rewriter *rw, const substr_rule_set *rules,
+                        substr_sink_fn sink, void *sink_ctx);
+
+// Given
+//    buf, len: next piece of the input text,
+//    is_final: 1 if no more input follows buf
+//    consumed: number of bytes of buf handled; the rest starts an unfinished
+//              SUBSTR call and must be passed again, followed by more input
+// Text that is not a SUBSTR call is sent to the sink as spans of buf,
+// everything is written before the function returns.
+FunctionStatus substr_rewrite_feed(substr_rewriter *rw, const char *buf, size_t len, int is_final,
+                        size_t *consumed);
+
+// rewrite every SUBSTR call read from fd_in into fd_out.
+// regular files are mmap'd, other inputs are read in SUBSTR_STREAM_CHUNK pieces
+FunctionStatus substr_rewrite_fd(int fd_in, int fd_out, const substr_func_syntax *f_syntax);
+
+// substr_rewrite_fd applying a rule table instead of one SUBSTR syntax
+FunctionStatus substr_rewrite_fd_rules(int fd_in, int fd_out, const substr_rule_set *rules);
+
+// Rewrite a regular file on a pool of n_threads workers. The file is split on
+// statement boundaries (';' outside quotes and comments), the chunks are
+// rewritten in parallel and written to fd_out in the original order.
+// Other inputs, small files or n_threads <= 1 use substr_rewrite_fd.
+FunctionStatus substr_rewrite_fd_parallel(int fd_in, int fd_out, const substr_func_syntax *f_syntax, int n_threads);
+
+#endif // __substr_stream_h__
@@ -0,0 +1,212 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <time.h>
+#include <pthread.h>
+
+#include "substr_telemetry.h"
+
+/*
+    counters of one thread. Only the owning thread writes them, so an update
+    is a relaxed load and store with no locked instruction; readers sum all
+    slots. Each slot starts on its own cache line so threads never share one */
+typedef struct telemetry_slot_struct {
+    uint64_t translations [SUBSTR_TELEMETRY_MAX_DBMS];
+    uint64_t status       [SUBSTR_TELEMETRY_MAX_STATUS];
+    uint64_t bytes_in, bytes_out;
+    uint64_t latency      [SUBSTR_TELEMETRY_STAGES][SUBSTR_TELEMETRY_BUCKETS];
+    uint64_t tick ;                         /* translations seen, drives the sampling */
+    int in_use    ;                         /* owned by a live thread */
+    struct telemetry_slot_struct *next ;    /* all slots ever created */
+} __attribute__((aligned(64))) telemetry_slot;
+
+#if SUBSTR_TELEMETRY
+
+static telemetry_slot *slots_head = NULL;
+static __thread telemetry_slot *thread_slot = NULL;
+static pthread_key_t   slot_key;
+static pthread_once_t  slot_key_once = PTHREAD_ONCE_INIT;
+
+/*
+    thread exit: the slot is handed to the next new thread, with its counts */
+static void slot_release(void *slot)
+{
+    __atomic_store_n(&((telemetry_slot *)slot)->in_use, 0, __ATOMIC_RELEASE);
+}
+
+static void slot_key_create(void)
+{
+    pthread_key_create(&slot_key, slot_release);
+}
+
+/*
+    slot of the calling thread: reuse one left by an exited thread, or
+    push a new one on the list. NULL if out of memory, nothing is recorded */
+static telemetry_slot *slot_acquire(void)
+{
+    pthread_once(&slot_key_once, slot_key_create);
+
+    telemetry_slot *slot;
+    for (slot = __atomic_load_n(&slots_head, __ATOMIC_ACQUIRE); slot; slot = slot->next) {
+        int free_slot = 0;
+        if (__atomic_compare_exchange_n(&slot->in_use, &free_slot, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+
+    if (!slot) {
+        void *mem = NULL;
+        if (posix_memalign(&mem, 64, sizeof(telemetry_slot)) != 0) {
+            return NULL;
+        }
+        slot = memset(mem, 0, sizeof(telemetry_slot));
+        slot->in_use = 1;
+        slot->next = __atomic_load_n(&slots_head, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&slots_head, &slot->next, slot, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        }
+    }
+
+    pthread_setspecific(slot_key, slot);
+    thread_slot = slot;
+    return slot;
+}
+
+static inline telemetry_slot *slot_get(void)
+{
+    return thread_slot ? thread_slot : slot_acquire();
+}
+
+static inline void slot_add(uint64_t *counter, uint64_t v)
+{
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + v, __ATOMIC_RELAXED);
+}
+
+static uint64_t telemetry_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void substr_telemetry_count(int DBMS_id, FunctionStatus status, size_t bytes_in, size_t bytes_out)
+{
+    telemetry_slot *slot = slot_get();
+    if (!slot) {
+        return;
+    }
+
+    size_t dbms  = (DBMS_id >= 0 && DBMS_id < SUBSTR_TELEMETRY_MAX_DBMS) ? (size_t)DBMS_id : DBMS_UNKNOWN;
+    size_t code  = (status <= 0 && -status < SUBSTR_TELEMETRY_MAX_STATUS) ? (size_t)-status : SUBSTR_TELEMETRY_MAX_STATUS - 1;
+    slot_add(&slot->translations[dbms], 1);
+    slot_add(&slot->status[code], 1);
+    slot_add(&slot->bytes_in, bytes_in);
+    slot_add(&slot->bytes_out, bytes_out);
+}
+
+void substr_telemetry_start(substr_telemetry_timer *timer)
+{
+    telemetry_slot *slot = slot_get();
+    timer->last = 0;
+    if (!slot) {
+        return;
+    }
+
+    uint64_t tick = slot->tick;
+    __atomic_store_n(&slot->tick, tick + 1, __ATOMIC_RELAXED);
+    if ((tick & (SUBSTR_TELEMETRY_SAMPLE - 1)) == 0) {
+        timer->last = telemetry_now();
+    }
+}
+
+/*
+    record the time since the previous lap, divided over n_items when a
+    stage ran for a whole block of inputs */
+void substr_telemetry_lap(substr_telemetry_timer *timer, substr_stage stage, size_t n_items)
+{
+    if (!timer->last || stage < SUBSTR_STAGE_PARSE || stage > SUBSTR_STAGE_EMIT) {
+        return;
+    }
+
+    uint64_t now = telemetry_now();
+    uint64_t ns  = (now - timer->last) / (n_items ? n_items : 1);
+    timer->last = now;
+
+    int bucket = 63 - __builtin_clzll(ns | 1);
+    if (bucket >= SUBSTR_TELEMETRY_BUCKETS) {
+        bucket = SUBSTR_TELEMETRY_BUCKETS - 1;
+    }
+    slot_add(&thread_slot->latency[stage - SUBSTR_STAGE_PARSE][bucket], n_items ? n_items : 1);
+}
+
+void substr_telemetry_read(substr_telemetry_snapshot *snap)
+{
+    memset(snap, 0, sizeof(*snap));
+
+    for (telemetry_slot *slot = __atomic_load_n(&slots_head, __ATOMIC_ACQUIRE); slot; slot = slot->next) {
+        for (int i = 0; i < SUBSTR_TELEMETRY_MAX_DBMS; i++) {
+            snap->translations[i] += __atomic_load_n(&slot->translations[i], __ATOMIC_RELAXED);
+        }
+        for (int i = 0; i < SUBSTR_TELEMETRY_MAX_STATUS; i++) {
+            snap->status[i] += __atomic_load_n(&slot->status[i], __ATOMIC_RELAXED);
+        }
+        snap->bytes_in  += __atomic_load_n(&slot->bytes_in, __ATOMIC_RELAXED);
+        snap->bytes_out += __atomic_load_n(&slot->bytes_out, __ATOMIC_RELAXED);
+        for (int s = 0; s < SUBSTR_TELEMETRY_STAGES; s++) {
+            for (int b = 0; b < SUBSTR_TELEMETRY_BUCKETS; b++) {
+                snap->latency[s][b] += __atomic_load_n(&slot->latency[s][b], __ATOMIC_RELAXED);
+            }
+        }
+        snap->n_threads++;
+    }
+}
+
+#else
+
+void substr_telemetry_read(substr_telemetry_snapshot *snap)
+{
+    memset(snap, 0, sizeof(*snap));
+}
+
+#endif // SUBSTR_TELEMETRY
+
+/*
+    the syntax table translations are keyed by, compared as addresses */
+static uintptr_t key_table_begin = 0, key_table_end = 0;
+
+void substr_telemetry_set_table(const substr_func_syntax *f_syntax, size_t n_syntax)
+{
+    __atomic_store_n(&key_table_end, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&key_table_begin, (uintptr_t)f_syntax, __ATOMIC_RELAXED);
+    __atomic_store_n(&key_table_end, f_syntax ? (uintptr_t)(f_syntax + n_syntax) : 0, __ATOMIC_RELAXED);
+}
+
+int substr_telemetry_key(const substr_func_syntax *f_syntax)
+{
+    uintptr_t begin = __atomic_load_n(&key_table_begin, __ATOMIC_RELAXED);
+    uintptr_t end   = __atomic_load_n(&key_table_end, __ATOMIC_RELAXED);
+    uintptr_t entry = (uintptr_t)f_syntax;
+    if (entry < begin || entry >= end) {
+        return DBMS_UNKNOWN;
+    }
+    return (int)((entry - begin) / sizeof(substr_func_syntax));
+}
+
+uint64_t substr_telemetry_quantile(const uint64_t *latency, double q)
+{
+    uint64_t total = 0;
+    for (int b = 0; b < SUBSTR_TELEMETRY_BUCKETS; b++) {
+        total += latency[b];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    uint64_t rank = (uint64_t)(q * total + 0.5), seen = 0;
+    rank = rank ? rank : 1;
+    for (int b = 0; b < SUBSTR_TELEMETRY_BUCKETS; b++) {
+        seen += latency[b];
+        if (seen >= rank) {
+            return 2ULL << b;
+        }
+    }
+    return 2ULL << (SUBSTR_TELEMETRY_BUCKETS - 1);
+}
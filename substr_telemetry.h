@@ -0,0 +1,82 @@
+#ifndef __substr_telemetry_h__
+#define __substr_telemetry_h__
+
+#include <stdint.h>
+
+#include "substr_wrapper.h"
+
+// Build with -DSUBSTR_TELEMETRY=0 to compile the instrumentation out:
+// the recording macros expand to nothing and snapshots read all zeros
+#ifndef SUBSTR_TELEMETRY
+#define SUBSTR_TELEMETRY 1
+#endif
+
+// translations are counted per target DBMS_ID, translations without an ID
+// and IDs past the last counter are counted under DBMS_UNKNOWN
+#define SUBSTR_TELEMETRY_MAX_DBMS    8
+// key of a translation the caller counts itself, it is not counted again
+#define SUBSTR_TELEMETRY_NONE        (-1)
+// counters per status code, indexed by -status
+#define SUBSTR_TELEMETRY_MAX_STATUS  32
+// timed stages: parse, generate, emit (substr_stage - SUBSTR_STAGE_PARSE)
+#define SUBSTR_TELEMETRY_STAGES      3
+// latency bucket b counts the stages that took [2^b, 2^(b+1)) ns
+#define SUBSTR_TELEMETRY_BUCKETS     32
+// one translation in SUBSTR_TELEMETRY_SAMPLE per thread is timed, power of two
+#define SUBSTR_TELEMETRY_SAMPLE      64
+
+// sum of the counters of all threads, read by substr_telemetry_read
+typedef struct substr_telemetry_snapshot_struct {
+    uint64_t translations [SUBSTR_TELEMETRY_MAX_DBMS]   ;  /* per target DBMS */
+    uint64_t status       [SUBSTR_TELEMETRY_MAX_STATUS] ;  /* status[-code], status[0] is success */
+    uint64_t bytes_in   ;  /* input bytes of the counted translations */
+    uint64_t bytes_out  ;  /* output bytes written by them */
+    uint64_t latency    [SUBSTR_TELEMETRY_STAGES][SUBSTR_TELEMETRY_BUCKETS];  /* sampled */
+    uint64_t n_threads  ;  /* threads that recorded something */
+} substr_telemetry_snapshot;
+
+// Sum the per-thread counters into snap. Safe while other threads record,
+// each counter is read once, the snapshot is not atomic across counters
+void substr_telemetry_read(substr_telemetry_snapshot *snap);
+
+// upper bound in ns of the bucket holding the q-quantile (0 < q <= 1) of a
+// latency histogram, 0 if it is empty
+uint64_t substr_telemetry_quantile(const uint64_t *latency, double q);
+
+// Count the translations given a syntax entry but no ID, such as
+// translate_substr_func(&f_syntax[i], ...), under the index i of the entry
+// in this table. Call once before translating, the table must stay valid
+void substr_telemetry_set_table(const substr_func_syntax *f_syntax, size_t n_syntax);
+
+// counter of a translation to f_syntax: its index in the table of
+// substr_telemetry_set_table, DBMS_UNKNOWN if the entry is not in it
+int substr_telemetry_key(const substr_func_syntax *f_syntax);
+
+#if SUBSTR_TELEMETRY
+
+// stage timer of one translation, running only for sampled translations
+typedef struct substr_telemetry_timer_struct {
+    uint64_t last ;  /* ns of the previous lap, 0 if not sampled */
+} substr_telemetry_timer;
+
+// recording side, used by the translators
+void substr_telemetry_count(int DBMS_id, FunctionStatus status, size_t bytes_in, size_t bytes_out);
+void substr_telemetry_start(substr_telemetry_timer *timer);
+void substr_telemetry_lap(substr_telemetry_timer *timer, substr_stage stage, size_t n_items);
+
+#define SUBSTR_TELEMETRY_TIMER(timer) \
+    substr_telemetry_timer timer; substr_telemetry_start(&timer)
+#define SUBSTR_TELEMETRY_LAP(timer, stage, n_items) \
+    substr_telemetry_lap(&(timer), stage, n_items)
+#define SUBSTR_TELEMETRY_COUNT(DBMS_id, status, bytes_in, bytes_out) \
+    substr_telemetry_count(DBMS_id, status, bytes_in, bytes_out)
+
+#else
+
+#define SUBSTR_TELEMETRY_TIMER(timer)
+#define SUBSTR_TELEMETRY_LAP(timer, stage, n_items)                    ((void)0)
+#define SUBSTR_TELEMETRY_COUNT(DBMS_id, status, bytes_in, bytes_out)   ((void)0)
+
+#endif // SUBSTR_TELEMETRY
+
+#endif // __substr_telemetry_h__
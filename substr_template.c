@@ -0,0 +1,286 @@
+#include "substr_template.h"
+#include "substr_expr.h"
+
+typedef enum {
+    SEG_TEXT = 0,
+    SEG_COL,
+    SEG_START,      /* ", start_pos" */
+    SEG_LENGTH,     /* ", length", nothing if length <= 0 */
+} template_seg_kind;
+
+typedef struct {
+    template_seg_kind kind ;
+    size_t offset ;     /* SEG_TEXT: range of tpl->text */
+    size_t length ;
+} template_seg;
+
+// text, col, text, start, text, length, text
+#define TEMPLATE_MAX_SEGS  7
+
+struct substr_template_struct {
+    size_t size       ;     /* bytes allocated for the template */
+    int neg_start     ;
+    int shift_start   ;
+    int slots         ;
+    int n_segs        ;
+    template_seg segs[TEMPLATE_MAX_SEGS] ;
+    size_t text_len   ;     /* fixed chars, the sum of the SEG_TEXT lengths */
+    char text[]       ;
+};
+
+/*
+    append fixed text, merged into the last segment if it is text too */
+static void append_text(substr_template *tpl, const char *s, size_t n)
+{
+    if (n == 0) {
+        return;
+    }
+    if (tpl->n_segs == 0 || tpl->segs[tpl->n_segs - 1].kind != SEG_TEXT) {
+        template_seg *seg = &tpl->segs[tpl->n_segs++];
+        seg->kind   = SEG_TEXT;
+        seg->offset = tpl->text_len;
+        seg->length = 0;
+    }
+    memcpy(tpl->text + tpl->text_len, s, n);
+    tpl->text_len += n;
+    tpl->segs[tpl->n_segs - 1].length += n;
+}
+
+static void append_slot(substr_template *tpl, template_seg_kind kind, int slot)
+{
+    template_seg *seg = &tpl->segs[tpl->n_segs++];
+    seg->kind   = kind;
+    seg->offset = 0;
+    seg->length = 0;
+    tpl->slots |= slot;
+}
+
+/*
+    first placeholder under node, NULL if none */
+static const substr_node *find_param(const substr_node *node)
+{
+    if (node->kind == SUBSTR_NODE_PARAM) {
+        return node;
+    }
+    for (const substr_node *child = node->child; child; child = child->next) {
+        const substr_node *param = find_param(child);
+        if (param) {
+            return param;
+        }
+    }
+    return NULL;
+}
+
+/*
+    append ", v" */
+static void append_number(substr_template *tpl, long int v)
+{
+    char number[2 + 20];
+    number[0] = ',';
+    number[1] = ' ';
+    append_text(tpl, number, 2 + gen_substr_long(number + 2, v));
+}
+
+/*
+    compile the call under root into tpl, or only measure its fixed text if
+    tpl is NULL. return RET_SUCCESS or the error, described in diag */
+static FunctionStatus compile_template(const char *template_str, const substr_node *root,
+                        const substr_func_syntax *f_syntax, substr_template *tpl, size_t *text_len,
+                        substr_diag *diag)
+{
+    const substr_node *arg    = root->child;
+    const substr_node *start  = arg ? arg->next : NULL;
+    const substr_node *length = start ? start->next : NULL;
+
+    if (!start) {
+        return substr_diag_report(diag, template_str, FUNC_CALL_WRONG_START_POS, SUBSTR_STAGE_PARSE,
+                                  root->span.offset + root->span.length - 1);
+    }
+    if (length && length->next) {
+        return substr_diag_report(diag, template_str, FUNC_CALL_WRONG_LENGTH, SUBSTR_STAGE_PARSE,
+                                  length->next->span.offset);
+    }
+    if (start->kind != SUBSTR_NODE_PARAM && (start->kind != SUBSTR_NODE_NUMBER || !start->is_int)) {
+        return substr_diag_report(diag, template_str, FUNC_CALL_WRONG_START_POS, SUBSTR_STAGE_PARSE, start->span.offset);
+    }
+    if (length && length->kind != SUBSTR_NODE_PARAM && (length->kind != SUBSTR_NODE_NUMBER || !length->is_int)) {
+        return substr_diag_report(diag, template_str, FUNC_CALL_WRONG_LENGTH, SUBSTR_STAGE_PARSE, length->span.offset);
+    }
+    const substr_node *nested = arg->kind == SUBSTR_NODE_PARAM ? NULL : find_param(arg);
+    if (nested) {
+        return substr_diag_report(diag, template_str, FUNC_CALL_SYNTAX_ERR, SUBSTR_STAGE_PARSE, nested->span.offset);
+    }
+    if (start->kind == SUBSTR_NODE_NUMBER && start->value < 0 && f_syntax->neg_start <= 0) {
+        return substr_diag_report(diag, template_str, SUBSTR_STARTPOS_NEGATIVE, SUBSTR_STAGE_GENERATE, start->span.offset);
+    }
+
+    size_t func_name_len = f_syntax->func_name_len ? f_syntax->func_name_len : strlen(f_syntax->func_name);
+    size_t col_len = 0;
+    FunctionStatus rc = RET_SUCCESS;
+    if (arg->kind != SUBSTR_NODE_PARAM) {
+        rc = emit_substr_expr(template_str, arg, f_syntax, NULL, 0, &col_len, diag);
+        if (rc != RET_SUCCESS) {
+            return rc;
+        }
+    }
+
+    if (!tpl) {
+        *text_len = func_name_len + 1 + col_len + SUBSTR_CMD_TAIL_MAX;
+        return RET_SUCCESS;
+    }
+
+    append_text(tpl, f_syntax->func_name, func_name_len);
+    append_text(tpl, "(", 1);
+    if (arg->kind == SUBSTR_NODE_PARAM) {
+        append_slot(tpl, SEG_COL, SUBSTR_SLOT_COL);
+    } else {
+        // write the column straight after "(", the measuring pass left room for it
+        emit_substr_expr(template_str, arg, f_syntax, tpl->text + tpl->text_len, col_len + 1, &col_len, NULL);
+        tpl->text_len += col_len;
+        tpl->segs[tpl->n_segs - 1].length += col_len;
+    }
+
+    if (start->kind == SUBSTR_NODE_PARAM) {
+        append_slot(tpl, SEG_START, SUBSTR_SLOT_START);
+    } else {
+        append_number(tpl, start->value + f_syntax->shift_start);
+    }
+
+    if (length && length->kind == SUBSTR_NODE_PARAM) {
+        append_slot(tpl, SEG_LENGTH, SUBSTR_SLOT_LENGTH);
+    } else if (length && length->value > 0) {
+        append_number(tpl, length->value);
+    }
+
+    append_text(tpl, ")", 1);
+    return RET_SUCCESS;
+}
+
+/*
+    parse the template once into a scratch arena, measure its fixed text,
+    then compile it into one allocation of ctx.
+    return RET_SUCCESS or the error, also described in diag (may be NULL)
+*/
+FunctionStatus substr_template_prepare(substr_ctx *ctx, const char *template_str, const substr_func_syntax *f_syntax,
+                        substr_template **tpl_out, substr_diag *diag)
+{
+    if (!ctx || !template_str || !f_syntax || !f_syntax->func_name || !tpl_out) {
+        return substr_diag_report(diag, template_str, NULL_INPUT_POINTER, SUBSTR_STAGE_ARGS, 0);
+    }
+    *tpl_out = NULL;
+
+    substr_ctx scratch;
+    substr_ctx_init(&scratch, NULL);
+
+    substr_node *root = NULL;
+    FunctionStatus rc = parse_substr_expr(&scratch, template_str, strlen(template_str), &root, diag);
+    if (rc != RET_SUCCESS) {
+        goto END;
+    }
+    if (root->kind != SUBSTR_NODE_CALL) {
+        rc = substr_diag_report(diag, template_str, FUNC_CALL_PARENS_MISMATCH, SUBSTR_STAGE_PARSE, root->span.offset);
+        goto END;
+    }
+
+    size_t text_cap = 0;
+    rc = compile_template(template_str, root, f_syntax, NULL, &text_cap, diag);
+    if (rc != RET_SUCCESS) {
+        goto END;
+    }
+
+    size_t size = sizeof(substr_template) + text_cap;
+    substr_template *tpl = substr_ctx_alloc(ctx, size);
+    if (!tpl) {
+        rc = substr_diag_report(diag, template_str, MEMORY_ALLOCATION_ERR, SUBSTR_STAGE_GENERATE, 0);
+        goto END;
+    }
+    memset(tpl, 0, sizeof(*tpl));
+    tpl->size        = size;
+    tpl->neg_start   = f_syntax->neg_start;
+    tpl->shift_start = f_syntax->shift_start;
+
+    rc = compile_template(template_str, root, f_syntax, tpl, NULL, diag);
+    *tpl_out = tpl;
+
+END:
+    substr_ctx_destroy(&scratch);
+    return rc;
+}
+
+void substr_template_release(substr_ctx *ctx, substr_template *tpl)
+{
+    if (tpl) {
+        substr_ctx_release(ctx, tpl, tpl->size);
+    }
+}
+
+int substr_template_slots(const substr_template *tpl)
+{
+    return tpl ? tpl->slots : 0;
+}
+
+/*
+    fill the slots of a template: the output length is known from the fixed
+    text and the widths of the bound values, then every segment is one memcpy
+    or one integer conversion. Nothing is parsed.
+*/
+long int substr_template_render(const substr_template *tpl, const char *col_name, size_t col_name_len,
+                        long int start_pos, long int length, char *substr_string, size_t str_len)
+{
+    if (!tpl || (substr_string && str_len == 0) || ((tpl->slots & SUBSTR_SLOT_COL) && !col_name)) {
+        return NULL_INPUT_POINTER; // Error: Null pointer or zero length
+    }
+
+    size_t cmd_len = tpl->text_len;
+    if (tpl->slots & SUBSTR_SLOT_COL) {
+        cmd_len += col_name_len;
+    }
+    if (tpl->slots & SUBSTR_SLOT_START) {
+        // check if negative start position is allowed, then shift it to the target index base
+        if (start_pos < 0 && tpl->neg_start <= 0) {
+            return SUBSTR_STARTPOS_NEGATIVE;
+        }
+        start_pos += tpl->shift_start;
+        cmd_len += 2 + gen_substr_long(NULL, start_pos);
+    }
+    if ((tpl->slots & SUBSTR_SLOT_LENGTH) && length > 0) {
+        cmd_len += 2 + gen_substr_long(NULL, length);
+    }
+
+    if (!substr_string) {
+        return cmd_len; // size query
+    }
+    if (cmd_len >= str_len) {
+        return TOO_SHORT_OUTPUT_BUFFER; // Error: Output buffer too small
+    }
+
+    char *p = substr_string;
+    for (int i = 0; i < tpl->n_segs; i++) {
+        const template_seg *seg = &tpl->segs[i];
+        switch (seg->kind) {
+        case SEG_TEXT:
+            memcpy(p, tpl->text + seg->offset, seg->length);
+            p += seg->length;
+            break;
+        case SEG_COL:
+            memcpy(p, col_name, col_name_len);
+            p += col_name_len;
+            break;
+        case SEG_START:
+            *p++ = ',';
+            *p++ = ' ';
+            p += gen_substr_long(p, start_pos);
+            break;
+        case SEG_LENGTH:
+            if (length > 0) {
+                *p++ = ',';
+                *p++ = ' ';
+                p += gen_substr_long(p, length);
+            }
+            break;
+        }
+    }
+    *p = '\0';
+
+    return cmd_len;
+}
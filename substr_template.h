@@ -0,0 +1,32 @@
+#ifndef __substr_template_h__
+#define __substr_template_h__
+
+#include "substr_wrapper.h"
+
+// slots of a template, see substr_template_slots
+#define SUBSTR_SLOT_COL     1
+#define SUBSTR_SLOT_START   2
+#define SUBSTR_SLOT_LENGTH  4
+
+typedef struct substr_template_struct substr_template;
+
+// Parse a substr call with ? placeholders, such as "SUBSTR(col, ?, ?)", once
+// and compile it for a target syntax into fixed text and slots.
+// Each argument is either a whole ? or fixed; the template is allocated in ctx
+FunctionStatus substr_template_prepare(substr_ctx *ctx, const char *template_str, const substr_func_syntax *f_syntax,
+                        substr_template **tpl_out, substr_diag *diag);
+
+// give a template back to the context it was prepared in
+void substr_template_release(substr_ctx *ctx, substr_template *tpl);
+
+// SUBSTR_SLOT_* flags of the placeholders of a template
+int substr_template_slots(const substr_template *tpl);
+
+// Render a template with bound values, the ones without a slot are ignored.
+// start_pos follows the input syntax and gets the target's rules.
+// Returns the number of chars written or an error code (< 0),
+// a NULL substr_string returns the exact length needed
+long int substr_template_render(const substr_template *tpl, const char *col_name, size_t col_name_len,
+                        long int start_pos, long int length, char *substr_string, size_t str_len);
+
+#endif // __substr_template_h__
@@ -1,4 +1,5 @@
 #include "substr_wrapper.h"
+#include "substr_telemetry.h"
 
 /* 
     private strdup if it is not available in system */
@@ -16,23 +17,42 @@ char * strdup( const char *str1 ) {
 #endif
 
 /* 
-    generate a translated substring function.
+    allocator of the legacy entry points, their results are freed with free() */
+static void *heap_alloc(void *pool, size_t size)
+{
+    (void)pool;
+    return malloc(size);
+}
+
+static void heap_release(void *pool, void *ptr, size_t size)
+{
+    (void)pool;
+    (void)size;
+    free(ptr);
+}
+
+static const substr_allocator heap_allocator = { heap_alloc, heap_release, NULL };
+
+/* 
+    generate a translated substring function, both names are copied into ctx.
     return 0 if success, -1 if error */
-FunctionStatus gen_substr_func(const substr_func_syntax *f_syntax, const substr_func *f_struct_in,
-                    substr_func *f_struct_out) 
+FunctionStatus gen_substr_func_ctx(substr_ctx *ctx, const substr_func_syntax *f_syntax,
+                    const substr_func *f_struct_in, substr_func *f_struct_out)
 {
-    if (!f_syntax || !f_struct_in || !f_struct_out) {
+    if (!ctx || !f_syntax || !f_struct_in || !f_struct_out || !f_struct_in->col_name) {
         return NULL_INPUT_POINTER; // Error: Null pointer
     }
 
-    f_struct_out->func_name = strdup(f_syntax->func_name);
+    size_t func_name_len = f_syntax->func_name_len ? f_syntax->func_name_len : strlen(f_syntax->func_name);
+    f_struct_out->func_name = substr_ctx_strndup(ctx, f_syntax->func_name, func_name_len);
     if (!f_struct_out->func_name) {
         return MEMORY_ALLOCATION_ERR; // Error: Memory allocation failed
     }
 
-    f_struct_out->col_name = strdup(f_struct_in->col_name);
+    size_t col_name_len = strlen(f_struct_in->col_name);
+    f_struct_out->col_name = substr_ctx_strndup(ctx, f_struct_in->col_name, col_name_len);
     if (!f_struct_out->col_name) {
-        free(f_struct_out->func_name);
+        substr_ctx_release(ctx, f_struct_out->func_name, func_name_len + 1);
         f_struct_out->func_name = NULL;
         return MEMORY_ALLOCATION_ERR; // Error: Memory allocation failed
     }
@@ -59,242 +79,749 @@ FunctionStatus gen_substr_func(const substr_func_syntax *f_syntax, const substr_
 }
 
 /* 
-    write out a substring function command using given parameters
-    user should make sure the output string size is long enough.
+    generate a translated substring function.
+    return 0 if success, -1 if error */
+FunctionStatus gen_substr_func(const substr_func_syntax *f_syntax, const substr_func *f_struct_in,
+                    substr_func *f_struct_out) 
+{
+    substr_ctx heap_ctx;
+    substr_ctx_init(&heap_ctx, &heap_allocator);
+    return gen_substr_func_ctx(&heap_ctx, f_syntax, f_struct_in, f_struct_out);
+}
+
+/* 
+    two decimal digits for every value 0..99 */
+static const char digit_pairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/* 
+    number of chars of v written in decimal, sign included */
+static size_t long_width(long int v)
+{
+    unsigned long u = v < 0 ? 0UL - (unsigned long)v : (unsigned long)v;
+    size_t width = (v < 0) + 1;
+    while (u >= 10) {
+        u /= 10;
+        width++;
+    }
+    return width;
+}
+
+/* 
+    write v in decimal to dst, width chars as given by long_width.
+    digits are produced two at a time from the end */
+static void write_long(char *dst, size_t width, long int v)
+{
+    unsigned long u = v < 0 ? 0UL - (unsigned long)v : (unsigned long)v;
+    char *p = dst + width;
+
+    while (u >= 100) {
+        unsigned long pair = (u % 100) * 2;
+        u /= 100;
+        *--p = digit_pairs[pair + 1];
+        *--p = digit_pairs[pair];
+    }
+    if (u >= 10) {
+        *--p = digit_pairs[u * 2 + 1];
+        *--p = digit_pairs[u * 2];
+    } else {
+        *--p = (char)('0' + u);
+    }
+    if (v < 0) {
+        *--p = '-';
+    }
+}
+
+/* 
+    write v in decimal to dst without terminator, a NULL dst only measures.
+    return the number of chars */
+size_t gen_substr_long(char *dst, long int v)
+{
+    size_t width = long_width(v);
+    if (dst) {
+        write_long(dst, width, v);
+    }
+    return width;
+}
+
+/* 
+    length of the numeric tail of a command: ", start_pos[, length])" */
+static size_t tail_width(long int start_pos, long int length)
+{
+    size_t width = 2 + long_width(start_pos) + 1;
+    if (length > 0) {
+        width += 2 + long_width(length);
+    }
+    return width;
+}
+
+/* 
+    write the numeric tail of a command, tail_width chars, no terminator.
+    return the end of what was written */
+static char *write_tail(char *p, long int start_pos, long int length)
+{
+    size_t width = long_width(start_pos);
+    *p++ = ',';
+    *p++ = ' ';
+    write_long(p, width, start_pos);
+    p += width;
+    if (length > 0) {
+        width = long_width(length);
+        *p++ = ',';
+        *p++ = ' ';
+        write_long(p, width, length);
+        p += width;
+    }
+    *p++ = ')';
+    return p;
+}
+
+/* 
+    the emitter behind every gen_substr_cmd* function: the exact length is
+    known before writing, pieces of known length are memcpy'd and numbers
+    are converted by hand.
+    return: the exact length if substr_string is NULL,
+            TOO_SHORT_OUTPUT_BUFFER if it does not fit with its null terminator,
+            number of chars written otherwise */
+static long int emit_substr_cmd(const char *func_name, size_t func_name_len,
+                    const char *col_name, size_t col_name_len, long int start_pos, long int length,
+                    char *substr_string, size_t str_len)
+{
+    // name + '(' + col + tail
+    size_t cmd_len = func_name_len + 1 + col_name_len + tail_width(start_pos, length);
+
+    if (!substr_string) {
+        return cmd_len; // size query
+    }
+    if (cmd_len >= str_len) {
+        return TOO_SHORT_OUTPUT_BUFFER; // Error: Output buffer too small
+    }
+
+    char *p = substr_string;
+    memcpy(p, func_name, func_name_len);
+    p += func_name_len;
+    *p++ = '(';
+    memcpy(p, col_name, col_name_len);
+    p += col_name_len;
+    p = write_tail(p, start_pos, length);
+    *p = '\0';
+
+    return cmd_len; // Success: number of chars written
+}
+
+/* 
+    write out a substring function command using given parameters.
+    Pass a NULL substr_string to get the exact length of the command, then
+    a buffer of at least that length + 1.
     return: <= 0: failure
-            > 0: number of chars written (successful) 
+            > 0: number of chars written (successful), or needed if substr_string is NULL
 */
 long int gen_substr_cmd(const substr_func *f_struct_in,  
                     char *substr_string, size_t str_len)
 {
-    if (!f_struct_in || !substr_string || str_len == 0) {
+    if (!f_struct_in || !f_struct_in->func_name || !f_struct_in->col_name || (substr_string && str_len == 0)) {
         return NULL_INPUT_POINTER; // Error: Null pointer or zero length
     }
 
-    size_t cmd_len = 0;
-    cmd_len += strlen(f_struct_in->func_name) + 1; // function name and '('
-    cmd_len += strlen(f_struct_in->col_name) + 2; // input string and ',  ' 
-
-    cmd_len += floor(log10(labs(f_struct_in->start_pos))) + 2;
+    return emit_substr_cmd(f_struct_in->func_name, strlen(f_struct_in->func_name),
+                           f_struct_in->col_name, strlen(f_struct_in->col_name),
+                           f_struct_in->start_pos, f_struct_in->length, substr_string, str_len);
+}
 
-    if (f_struct_in->length > 0) {
-        cmd_len += floor(log10(labs(f_struct_in->length))) + 2; // length and ')'
-    } else {
-        cmd_len += 1; // just ')'
-    }   
+/* 
+    write out only the numeric tail of a command, ", start_pos[, length])",
+    for callers that send the names from their own buffers.
+    return values are the same as gen_substr_cmd */
+long int gen_substr_cmd_tail(const substr_func_ref *f_ref, char *substr_string, size_t str_len)
+{
+    if (!f_ref || (substr_string && str_len == 0)) {
+        return NULL_INPUT_POINTER; // Error: Null pointer or zero length
+    }
 
+    size_t cmd_len = tail_width(f_ref->start_pos, f_ref->length);
+    if (!substr_string) {
+        return cmd_len; // size query
+    }
     if (cmd_len >= str_len) {
         return TOO_SHORT_OUTPUT_BUFFER; // Error: Output buffer too small
     }
 
-    long int written = 0;
+    *write_tail(substr_string, f_ref->start_pos, f_ref->length) = '\0';
+    return cmd_len;
+}
 
-    if (f_struct_in->length > 0) {
-        written = snprintf(substr_string, str_len, "%s(%s, %ld, %ld)", 
-                           f_struct_in->func_name,  f_struct_in->col_name, 
-                           f_struct_in->start_pos, 
-                           f_struct_in->length);
-    } else {
-        written = snprintf(substr_string, str_len, "%s(%s, %ld)", 
-                           f_struct_in->func_name,   f_struct_in->col_name, 
-                           f_struct_in->start_pos);
+/* 
+    fill in the precomputed function name lengths of a syntax table */
+void substr_syntax_prepare(substr_func_syntax *f_syntax, size_t n_syntax)
+{
+    if (!f_syntax) {
+        return;
+    }
+    for (size_t i = 0; i < n_syntax; i++) {
+        f_syntax[i].func_name_len = f_syntax[i].func_name ? strlen(f_syntax[i].func_name) : 0;
+    }
+}
+
+/* 
+    generate a translated substring function that borrows its strings:
+    the function name from the syntax table, the column from input_str.
+    Nothing is copied, f_ref_out is valid as long as both of them are.
+    return RET_SUCCESS or SUBSTR_STARTPOS_NEGATIVE */
+FunctionStatus gen_substr_func_ref(const substr_func_syntax *f_syntax, const char *input_str,
+                    const substr_func_view *f_view_in, substr_func_ref *f_ref_out)
+{
+    if (!f_syntax || !f_syntax->func_name || !input_str || !f_view_in || !f_ref_out) {
+        return NULL_INPUT_POINTER; // Error: Null pointer
+    }
+
+    // check if negative start position is allowed
+    if (f_view_in->start_pos < 0 && f_syntax->neg_start <= 0) {
+        return SUBSTR_STARTPOS_NEGATIVE;
     }
 
-    if (written < 0 || (size_t)written >= str_len) {
-        return TOO_SHORT_OUTPUT_BUFFER; // Error: Encoding error or output was truncated
+    f_ref_out->func_name     = f_syntax->func_name;
+    f_ref_out->func_name_len = f_syntax->func_name_len ? f_syntax->func_name_len : strlen(f_syntax->func_name);
+    f_ref_out->col_name      = input_str + f_view_in->col_name.offset;
+    f_ref_out->col_name_len  = f_view_in->col_name.length;
+
+    // make corrections based on shift_start
+    f_ref_out->start_pos = f_view_in->start_pos + f_syntax->shift_start;
+    f_ref_out->length    = f_view_in->length;
+
+    return RET_SUCCESS; // Success
+}
+
+/* 
+    write out a substring function command from borrowed strings of known
+    length, same output and return values as gen_substr_cmd, including the
+    size query with a NULL substr_string */
+long int gen_substr_cmd_ref(const substr_func_ref *f_ref, char *substr_string, size_t str_len)
+{
+    if (!f_ref || !f_ref->func_name || !f_ref->col_name || (substr_string && str_len == 0)) {
+        return NULL_INPUT_POINTER; // Error: Null pointer or zero length
     }
 
-    return written; // Success: number of chars written
+    return emit_substr_cmd(f_ref->func_name, f_ref->func_name_len, f_ref->col_name, f_ref->col_name_len,
+                           f_ref->start_pos, f_ref->length, substr_string, str_len);
 }
 
 /*
-    parse an input substring function call based on SAS-syntax-like rule.
-    This function adjusts the start position and validates the input.
-    Returns RET_SUCCESS if successful, or an error code otherwise.
+    positions of the delimiters of a substr call, found in one pass */
+typedef struct call_delims_struct {
+    const char *left_paren   ;  /* first '(' */
+    const char *right_paren  ;  /* last ')' */
+    const char *left_dquote  ;  /* first '"' after left_paren */
+    const char *right_dquote ;  /* last '"' after left_paren */
+    const char *first_comma  ;  /* first ',' after left_paren */
+    const char *dquote_comma ;  /* first ',' after right_dquote */
+} call_delims;
 
-    Example input strings: "SUBSTR(col, -3, 5)" or "SUBSTR(col, 1)"
+/*
+    walk the structural bitmap of the input once, block by block,
+    instead of one strchr/strrchr scan per delimiter */
+static void scan_call_delims(const char *input_str, size_t input_len, call_delims *d)
+{
+    memset(d, 0, sizeof(*d));
+
+    for (size_t base = 0; base < input_len; base += SUBSTR_SCAN_BLOCK) {
+        size_t n = input_len - base;
+        uint64_t mask = substr_scan_block(&substr_scan_call_set, input_str + base,
+                                          n < SUBSTR_SCAN_BLOCK ? n : SUBSTR_SCAN_BLOCK);
+        while (mask) {
+            const char *p = input_str + base + __builtin_ctzll(mask);
+            mask &= mask - 1;
+
+            switch (*p) {
+            case '(':
+                if (!d->left_paren) {
+                    d->left_paren = p;
+                }
+                break;
+            case ')':
+                d->right_paren = p;
+                break;
+            case '"':
+                if (d->left_paren) {
+                    if (!d->left_dquote) {
+                        d->left_dquote = p;
+                    }
+                    d->right_dquote = p;
+                    d->dquote_comma = NULL;
+                }
+                break;
+            case ',':
+                if (d->left_paren) {
+                    if (!d->first_comma) {
+                        d->first_comma = p;
+                    }
+                    if (!d->dquote_comma) {
+                        d->dquote_comma = p;
+                    }
+                }
+                break;
+            }
+        }
+    }
+}
 
-    !!! Note the use of strtok function which will modify the input string !!!
-*/
-FunctionStatus parse_substr_call(const char *input_str_const, substr_func *f_struct_out)
+/*
+    delimiters between the numeric arguments of a substr call */
+static int is_func_token_delim(char c)
 {
-    // vaidate input
-    if (!input_str_const || !f_struct_out) {
-        return NULL_INPUT_POINTER; // Error: Null pointer
+    return c == ' ' || c == ',' || c == '(' || c == ')';
+}
+
+/*
+    find the next token in [*pos, end) separated by " ,()", the same rule
+    used by strtok on the numeric arguments, without modifying the input.
+    return 1 if a token is found, 0 otherwise */
+static int next_func_token(const char *input_str, size_t *pos, size_t end, substr_view *token)
+{
+    size_t i = *pos;
+    while (i < end && is_func_token_delim(input_str[i])) {
+        i++;
+    }
+    if (i >= end) {
+        *pos = end;
+        return 0;
     }
-    FunctionStatus rc = RET_SUCCESS;
 
-    char *input_str = strdup(input_str_const);
-    if (!input_str) {
-        rc = MEMORY_ALLOCATION_ERR; // Error: Memory allocation failed
-        goto END;
+    token->offset = i;
+    while (i < end && !is_func_token_delim(input_str[i])) {
+        i++;
     }
+    token->length = i - token->offset;
+    *pos = i;
+    return 1;
+}
 
-    // reset function paramenets 
-    if (f_struct_out->func_name) {
-        free(f_struct_out->func_name);
-        f_struct_out->func_name = NULL;
+/*
+    1 if c is a blank between the parts of a call, the same set the lexer skips */
+static int is_call_blank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/*
+    first position at or after pos that is not a blank */
+static size_t skip_call_blanks(const char *input_str, size_t pos, size_t end)
+{
+    while (pos < end && is_call_blank(input_str[pos])) {
+        pos++;
     }
-    if (f_struct_out->col_name) {
-        free(f_struct_out->col_name);
-        f_struct_out->col_name = NULL;
+    return pos;
+}
+
+/*
+    convert a token to a long integer, the whole token must be a number.
+    return 1 if success, 0 if not a valid integer or out of range */
+static int view_to_long(const char *input_str, const substr_view *token, long int *value)
+{
+    const char *p   = input_str + token->offset;
+    const char *end = p + token->length;
+    int negative = 0;
+
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        p++;
+    }
+    if (p >= end) {
+        return 0;
     }
 
-    // matach parentheses
-    char *left_paren    = strchr(input_str, '(');
-    char *right_paren   = strrchr(input_str, ')');
+    // accumulate as a negative number so LONG_MIN is representable
+    long int acc = 0;
+    for (; p < end; p++) {
+        if (*p < '0' || *p > '9') {
+            return 0;
+        }
+        int digit = *p - '0';
+        if (acc < (LONG_MIN + digit) / 10) {
+            return 0;
+        }
+        acc = acc * 10 - digit;
+    }
 
-    if (!left_paren || !right_paren || left_paren >= right_paren) {
-        rc = FUNC_CALL_PARENS_MISMATCH; // Error: Invalid format
-        goto END;
+    if (!negative) {
+        if (acc == LONG_MIN) {
+            return 0;
+        }
+        acc = -acc;
     }
+    *value = acc;
+    return 1;
+}
 
-    // match double quotes if input is a literal string
-    char *left_dquote   = strchr(left_paren, '"');;
-    char *right_dquote  = strrchr(left_paren, '"');
+/*
+    parse an input substring function call based on SAS-syntax-like rule,
+    without copying or allocating anything: the column name (or string
+    literal) and the numeric arguments are returned as views into input_str.
+    input_str does not need to be null-terminated, only input_len bytes are read.
+    Returns RET_SUCCESS if successful, or an error code otherwise.
+
+    Example input strings: "SUBSTR(col, -3, 5)" or "SUBSTR(col, 1)"
+
+    On failure *err_pos is the byte offset of the offending part of the input.
+*/
+static FunctionStatus parse_call_view(const char *input_str, size_t input_len, substr_func_view *f_view_out,
+                        size_t *err_pos)
+{
+    *err_pos = 0;
+
+    memset(f_view_out, 0, sizeof(*f_view_out));
+
+    call_delims d;
+    scan_call_delims(input_str, input_len, &d);
+
+    // matach parentheses
+    if (!d.left_paren || !d.right_paren || d.left_paren >= d.right_paren) {
+        *err_pos = d.left_paren ? (size_t)(d.left_paren - input_str) : input_len;
+        return FUNC_CALL_PARENS_MISMATCH; // Error: Invalid format
+    }
 
     // if one pointer is real, the other is real too
-    if (left_dquote && left_dquote >= right_dquote) {
-        rc = FUNC_CALL_DQUOTE_MISMATCH; // Error: Mismatched quotes
-        goto END;
-    }   
+    if (d.left_dquote && d.left_dquote >= d.right_dquote) {
+        *err_pos = d.left_dquote - input_str;
+        return FUNC_CALL_DQUOTE_MISMATCH; // Error: Mismatched quotes
+    }
 
-    const char func_tokens[] = " ,()";
-    char *nxtoken = NULL;
+    // function name, recognized by the callers that care about the source dialect
+    size_t name_end = d.left_paren - input_str;
+    size_t name_start = skip_call_blanks(input_str, 0, name_end);
+    while (name_end > name_start && is_call_blank(input_str[name_end - 1])) {
+        name_end--;
+    }
+    f_view_out->func_name.offset = name_start;
+    f_view_out->func_name.length = name_end - name_start;
 
-    // char * col_name = NULL;
-    char * comma_pos = NULL;
-    // char * end_token = NULL;
+    const char *comma_pos = NULL;
 
     // col name is input here, col name does not contain space or comma or parens !!!
-    if (!left_dquote) {
-        comma_pos = strchr(left_paren + 1, ',');
-        if (!comma_pos || comma_pos >= right_paren) {
-            rc = FUNC_CALL_WRONG_COL_NAME; // Error: Invalid format
-            goto END;
+    if (!d.left_dquote) {
+        comma_pos = d.first_comma;
+        if (!comma_pos || comma_pos >= d.right_paren) {
+            *err_pos = d.left_paren + 1 - input_str;
+            return FUNC_CALL_WRONG_COL_NAME; // Error: Invalid format
         }
-
-        f_struct_out->col_name = (char *)malloc((comma_pos - left_paren   ) * sizeof(char));
-        if (!f_struct_out->col_name) {
-            rc = MEMORY_ALLOCATION_ERR; // Error: Memory allocation failed
-            goto END;
-        }
-        strncpy(f_struct_out->col_name, left_paren + 1, comma_pos - left_paren - 1);
-        f_struct_out->col_name[comma_pos - left_paren - 1] = '\0';
+        f_view_out->col_name.offset = d.left_paren + 1 - input_str;
+        f_view_out->col_name.length = comma_pos - d.left_paren - 1;
     } else {
-        comma_pos = strchr(right_dquote + 1, ',');
-        if (!comma_pos || comma_pos >= right_paren) {
-            rc = FUNC_CALL_WRONG_COL_NAME; // Error: Invalid format
-            goto END;
+        comma_pos = d.dquote_comma;
+        if (!comma_pos || comma_pos >= d.right_paren) {
+            *err_pos = d.right_dquote + 1 - input_str;
+            return FUNC_CALL_WRONG_COL_NAME; // Error: Invalid format
         }
+        f_view_out->col_name.offset = d.left_dquote - input_str;
+        f_view_out->col_name.length = d.right_dquote - d.left_dquote + 1;
+    }
 
-        f_struct_out->col_name = (char *)malloc((right_dquote - left_dquote + 2) * sizeof(char));
-        if (!f_struct_out->col_name) {
-            rc = MEMORY_ALLOCATION_ERR; // Error: Memory allocation failed
-            goto END;
+    // start position
+    size_t pos = comma_pos - input_str;
+    if (!next_func_token(input_str, &pos, input_len, &f_view_out->start_tok)) {
+        *err_pos = pos;
+        return FUNC_CALL_WRONG_START_POS; // Error: No start position
+    }
+    if (!view_to_long(input_str, &f_view_out->start_tok, &f_view_out->start_pos)) {
+        *err_pos = f_view_out->start_tok.offset;
+        return FUNC_CALL_WRONG_START_POS; // Error: Not a valid integer
+    }
+
+    // length (optional)
+    if (!next_func_token(input_str, &pos, input_len, &f_view_out->length_tok)) {
+        f_view_out->length = 0; // length is optional
+    } else if (!view_to_long(input_str, &f_view_out->length_tok, &f_view_out->length)) {
+        *err_pos = f_view_out->length_tok.offset;
+        return FUNC_CALL_WRONG_LENGTH; // Error: Not a valid integer
+    }
+
+    // only blanks around the start position and the length up to the
+    // closing ')': a nested call or a fourth argument would otherwise be cut off
+    pos = skip_call_blanks(input_str, comma_pos + 1 - input_str, input_len);
+    if (pos != f_view_out->start_tok.offset) {
+        *err_pos = pos;
+        return FUNC_CALL_SYNTAX_ERR; // Error: unexpected text before the start position
+    }
+    pos = skip_call_blanks(input_str, pos + f_view_out->start_tok.length, input_len);
+    if (f_view_out->length_tok.length > 0) {
+        if (input_str[pos] != ',') {
+            *err_pos = pos;
+            return FUNC_CALL_SYNTAX_ERR; // Error: no ',' before the length
         }
-        strncpy(f_struct_out->col_name, left_dquote, right_dquote - left_dquote + 1);
-        f_struct_out->col_name[right_dquote - left_dquote+1] = '\0';
+        pos = skip_call_blanks(input_str, pos + 1, input_len);
+        if (pos != f_view_out->length_tok.offset) {
+            *err_pos = pos;
+            return FUNC_CALL_SYNTAX_ERR; // Error: unexpected text before the length
+        }
+        pos = skip_call_blanks(input_str, pos + f_view_out->length_tok.length, input_len);
+    }
+    if (input_str + pos != d.right_paren) {
+        *err_pos = pos;
+        return FUNC_CALL_SYNTAX_ERR; // Error: unexpected text before ')'
+    }
 
+    if (f_view_out->length < 0) {
+        f_view_out->length = 0; // treat negative length as 0
     }
 
-    // start position
-    nxtoken = strtok(comma_pos, func_tokens);
-    if (!nxtoken || strlen(nxtoken) == 0) {
-        rc = FUNC_CALL_WRONG_START_POS; // Error: Invalid format
-        goto END;
-   }
+    return RET_SUCCESS;
+}
 
-    char* endptr;
-    f_struct_out->start_pos = strtol(nxtoken, &endptr, 10);
-    if (endptr == nxtoken || *endptr != '\0') {
-        rc = FUNC_CALL_WRONG_START_POS; // Error: Not a valid integer
-        goto END;
+/*
+    parse an input substring function call into views, see parse_call_view */
+FunctionStatus parse_substr_call_view(const char *input_str, size_t input_len, substr_func_view *f_view_out)
+{
+    // vaidate input
+    if (!input_str || !f_view_out) {
+        return NULL_INPUT_POINTER; // Error: Null pointer
     }
 
-    // length (optional)
-    nxtoken = strtok(NULL, func_tokens);
-    if (!nxtoken || strlen(nxtoken) == 0) {
-        f_struct_out->length = 0; // length is optional
-    } else {
-        f_struct_out->length = strtol(nxtoken, &endptr, 10);
-        if (endptr == nxtoken || *endptr != '\0') {
-            rc = FUNC_CALL_WRONG_LENGTH; // Error: Not a valid integer
-            goto END;
+    size_t err_pos;
+    return parse_call_view(input_str, input_len, f_view_out, &err_pos);
+}
+
+/* 
+    record a failure in the caller's diagnostics and hand it to the sink, if any.
+    return status */
+FunctionStatus substr_diag_report(substr_diag *diag, const char *input_str,
+                        FunctionStatus status, substr_stage stage, size_t offset)
+{
+    if (diag) {
+        diag->status = status;
+        diag->stage  = stage;
+        diag->offset = offset;
+        if (status != RET_SUCCESS && diag->sink) {
+            diag->sink(diag->sink_ctx, input_str, diag);
         }
     }
+    return status;
+}
 
-    if (f_struct_out->length < 0) {
-        f_struct_out->length = 0; // treat negative length as 0
+/*
+    same as parse_substr_call_view, a failure is also described in diag */
+FunctionStatus parse_substr_call_view_diag(const char *input_str, size_t input_len, substr_func_view *f_view_out,
+                        substr_diag *diag)
+{
+    if (!input_str || !f_view_out) {
+        return substr_diag_report(diag, input_str, NULL_INPUT_POINTER, SUBSTR_STAGE_ARGS, 0);
     }
 
-    END:
-    if (input_str) {
-        free(input_str);
+    size_t err_pos;
+    FunctionStatus rc = parse_call_view(input_str, input_len, f_view_out, &err_pos);
+    return substr_diag_report(diag, input_str, rc, rc == RET_SUCCESS ? SUBSTR_STAGE_NONE : SUBSTR_STAGE_PARSE, err_pos);
+}
+
+/*
+    parse an input substring function call based on SAS-syntax-like rule.
+    This function adjusts the start position and validates the input.
+    Returns RET_SUCCESS if successful, or an error code otherwise.
+
+    Example input strings: "SUBSTR(col, -3, 5)" or "SUBSTR(col, 1)"
+
+    The input string is left untouched; the only allocation is the copy of
+    the column name, use parse_substr_call_view to avoid it.
+*/
+FunctionStatus parse_substr_call(const char *input_str, substr_func *f_struct_out)
+{
+    // vaidate input
+    if (!input_str || !f_struct_out) {
+        return NULL_INPUT_POINTER; // Error: Null pointer
     }
 
-    return rc; // Success
+    // reset function paramenets 
+    if (f_struct_out->func_name) {
+        free(f_struct_out->func_name);
+        f_struct_out->func_name = NULL;
+    }
+    if (f_struct_out->col_name) {
+        free(f_struct_out->col_name);
+        f_struct_out->col_name = NULL;
+    }
+
+    substr_ctx heap_ctx;
+    substr_ctx_init(&heap_ctx, &heap_allocator);
+    return parse_substr_call_ctx(&heap_ctx, input_str, f_struct_out);
+}
+
+/*
+    Parse input substr function call string, the column name is copied into ctx
+    and lives until the context is reset; names already in f_struct_out are not freed.
+*/
+FunctionStatus parse_substr_call_ctx(substr_ctx *ctx, const char *input_str, substr_func *f_struct_out)
+{
+    if (!ctx || !input_str || !f_struct_out) {
+        return NULL_INPUT_POINTER; // Error: Null pointer
+    }
+
+    f_struct_out->func_name = NULL;
+    f_struct_out->col_name  = NULL;
+
+    substr_func_view f_view = {0};
+    FunctionStatus rc = parse_substr_call_view(input_str, strlen(input_str), &f_view);
+    if (rc != RET_SUCCESS) {
+        return rc;
+    }
+
+    f_struct_out->col_name = substr_ctx_strndup(ctx, input_str + f_view.col_name.offset, f_view.col_name.length);
+    if (!f_struct_out->col_name) {
+        return MEMORY_ALLOCATION_ERR; // Error: Memory allocation failed
+    }
+
+    f_struct_out->start_pos = f_view.start_pos;
+    f_struct_out->length    = f_view.length;
+
+    return RET_SUCCESS; // Success
 }
 
 /*
     Given an input substr function call (such as SAS substr call) and a target DBMS syntax,
     translate the input substr function to the target DBMS syntax and write to output string.
-    User should make sure the output string is long enough to hold the result.
+    Pass a NULL out_substr_string to only get the exact output length in out_str_wrt,
+    then allocate out_str_wrt + 1 chars.
     return: 0: success
            != 0: error code passed by children functions
 */
 FunctionStatus translate_substr_func(const char *input_str, const substr_func_syntax *f_syntax,
                         char *out_substr_string, size_t out_str_len, size_t *out_str_wrt)
 {
-    if (!input_str || !f_syntax || !out_substr_string || out_str_len == 0) {
-        return NULL_INPUT_POINTER; // Error: Null pointer or zero length
-    }
+    return translate_substr_func_diag(input_str, f_syntax, out_substr_string, out_str_len, out_str_wrt, NULL);
+}
 
-    substr_func f_struct_in  = {0};
+/*
+    translate_substr_func_diag counted in the telemetry under DBMS_id. A size
+    query only measures the output, it is not a translation and not counted */
+FunctionStatus translate_substr_func_counted(const char *input_str, const substr_func_syntax *f_syntax, int DBMS_id,
+                        char *out_substr_string, size_t out_str_len, size_t *out_str_wrt, substr_diag *diag)
+{
+    FunctionStatus rc = RET_SUCCESS;
+    substr_stage stage = SUBSTR_STAGE_NONE;
+    size_t input_len = 0, err_pos = 0;
+    long int wrt_size = 0;
+    substr_func_view f_view_in = {0};
+    substr_func_ref f_ref_out;
+    SUBSTR_TELEMETRY_TIMER(timer);
+
+    if (!input_str || !f_syntax || (out_substr_string && out_str_len == 0) || !out_str_wrt) {
+        rc = NULL_INPUT_POINTER; // Error: Null pointer or zero length
+        stage = SUBSTR_STAGE_ARGS;
+        goto END;
+    }
 
-    FunctionStatus rc = parse_substr_call(input_str, &f_struct_in);
+    input_len = strlen(input_str);
+    rc = parse_call_view(input_str, input_len, &f_view_in, &err_pos);
+    SUBSTR_TELEMETRY_LAP(timer, SUBSTR_STAGE_PARSE, 1);
     if (rc != RET_SUCCESS) {
-        printf("    Error parsing input: %d\n", rc);
-        if (f_struct_in.func_name) free(f_struct_in.func_name);
-        if (f_struct_in.col_name) free(f_struct_in.col_name);
-
-        return rc;
+        stage = SUBSTR_STAGE_PARSE;
+        goto END;
     }
 
-    substr_func f_struct_out = {0};
-
-    rc = gen_substr_func(f_syntax, &f_struct_in, &f_struct_out);
+    rc = gen_substr_func_ref(f_syntax, input_str, &f_view_in, &f_ref_out);
+    SUBSTR_TELEMETRY_LAP(timer, SUBSTR_STAGE_GENERATE, 1);
     if (rc != RET_SUCCESS) {
-        printf("    Error generating function: %d\n", rc);
-        if (f_struct_in.func_name) free(f_struct_in.func_name);
-        if (f_struct_in.col_name) free(f_struct_in.col_name);
-        if (f_struct_out.func_name) free(f_struct_out.func_name);
-        if (f_struct_out.col_name) free(f_struct_out.col_name);
-        return rc;
+        stage = SUBSTR_STAGE_GENERATE;
+        err_pos = f_view_in.start_tok.offset;
+        goto END;
     }
 
-    long int wrt_size = gen_substr_cmd(&f_struct_out, out_substr_string, out_str_len);
-    if (f_struct_in.func_name) free(f_struct_in.func_name);
-    if (f_struct_in.col_name) free(f_struct_in.col_name);
-    if (f_struct_out.func_name) free(f_struct_out.func_name);
-    if (f_struct_out.col_name) free(f_struct_out.col_name);
-
+    wrt_size = gen_substr_cmd_ref(&f_ref_out, out_substr_string, out_str_len);
+    SUBSTR_TELEMETRY_LAP(timer, SUBSTR_STAGE_EMIT, 1);
     if (wrt_size <= 0) {
-        printf("    Error generating command: %ld\n", wrt_size);
-        return wrt_size;
+        rc = wrt_size;
+        stage = SUBSTR_STAGE_EMIT;
+        err_pos = input_len;
+        wrt_size = 0;
+        goto END;
     }
 
-    out_str_wrt[0] = wrt_size;
+    out_str_wrt[0] = wrt_size; // number of chars written
 
-    return RET_SUCCESS; // return number of chars written
+END:
+    if (out_substr_string && DBMS_id != SUBSTR_TELEMETRY_NONE) {
+        SUBSTR_TELEMETRY_COUNT(DBMS_id, rc, input_len, (size_t)wrt_size);
+    }
+    return substr_diag_report(diag, input_str, rc, stage, err_pos);
+}
+
+/*
+    translate_substr_func reporting a failure through diag: the status, the
+    stage that failed and the byte offset in input_str where it was detected.
+    Nothing is printed; diag->sink, if set, is called once per failure.
+*/
+FunctionStatus translate_substr_func_diag(const char *input_str, const substr_func_syntax *f_syntax,
+                        char *out_substr_string, size_t out_str_len, size_t *out_str_wrt, substr_diag *diag)
+{
+    return translate_substr_func_counted(input_str, f_syntax, substr_telemetry_key(f_syntax),
+                        out_substr_string, out_str_len, out_str_wrt, diag);
 }
 
 /* 
-    A wrapper function uses DBMS id to call real translator
+    A wrapper function uses DBMS id to call real translator.
+    DBMS_id must be a DBMS_ID value below DBMS_UNKNOWN, tables loaded at
+    run time are looked up by name through substr_registry instead
 */
 FunctionStatus translate_substr_func_useID(const char *input_str, const int DBMS_id, const substr_func_syntax *f_syntax,
                         char *out_substr_string, size_t out_str_len, size_t *out_str_wrt)
 {
-    return translate_substr_func(input_str, f_syntax + DBMS_id,
-                        out_substr_string, out_str_len, out_str_wrt);
-}
\ No newline at end of file
+    if (!f_syntax) {
+        return NULL_INPUT_POINTER; // Error: Null pointer
+    }
+    if (DBMS_id < DBMS_ORACLE || DBMS_id >= DBMS_UNKNOWN) {
+        return UNKNOWN_DBMS_ID;
+    }
+    return translate_substr_func_counted(input_str, f_syntax + DBMS_id, DBMS_id,
+                        out_substr_string, out_str_len, out_str_wrt, NULL);
+}
+
+/*
+    Given one input substr function call and a table of n_syntax target DBMS
+    syntaxes, parse the input once and write the translation for every entry
+    of the table into out_buf. The result for f_syntax[i] starts at
+    out_buf + out_offsets[i], has out_lengths[i] chars, and its own status in
+    out_status[i]: a target rejecting the input does not stop the others.
+    return: RET_SUCCESS if every target succeeded, otherwise the status of
+            the first failed target
+*/
+FunctionStatus translate_substr_func_all(const char *input_str, const substr_func_syntax *f_syntax, size_t n_syntax,
+                        char *out_buf, size_t out_buf_len,
+                        size_t *out_offsets, size_t *out_lengths, FunctionStatus *out_status)
+{
+    if (!input_str || !f_syntax || !out_buf || !out_offsets || !out_lengths || !out_status) {
+        return NULL_INPUT_POINTER; // Error: Null pointer
+    }
+
+    substr_func_view f_view_in = {0};
+    FunctionStatus parse_rc = parse_substr_call_view(input_str, strlen(input_str), &f_view_in);
+
+    FunctionStatus rc = RET_SUCCESS;
+    size_t used = 0;
+
+    for (size_t i = 0; i < n_syntax; i++) {
+        out_offsets[i] = used;
+        out_lengths[i] = 0;
+        out_status[i]  = parse_rc;
+
+        if (parse_rc == RET_SUCCESS) {
+            substr_func_ref f_ref_out;
+            out_status[i] = gen_substr_func_ref(f_syntax + i, input_str, &f_view_in, &f_ref_out);
+
+            if (out_status[i] == RET_SUCCESS) {
+                long int wrt_size = used < out_buf_len
+                                  ? gen_substr_cmd_ref(&f_ref_out, out_buf + used, out_buf_len - used)
+                                  : TOO_SHORT_OUTPUT_BUFFER;
+                if (wrt_size <= 0) {
+                    out_status[i] = wrt_size;
+                } else {
+                    out_lengths[i] = wrt_size;
+                    used += wrt_size + 1;   // keep the null terminator
+                }
+            }
+        }
+
+        if (rc == RET_SUCCESS && out_status[i] != RET_SUCCESS) {
+            rc = out_status[i];
+        }
+    }
+
+    return rc;
+}
@@ -4,10 +4,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <math.h>
+#include <limits.h>
 // #include <stdarg.h>
 
 #include "func_status.h"
+#include "substr_scan.h"
+#include "substr_ctx.h"
 
 #if defined(_WIN32)
 #define strdup _strdup
@@ -33,28 +35,136 @@ typedef struct substr_func_struc {
     long int  length     ;
 } substr_func;
 
+// a range of bytes inside the caller's input buffer
+typedef struct substr_view_struct {
+    size_t offset ;  /* byte offset from the start of the input */
+    size_t length ;  /* number of bytes */
+} substr_view;
+
+// elements for a substr function, as views into the input instead of copies
+typedef struct substr_func_view_struct {
+    substr_view col_name   ;  /* column name or string literal */
+    substr_view start_tok  ;  /* text of the start position argument */
+    substr_view length_tok ;  /* text of the length argument, length 0 if absent */
+    long int  start_pos  ;
+    long int  length     ;
+    substr_view func_name  ;  /* function name before '(', without surrounding blanks */
+} substr_func_view;
+
+// elements of a translated substr function that borrow their strings:
+// func_name from the syntax table and col_name from the parsed input
+typedef struct substr_func_ref_struct {
+    const char *func_name ;
+    size_t func_name_len  ;
+    const char *col_name  ;  /* column name or string literal, not null-terminated */
+    size_t col_name_len   ;
+    long int  start_pos  ;
+    long int  length     ;
+} substr_func_ref;
+
 // Define the syntax conversion between a DBMS and the input syntax
 typedef struct substr_func_sybtax_struct {
     char *func_name ;   /* substr function name */
     int neg_start   ;   /* if negative start_pos is allowed, default is false (0) */  
     int shift_start ;   /*position shift caused by the difference btw the index scheme of input and target DBMS: 1-based or 0-based */
+    size_t func_name_len ;  /* strlen(func_name), set by SUBSTR_SYNTAX or substr_syntax_prepare; 0 if not known */
 } substr_func_syntax;
 
-// convert the elements of an input substr function to another one
+// step of a translation that failed
+typedef enum {
+    SUBSTR_STAGE_NONE = 0,  /* no failure */
+    SUBSTR_STAGE_ARGS,      /* NULL pointer or empty buffer passed in */
+    SUBSTR_STAGE_PARSE,     /* input is not a valid substr call */
+    SUBSTR_STAGE_GENERATE,  /* target syntax rejects the call */
+    SUBSTR_STAGE_EMIT,      /* output buffer too short */
+} substr_stage;
+
+typedef struct substr_diag_struct substr_diag;
+
+// optional sink called on every failure, e.g. to log it
+typedef void (*substr_diag_sink)(void *sink_ctx, const char *input_str, const substr_diag *diag);
+
+// caller-owned diagnostics of a translation, the library never prints
+struct substr_diag_struct {
+    FunctionStatus status ; /* status of the last call */
+    substr_stage   stage  ; /* stage that failed, SUBSTR_STAGE_NONE on success */
+    size_t         offset ; /* byte offset in the input where the failure was detected */
+    substr_diag_sink sink ; /* set by the caller, may be NULL */
+    void *sink_ctx        ;
+};
+
+// fill diag (may be NULL) and call its sink if status is a failure, return status
+FunctionStatus substr_diag_report(substr_diag *diag, const char *input_str,
+                        FunctionStatus status, substr_stage stage, size_t offset);
+
+// initializer of a syntax table entry with a literal function name,
+// the name length is computed at compile time
+#define SUBSTR_SYNTAX(func_name, neg_start, shift_start) \
+    { func_name, neg_start, shift_start, sizeof(func_name) - 1 }
+
+// convert the elements of an input substr function to another one,
+// f_struct_out owns copies of both names and must be freed by the caller
 FunctionStatus gen_substr_func(const substr_func_syntax *f_syntax, const substr_func *f_struct_in,
                     substr_func *f_struct_out);
 
-// Generate command string using the elements of an input substr function 
+// same as gen_substr_func, the names are copied into ctx and released with it
+FunctionStatus gen_substr_func_ctx(substr_ctx *ctx, const substr_func_syntax *f_syntax,
+                    const substr_func *f_struct_in, substr_func *f_struct_out);
+
+// Generate command string using the elements of an input substr function,
+// a NULL substr_string returns the exact length the command needs
 long int gen_substr_cmd(const substr_func *f_struct_in, char *substr_string, size_t str_len);
 
+// compute func_name_len of every entry of a syntax table built at run time
+void substr_syntax_prepare(substr_func_syntax *f_syntax, size_t n_syntax);
+
+// convert a parsed view to another syntax, borrowing the function name from
+// f_syntax and the column from input_str instead of copying them
+FunctionStatus gen_substr_func_ref(const substr_func_syntax *f_syntax, const char *input_str,
+                    const substr_func_view *f_view_in, substr_func_ref *f_ref_out);
+
+// Generate command string from borrowed elements
+long int gen_substr_cmd_ref(const substr_func_ref *f_ref, char *substr_string, size_t str_len);
+
+// longest numeric tail ", start_pos, length)" of a command
+#define SUBSTR_CMD_TAIL_MAX  (2 + 20 + 2 + 20 + 1)
+
+// Write a long integer in decimal (at most 20 chars, no terminator),
+// a NULL dst returns the width only
+size_t gen_substr_long(char *dst, long int v);
+
+// Generate only the numeric tail ", start_pos[, length])" of a command
+long int gen_substr_cmd_tail(const substr_func_ref *f_ref, char *substr_string, size_t str_len);
+
 // Parse input substr function call string into different elements 
 FunctionStatus parse_substr_call(const char *input_str, substr_func *f_struct_out);
 
+// same as parse_substr_call, the column name is copied into ctx and released with it
+FunctionStatus parse_substr_call_ctx(substr_ctx *ctx, const char *input_str, substr_func *f_struct_out);
+
+// Parse input substr function call string without allocating, elements are
+// returned as (offset, length) views into input_str
+FunctionStatus parse_substr_call_view(const char *input_str, size_t input_len, substr_func_view *f_view_out);
+
+// same as parse_substr_call_view, a failure is also described in diag
+FunctionStatus parse_substr_call_view_diag(const char *input_str, size_t input_len, substr_func_view *f_view_out,
+                        substr_diag *diag);
+
 
 // Main wrapper function
 FunctionStatus translate_substr_func(const char *input_str, const substr_func_syntax *f_syntax,
                         char *out_substr_string, size_t out_str_len, size_t *out_str_wrt);
 
+// Main wrapper function reporting a failure in diag (may be NULL)
+FunctionStatus translate_substr_func_diag(const char *input_str, const substr_func_syntax *f_syntax,
+                        char *out_substr_string, size_t out_str_len, size_t *out_str_wrt, substr_diag *diag);
+
+// translate_substr_func_diag counted in the telemetry under DBMS_id instead of
+// the place of f_syntax in the telemetry table, not at all if DBMS_id is
+// SUBSTR_TELEMETRY_NONE. A NULL out_substr_string is never counted
+FunctionStatus translate_substr_func_counted(const char *input_str, const substr_func_syntax *f_syntax, int DBMS_id,
+                        char *out_substr_string, size_t out_str_len, size_t *out_str_wrt, substr_diag *diag);
+
 // Given 
 //    input_str: an input substr function call string, 
 //    DBMS_id:   ID of input target DBMS, 
@@ -64,4 +174,14 @@ FunctionStatus translate_substr_func(const char *input_str, const substr_func_sy
 FunctionStatus translate_substr_func_useID(const char *input_str, const int DBMS_id, const substr_func_syntax *f_syntax,
                         char *out_substr_string, size_t out_str_len, size_t *out_str_wrt);
 
+// Given 
+//    input_str: an input substr function call string, parsed only once
+//    f_syntax:  library for syntax conversion with n_syntax targets
+//    out_buf:   holder for all converted substr function call strings
+//    out_offsets, out_lengths, out_status: position, size and status of
+//               the output of each target
+FunctionStatus translate_substr_func_all(const char *input_str, const substr_func_syntax *f_syntax, size_t n_syntax,
+                        char *out_buf, size_t out_buf_len,
+                        size_t *out_offsets, size_t *out_lengths, FunctionStatus *out_status);
+
 #endif // __substr_wrapper_h__